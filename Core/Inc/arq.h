@@ -0,0 +1,84 @@
+/*
+ * arq.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Selective-repeat ARQ for the photo downlink. Every data packet carries its sequence
+ *  number (and its offset in the photo, see packetizer.h), the packets are sent in bursts of up to WINDOW_SIZE transmissions and the
+ *  ground answers every burst with one ACK:
+ *
+ *  	| ACK_DATA | base (16 bits) | bitmap (WINDOW_SIZE bits) |
+ *
+ *  Every packet before base has been received, and bit i (byte i/8, LSB first) of the
+ *  bitmap tells if the packet base + i has been received. The lost packets are sent
+ *  again at the beginning of the next burst, which is then filled with new packets.
+ *
+ *  The chunks of CATALOG_CHUNK bytes that the ground already has from a previous
+ *  transfer (delivery bitmap of the catalog, see ARQ_Track) are never sent.
+ */
+
+#ifndef INC_ARQ_H_
+#define INC_ARQ_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ARQ_MIN_WINDOW				8			//Minimum transmissions per burst
+#define ARQ_RTT_FACTOR				4			//A burst lasts at least 4 times the ACK round trip
+#define ARQ_ACK_TIMEOUT				5000		//ms without ACK before sending the burst again
+#define ARQ_MAX_TIMEOUTS			3			//Consecutive ACK timeouts before giving up
+
+typedef enum
+{
+	ARQ_NONE,			//Nothing to send until the next ACK
+	ARQ_NEW,			//First transmission of the packet
+	ARQ_RETX,			//Retransmission of a lost packet
+}ArqTx_t;
+
+typedef enum
+{
+	ARQ_TIMEOUT_NONE,	//Waiting for the ACK (or nothing sent)
+	ARQ_TIMEOUT_RESEND,	//ACK lost: the burst has to be sent again
+	ARQ_TIMEOUT_LOST,	//No ACK after ARQ_MAX_TIMEOUTS bursts: the transfer stops until it is restarted
+}ArqTimeout_t;
+
+/*Called once for every packet acknowledged (offset and length of its data)*/
+typedef void (*ArqDelivered_t)(uint16_t offset, uint8_t length);
+
+/*Starts the transfer of a photo of total_bytes bytes, from the packet first at first_offset*/
+void ARQ_Init(uint16_t first, uint16_t first_offset, uint16_t total_bytes);
+
+/*Skips the chunks set in delivered (NULL => none) and reports the packets acknowledged to callback*/
+void ARQ_Track(const uint8_t *delivered, ArqDelivered_t callback);
+
+/*Returns the next packet of the current burst (retransmissions first), its offset and length*/
+ArqTx_t ARQ_Next(uint16_t *seq, uint16_t *offset, uint8_t *length);
+
+/*Called at the end of every transmission (TxDone or TX timeout): the last one of a burst starts the wait for its ACK*/
+void ARQ_TxDone(void);
+
+/*Processes the ACK of the last burst and starts the next one*/
+void ARQ_Ack(uint16_t ack_base, const uint8_t *bitmap);
+
+/*Checks the ACK timeout: new burst if the ACK is lost, ARQ_TIMEOUT_LOST when the link is given up*/
+ArqTimeout_t ARQ_Timeout(void);
+
+/*Returns the first packet not acknowledged yet*/
+uint16_t ARQ_Base(void);
+
+/*Returns the offset of the first packet not acknowledged yet*/
+uint16_t ARQ_BaseOffset(void);
+
+/*Returns the data size of the first packet not acknowledged yet*/
+uint8_t ARQ_BaseSize(void);
+
+/*Returns the packets of the last acknowledged burst lost (%)*/
+uint8_t ARQ_Loss(void);
+
+/*Changes the data size of the packets from the next block and their air time*/
+void ARQ_SetPacket(uint8_t size, uint32_t air_time);
+
+/*Returns true when every packet has been acknowledged*/
+bool ARQ_Done(void);
+
+#endif /* INC_ARQ_H_ */
@@ -0,0 +1,86 @@
+/*
+ * catalog.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Catalog of the images stored in the flash, so several captures can wait to be
+ *  sent and a downlink can be resumed after a pass or a reset. There are
+ *  CATALOG_SLOTS slots: slot 0 at PHOTO_ADDR and the others at SLOT_ADDR, each one
+ *  with the photo at the beginning and its thumbnail SLOT_THUMB_OFFSET bytes after.
+ *  The catalog is stored 3 times in the data EEPROM (CATALOG_ADDR) and a copy is
+ *  kept in RAM, the entry of every slot at a fixed position:
+ *
+ *  	| magic (1) | next id (1) | entry of slot 0 | entry of slot 1 | ...
+ *
+ *  Bit n of the progress of an entry (byte n/8, LSB first) is set when the ground
+ *  has received all the bytes n*CATALOG_CHUNK to (n+1)*CATALOG_CHUNK - 1 of the photo,
+ *  in any order. The ARQ skips these chunks, so a photo sent over several passes (or
+ *  after a reset) only costs the bytes that are missing.
+ */
+
+#ifndef INC_CATALOG_H_
+#define INC_CATALOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CATALOG_SLOTS				6			//Slot 0 and the 5 slots from SLOT_ADDR
+#define CATALOG_MAGIC				0x5B		//Changes with the layout of the entries
+#define CATALOG_HEADER_SIZE			2
+#define CATALOG_CHUNK				256			//Bytes of the photo per bit of the progress
+#define CATALOG_PROGRESS_SIZE		16			//Bytes of the progress (32 KB of photo)
+
+//FLAGS
+#define CATALOG_USED				0x01		//The slot holds an image
+#define CATALOG_SENT				0x02		//The ground has received the whole photo
+
+//PRIORITIES (an image is only evicted by one of the same or higher priority)
+#define CATALOG_PRIORITY_LOW		0
+#define CATALOG_PRIORITY_NORMAL		1
+#define CATALOG_PRIORITY_HIGH		2
+
+typedef struct __attribute__((__packed__)) {
+	uint8_t flags;
+	uint8_t id;								//Id of the image in the packet headers
+	uint8_t priority;
+	uint32_t time;							//Seconds since the boot when it was stored
+	uint16_t size;							//Bytes of the photo
+	uint16_t thumb_size;					//Bytes of the thumbnail (0 => no thumbnail)
+	uint16_t crc;							//CRC-16 of the photo (ECC_CRC)
+	uint8_t progress[CATALOG_PROGRESS_SIZE];
+} CatalogEntry_t;
+
+/*Loads the catalog from the EEPROM (called once at boot)*/
+void Catalog_Init(void);
+
+/*Frees a slot for a new image (evicting one if needed), returns -1 if all the images are more important*/
+int8_t Catalog_Allocate(uint8_t priority);
+
+/*Address of the photo of a slot*/
+uint32_t Catalog_Addr(uint8_t slot);
+
+/*Stores the entry of the image written in the slot given by Catalog_Allocate, returns its id*/
+uint8_t Catalog_Commit(int8_t slot, uint16_t size, uint16_t thumb_size);
+
+/*Slots that can take a new image without losing one not sent yet*/
+uint8_t Catalog_Available(void);
+
+/*Selects the next image to send (highest priority, then oldest), NULL if all have been sent*/
+const CatalogEntry_t *Catalog_Next(void);
+
+/*Selects the image with this id (to resume its downlink), NULL if it is not stored*/
+const CatalogEntry_t *Catalog_Open(uint8_t id);
+
+/*Slot of an entry returned by Catalog_Next or Catalog_Open*/
+uint8_t Catalog_Slot(const CatalogEntry_t *entry);
+
+/*Counts bytes of the selected photo received by the ground, marking the chunks completed*/
+void Catalog_Delivered(uint16_t offset, uint8_t length);
+
+/*Writes the progress changed since the last call (once per ACK)*/
+void Catalog_Save(void);
+
+/*Marks the selected image as sent*/
+void Catalog_Sent(void);
+
+#endif /* INC_CATALOG_H_ */
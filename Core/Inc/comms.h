@@ -39,6 +39,16 @@
 #include "sx126x.h"
 #include "radio.h"
 #include "flash.h"
+#include "nvlog.h"
+#include "arq.h"
+#include "fec.h"
+#include "linkadapt.h"
+#include "packetizer.h"
+#include "thumbnail.h"
+#include "history.h"
+#include "scheduler.h"
+#include "settings.h"
+#include "catalog.h"
 #include "telecomands.h"
 
 #define RF_FREQUENCY 						868000000  	// 868 MHz
@@ -60,12 +70,14 @@
 #define RX_TIMEOUT_VALUE                 	0			//IF NEEDED
 #define BUFFER_SIZE                         30 			// Define the payload size here
 #define UPLINK_BUFFER_SIZE					15
-#define ACK_PAYLOAD_LENGTH					5			//ACK payload data length
-#define WINDOW_SIZE							40
+#define ACK_PAYLOAD_LENGTH					8			//ACK payload data length (header + base + bitmap)
+#define WINDOW_SIZE							40			//Maximum packets in flight (bits of the ACK bitmap)
+#define PHOTO_SIZE							20000		//Bytes of the photo (Image.bufferImage)
 
 //CHECK THIS DEFINITIONS (I DO NOT KNOW IF THEY ARE CORRECT OR WHICH VALUE TO USE)
 #define CAD_TIMER_TIMEOUT       1000        //Define de CAD timer's timeout here
 #define RX_TIMER_TIMEOUT        4000        //Define de CAD timer's timeout here
+#define CAD_DELAY               100         //ms between the START_CAD state and the CAD (was a blocking DelayMs)
 #define CAD_SYMBOL_NUM          LORA_CAD_02_SYMBOL
 #define CAD_DET_PEAK            22
 #define CAD_DET_MIN             10
@@ -76,16 +88,36 @@
 
 void process_telecommand(uint8_t header, uint8_t info);
 
+void radioConfig(uint8_t sf, uint8_t coding_rate);
+
 void configuration(void);
 
-void tx_function(void);
+bool preload(void);
+
+void txConfig(void);
+
+bool tx_function(void);
 
 void rx_function(void);
 
-void packaging(void);
+bool packaging(void);
+
+void openImage(const CatalogEntry_t *entry);
+
+void resetCommsParams(void);
+
+void selectData(bool thumbnail);
 
 void stateMachine(void);
 
+void startComms(void);
+
+void stopComms(void);
+
+bool isCommsRunning(void);
+
+void radioEvents(void);
+
 
 
 /*!
@@ -53,6 +53,7 @@
 
 /*COMMS*/
 #define SEND_DATA  			20	/*If the acquired photo or spectogram is needed to be send to GS*/
+#define SEND_THUMBNAIL		1	/*Info byte of SEND_DATA to send the thumbnail of the photo instead*/
 #define SEND_TELEMETRY 		21
 #define STOP_SENDING_DATA  	22
 #define ACK_DATA  			23	/*It is received when all the data is received correctly*/
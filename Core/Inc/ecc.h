@@ -0,0 +1,52 @@
+/*
+ * ecc.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Error correction of the payload data in the flash (slots of the image catalog,
+ *  telemetry history and spectrogram), which is too large to be stored 3 times.
+ *  Every 256-byte page has a 4-byte check code at ECC_ADDR:
+ *
+ *  	| valid (1 bit) | 0 (3 bits) | parity (1 bit) | syndrome (11 bits) | CRC-16 (2) |
+ *
+ *  The syndrome is the XOR of the positions (0..2047) of the bits set in the page and
+ *  the parity the XOR of all the bits (SECDED: one wrong bit is located and fixed, two
+ *  are detected), and the CRC checks the result. A code of 0 (erased) means that the
+ *  page is not protected. Multi-byte fields are big endian.
+ */
+
+#ifndef INC_ECC_H_
+#define INC_ECC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ECC_CODE_SIZE				4
+#define ECC_VALID					0x8000
+#define ECC_PARITY					0x0800
+#define ECC_SYNDROME				0x07FF
+#define ECC_SCRUB_PAGES				4			//Pages checked per call of ECC_Scrub
+
+/*Error counters*/
+typedef struct {
+	uint32_t checked;						//Pages checked by the scrubber
+	uint32_t corrected;						//Pages with one wrong bit, fixed
+	uint32_t uncorrectable;					//Pages with more errors (also in NVLOG_ECC_ERRORS)
+	uint32_t last_error;					//Address of the last page with an uncorrectable error
+} EccStats_t;
+
+/*CRC-16-CCITT of data, continuing from crc (0xFFFF to start)*/
+uint16_t ECC_CRC(uint16_t crc, const uint8_t *data, uint32_t length);
+
+/*Computes the codes of the pages of a payload range (after it has been written)*/
+void ECC_Protect(uint32_t address, uint32_t length);
+
+/*Drops the codes of a range that is going to be rewritten*/
+void ECC_Invalidate(uint32_t address, uint32_t length);
+
+/*Checks the next ECC_SCRUB_PAGES protected pages, fixing the single-bit errors*/
+void ECC_Scrub(void);
+
+void ECC_Get_Stats(EccStats_t *stats);
+
+#endif /* INC_ECC_H_ */
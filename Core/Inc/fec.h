@@ -0,0 +1,40 @@
+/*
+ * fec.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Erasure coding of the photo downlink. The data packets are grouped in blocks of
+ *  WINDOW_SIZE sequence numbers and, after the last packet of a block has been sent
+ *  for the first time, FEC_PARITY_PACKETS parity packets are sent. With them the
+ *  ground can rebuild up to FEC_PARITY_PACKETS lost packets of the block without
+ *  waiting for a retransmission.
+ *
+ *  Parity j of a block is sum(C[j][i] * data_i) over GF(256) (polynomial 0x11D), with
+ *  the Cauchy matrix C[j][i] = 1 / (j + FEC_PARITY_PACKETS + i). Every square
+ *  submatrix of C is invertible, so any FEC_PARITY_PACKETS erasures can be solved.
+ *
+ *  Parity packets: sequence number | 1 | block (11 bits) | j (4 bits) |, offset and
+ *  length of the first packet of the block (see packetizer.h). The packet i of the
+ *  block has the offset block offset + i * length. No parity is sent for a block
+ *  that skips chunks already delivered (see arq.h), as the offsets would not match.
+ */
+
+#ifndef INC_FEC_H_
+#define INC_FEC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FEC_PARITY_PACKETS			4			//Parity packets per block (0 => no FEC)
+#define FEC_PARITY_FLAG				0x8000		//Header bit of the parity packets
+
+/*Builds the GF(256) tables and starts the photo of total_bytes bytes*/
+void FEC_Init(uint16_t total_bytes);
+
+/*Adds a data packet sent for the first time to the parity of its block*/
+void FEC_Add(uint16_t seq, uint16_t offset, const uint8_t *data, uint8_t length);
+
+/*Returns true if a parity packet is ready: its id, offset, data and length*/
+bool FEC_Next(uint16_t *id, uint16_t *offset, const uint8_t **data, uint8_t *length);
+
+#endif /* INC_FEC_H_ */
@@ -12,7 +12,18 @@
 #include <stdbool.h>
 
 
-#define PHOTO_ADDR 					0x08020000
+#define PHOTO_ADDR 					0x08020000	//Slot 0 of the image catalog (catalog.c)
+#define THUMB_ADDR 					0x08028000	//Thumbnail of the photo of slot 0 (thumbnail.c)
+#define HISTORY_ADDR 				0x08030000	//Ring of telemetry history pages (history.c)
+#define HISTORY_PAGES 				64			//16 KB
+#define SPECTRUM_ADDR 				0x08034000	//Spectrogram of the RF payload (spectrum.c)
+#define SPECTRUM_SIZE 				0xE000		//56 KB (RadioFrequency.bufferRF)
+#define ECC_ADDR 					0x08042000	//Check codes of the payload pages (ecc.c)
+#define ECC_SIZE 					0x1780		//4 bytes for each of the 1504 pages protected
+#define SLOT_ADDR 					0x08044000	//Slots 1.. of the image catalog, up to the end of the flash
+#define SLOT_SIZE 					0xC000		//48 KB: photo and its thumbnail
+#define SLOT_THUMB_OFFSET 			(THUMB_ADDR - PHOTO_ADDR)	//The thumbnail after 32 KB of photo
+#define SLOT_PAGES 					960			//Pages from SLOT_ADDR to the end of the flash (5 slots)
 #define PAYLOAD_STATE_ADDR 			0x08008000
 #define COMMS_STATE_ADDR 			0x08008001
 #define DEPLOYMENT_STATE_ADDR 		0x08008002
@@ -24,7 +35,6 @@
 #define NOMINAL_ADDR 				0x08008008
 #define LOW_ADDR 					0x08008009
 #define CRITICAL_ADDR 				0x0800800A
-#define PL_TIME_ADDR 				0x0800800B
 #define PREVIOUS_STATE_ADDR			0x0800800C
 #define EXIT_LOW_ADDR 				0x0800800D
 
@@ -59,14 +69,59 @@
 #define CURRENT_ADDR 				0x08008109
 #define BATT_LEVEL_ADDR 			0x0800810A
 
+//PAYLOAD ADDRESSES
+#define PL_TIME_ADDR 				0x08008130	//8 bytes: time of TAKE_PHOTO (4) or TAKE_RF (8), after the telemetry
+
+//DATA EEPROM
+#define REDUNDANT_ADDR				0x08080000	//Values stored 3 times (+0x1555 and +0x2AAA)
+#define REDUNDANT_COPY2				0x1555		//Offset of the second copy
+#define REDUNDANT_COPY3				0x2AAA		//Offset of the third copy
+#define REDUNDANT_END_ADDR			0x08080D55	//Last address whose copies stay below NVLOG_ADDR
+#define CATALOG_ADDR				0x08080000	//Catalog of the stored images (catalog.c), redundant
+#define NVLOG_ADDR					0x08083800	//Append-only log of the comms counters (nvlog.c)
+#define NVLOG_SECTOR_SIZE			0x400		//2 sectors of 1 KB
+
+//PAGE CACHE
+#define FLASH_CACHE_PAGES			2			//Number of 256-byte pages kept in RAM
+#define FLASH_HALF_PAGE_WORDS		32			//Words programmed by a half page operation
+#define FLASH_STREAM_FULL			0x100		//Flash_Stream_Write past the capacity (not a HAL error bit)
+
+//SCRUBBING
+#define FLASH_SCRUB_QUEUE			4			//Redundant ranges waiting to be repaired
+#define FLASH_SCRUB_CHUNK			32			//Bytes voted and repaired per call of Flash_Scrub
+
+/*Flash erase/program counters*/
+typedef struct {
+	uint32_t erases;						//Pages erased
+	uint32_t programs;						//Program operations (half pages or EEPROM bytes)
+	uint32_t flushes;						//Calls to Flash_Flush
+	uint32_t repairs;						//Bytes of redundant copies rewritten by Flash_Scrub
+} FlashStats_t;
+
 uint32_t Flash_Write_Data (uint32_t StartPageAddress, uint8_t *Data, uint16_t numberofbytes);
 
+uint32_t Flash_Flush(void);
+
+void Flash_Stream_Begin(uint32_t StartPageAddress, uint32_t capacity);
+
+uint32_t Flash_Stream_Write(const uint8_t *Data, uint16_t numberofbytes);
+
+uint32_t Flash_Stream_End(void);
+
+uint32_t EEPROM_Write_Word(uint32_t Address, uint32_t Data);
+
+void Flash_Get_Stats(FlashStats_t *stats);
+
 void Write_Flash(uint32_t StartPageAddress, uint8_t *Data, uint16_t numberofbytes);
 
 void Flash_Read_Data (uint32_t StartPageAddress, uint8_t *RxBuf, uint16_t numberofbytes);
 
+const uint8_t *Flash_Map(uint32_t StartPageAddress, uint16_t numberofbytes);
+
 void Check_Redundancy(uint32_t Address, uint8_t *RxDef, uint16_t numberofbytes);
 
+bool Flash_Scrub(void);
+
 void Read_Flash(uint32_t StartPageAddress, uint8_t *RxBuf, uint16_t numberofbytes);
 
 /********************  FLASH_Error_Codes   ***********************//*
@@ -0,0 +1,52 @@
+/*
+ * history.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Telemetry history. Every HISTORY_PERIOD seconds the housekeeping snapshot (7
+ *  temperatures, voltage, current and battery level) is appended to a page in RAM,
+ *  and full pages are written to a ring of HISTORY_PAGES flash pages at HISTORY_ADDR.
+ *  Every page can be decoded on its own:
+ *
+ *  	| magic (1) | seq (2) | time (4) | HISTORY_FIELDS bytes | records ... | 0 |
+ *
+ *  	record: | dt (varint) | changed fields mask (varint) | delta (zigzag varint) ... |
+ *
+ *  time is in seconds since the boot and dt in seconds since the previous sample
+ *  (never 0, so a 0 byte ends the page). There is one delta per bit of the mask, in
+ *  field order, modulo 256. A sample without changes takes 2 bytes.
+ *
+ *  SEND_TELEMETRY sends the last pages after the snapshot, in HISTORY_PARTS packets
+ *  per page: | page seq (2) | part (1) | HISTORY_PACKET_DATA bytes of the page |
+ */
+
+#ifndef INC_HISTORY_H_
+#define INC_HISTORY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HISTORY_PERIOD				60			//Seconds between samples
+#define HISTORY_FIELDS				10			//Bytes of a sample
+#define HISTORY_MAGIC				0xA5
+#define HISTORY_PAGE_HEADER			(7 + HISTORY_FIELDS)
+#define HISTORY_HEADER_SIZE			3			//Header of the history packets
+#define HISTORY_PACKET_DATA			64			//Bytes of a page in each packet
+#define HISTORY_PARTS				(256 / HISTORY_PACKET_DATA)
+
+/*Finds the newest page of the ring*/
+void History_Init(void);
+
+/*Appends the current snapshot if HISTORY_PERIOD has elapsed, returns true if it did*/
+bool History_Sample(void);
+
+/*Writes the page being filled to the ring (it is cached until Flash_Flush)*/
+void History_Flush(void);
+
+/*Number of pages stored in the ring*/
+uint8_t History_Pages(void);
+
+/*Address and sequence number of a stored page (0 => newest)*/
+uint32_t History_Page(uint8_t back, uint16_t *seq);
+
+#endif /* INC_HISTORY_H_ */
@@ -0,0 +1,42 @@
+/*
+ * i2cqueue.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Interrupt driven I2C transactions. A batch of register reads is submitted at
+ *  once and runs in the background (HAL_I2C_Mem_Read_IT, one after the other);
+ *  when the last one ends, EVT_I2C is posted and the callback of the batch runs in
+ *  the main loop context. The CPU only handles a few interrupts per byte.
+ */
+
+#ifndef INC_I2CQUEUE_H_
+#define INC_I2CQUEUE_H_
+
+#include "stm32l1xx_hal.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define I2CQUEUE_FAST_SPEED			400000		//Hz, Fast-mode (all the parts on the bus allow it)
+#define I2CQUEUE_TIMEOUT_MS			50			//A batch still running after this is aborted
+
+typedef struct
+{
+	uint8_t address;		//Slave address (already shifted)
+	uint8_t reg;			//Register to read from
+	uint8_t *data;			//Where the bytes read are stored
+	uint8_t length;			//Bytes to read
+	bool ok;				//Set when the batch ends: false if the read failed
+}I2CTransfer_t;
+
+typedef void (*I2CCallback_t)(I2CTransfer_t *batch, uint8_t count);
+
+/*Enables the I2C interrupts and selects Fast-mode if PCLK1 allows it (call it once after MX_I2C1_Init)*/
+void I2CQueue_Init(I2C_HandleTypeDef *hi2c);
+
+/*Starts the reads of the batch, returns false if the previous batch is still running*/
+bool I2CQueue_Submit(I2CTransfer_t *batch, uint8_t count, I2CCallback_t callback);
+
+/*True while a batch is running*/
+bool I2CQueue_Busy(void);
+
+#endif /* INC_I2CQUEUE_H_ */
@@ -0,0 +1,42 @@
+/*
+ * linkadapt.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Link adaptation of the photo downlink. After every ACK, the spreading factor and
+ *  coding rate of the next burst are chosen from the SNR of the ACK and the packet
+ *  loss of the last burst: the fastest SF whose demodulation floor leaves at least
+ *  LINK_SNR_MARGIN dB, made more robust when the loss is high.
+ *
+ *  Only the downlink changes: telecommands and ACKs keep the configured SF/CR, so the
+ *  ground station must demodulate every SF on the downlink channel.
+ */
+
+#ifndef INC_LINKADAPT_H_
+#define INC_LINKADAPT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LINK_ADAPTATION				1			//0 => the configured SF/CR is always used
+#define LINK_MIN_SF					7
+#define LINK_MAX_SF					12
+#define LINK_MIN_CR					1			//4/5
+#define LINK_MAX_CR					4			//4/8
+#define LINK_SNR_MARGIN				5			//dB above the demodulation floor
+#define LINK_LOSS_HIGH				20			//% of lost packets to make the link more robust
+#define LINK_LOSS_LOW				5			//% of lost packets to allow a faster coding rate
+
+/*Starts from the configured spreading factor and coding rate*/
+void LinkAdapt_Init(uint8_t sf, uint8_t cr);
+
+/*Chooses the SF/CR of the next burst, returns true if they have changed*/
+bool LinkAdapt_Update(int8_t snr, uint8_t loss);
+
+/*Spreading factor of the next burst*/
+uint8_t LinkAdapt_SF(void);
+
+/*Coding rate of the next burst*/
+uint8_t LinkAdapt_CR(void);
+
+#endif /* INC_LINKADAPT_H_ */
@@ -36,8 +36,12 @@ extern "C" {
 #include "comms.h"
 #include "configuration.h"
 #include "sensorReadings.h"
+#include "i2cqueue.h"
+#include "ecc.h"
+#include "catalog.h"
 #include "definitions.h"
 #include "cpumodes.h"
+#include "spectrum.h"
 
 /* USER CODE END Includes */
 
@@ -0,0 +1,41 @@
+/*
+ * nvlog.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Append-only (log-structured) key/value store in the data EEPROM, used for the
+ *  values that change very often (comms counters). Every update is a single word
+ *  write instead of a page erase, and the writes rotate over two sectors.
+ */
+
+#ifndef INC_NVLOG_H_
+#define INC_NVLOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//KEYS (1..NVLOG_KEYS, 0 is never used because an erased word reads 0)
+#define NVLOG_COUNT_PACKET			1
+#define NVLOG_COUNT_WINDOW			2
+#define NVLOG_COUNT_RTX				3
+#define NVLOG_BASE_OFFSET			4			//Offset of the first photo packet not acknowledged
+#define NVLOG_BASE_SIZE				5			//Data size of that packet
+#define NVLOG_IMAGE_ID				6			//Id of the photo being sent
+#define NVLOG_ECC_ERRORS			7			//Payload pages with an uncorrectable error (ecc.c)
+#define NVLOG_KEYS					7			//At most 7 (bitmap of the keys found)
+
+#define NVLOG_BACKGROUND_WORDS		4			//Words erased per call of NVLog_Background
+
+/*Finds the active sector and the latest value of every key (called once at boot)*/
+void NVLog_Init(void);
+
+/*Returns the latest value of a key (0 if it has never been written)*/
+uint16_t NVLog_Read(uint8_t key);
+
+/*Appends a new record for the key if the value has changed*/
+uint32_t NVLog_Write(uint8_t key, uint16_t value);
+
+/*Erases a few words of the inactive sector, so the next compaction is immediate*/
+void NVLog_Background(void);
+
+#endif /* INC_NVLOG_H_ */
@@ -0,0 +1,37 @@
+/*
+ * packetizer.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Variable length packets of the photo downlink. The data size is chosen for every
+ *  block of WINDOW_SIZE packets as the longest one whose time on air, at the current
+ *  SF/BW/CR, does not exceed PKT_TARGET_TOA. Every packet says where its data goes, so
+ *  the ground can rebuild the photo whatever the order of arrival:
+ *
+ *  	| seq (2) | image id (1) | offset (2) | length (1) | CRC (2) | length bytes |
+ *
+ *  seq is the ARQ sequence number (FEC_PARITY_FLAG set for the parity packets, then
+ *  offset is the one of the first packet of the block and length its data size).
+ *  Multi-byte fields are big endian and the CRC-16/CCITT (0x1021, init 0xFFFF) covers
+ *  the first 6 bytes of the header and the data.
+ */
+
+#ifndef INC_PACKETIZER_H_
+#define INC_PACKETIZER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "radio.h"
+
+#define PKT_HEADER_SIZE				8
+#define PKT_MAX_DATA				(RADIO_TX_HALF_SIZE - PKT_HEADER_SIZE)	//A packet fits in half of the radio buffer
+#define PKT_MIN_DATA				16
+#define PKT_TARGET_TOA				500			//ms, longest time on air of a photo packet
+
+/*Returns the data size of the photo packets for the current radio configuration*/
+uint8_t Packetizer_DataSize(void);
+
+/*Writes the PKT_HEADER_SIZE bytes of header of a packet*/
+void Packetizer_Header(uint8_t *header, uint16_t seq, uint8_t image, uint16_t offset, const uint8_t *data, uint8_t length);
+
+#endif /* INC_PACKETIZER_H_ */
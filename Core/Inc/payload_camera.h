@@ -15,11 +15,23 @@
 #include <stdlib.h> //PARA GUARDAR DATOS
 //todo hacer criba de las librerias, estraer solo las funciones utiles.
 
+#define CAM_RX_RING		512		//Bytes of the circular DMA reception buffer (a page program stalls ~10 ms)
+#define CAM_TIMEOUT_MS	200		//Silence of the camera before a chunk is requested again
+#define CAM_RETRIES		3		//Requests of the same chunk before the capture is given up
+
+extern DMA_HandleTypeDef hdma_uart4_rx;
+extern DMA_HandleTypeDef hdma_uart4_tx;
 
 
 uint8_t readResponse(UART_HandleTypeDef *huart, uint8_t expLength, uint8_t attempts);
 bool runCommand(UART_HandleTypeDef *huart, uint8_t command, uint8_t *hexData, uint8_t dataArrayLength, uint8_t expLength, bool doFlush);
 
+/**
+  * #1
+  * Sets up the DMA channels of the camera UART (call it once after MX_UART4_Init)
+  */
+void cameraInit(UART_HandleTypeDef *huart);
+
 /**
   * #2
   * Takes photo and saves it in the camera memory
@@ -34,9 +46,9 @@ void getFrameLength(UART_HandleTypeDef *huart);
 
 /**
   * #4
-  * Saves the image to the flash memory of the STM32
+  * Saves the image to the flash memory of the STM32, returns false if the camera stops answering
   */
-void retrieveImage(UART_HandleTypeDef *huart);
+bool retrieveImage(UART_HandleTypeDef *huart);
 
 /**
   * #5
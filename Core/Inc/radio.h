@@ -44,51 +44,56 @@ typedef enum
 }RadioState_t;
 
 /*!
- * \brief Radio driver callback functions
+ * \brief Radio driver events, read by the application with Radio.GetEvent
+ */
+typedef enum
+{
+    RADIO_EVENT_TX_DONE = 0,
+    RADIO_EVENT_TX_TIMEOUT,
+    RADIO_EVENT_RX_DONE,
+    RADIO_EVENT_RX_TIMEOUT,
+    RADIO_EVENT_RX_ERROR,
+    RADIO_EVENT_CAD_DONE,
+}RadioEventType_t;
+
+/*!
+ * \brief Radio driver event
  */
 typedef struct
 {
+    RadioEventType_t Type;
     /*!
-     * \brief  Tx Done callback prototype.
+     * RX_DONE: received buffer pointer ( valid until the next RX_DONE event is read )
      */
-    void    ( *TxDone )( void );
+    uint8_t *Payload;
     /*!
-     * \brief  Tx Timeout callback prototype.
+     * RX_DONE: received buffer size
      */
-    void    ( *TxTimeout )( void );
+    uint16_t Size;
     /*!
-     * \brief Rx Done callback prototype.
-     *
-     * \param [IN] payload Received buffer pointer
-     * \param [IN] size    Received buffer size
-     * \param [IN] rssi    RSSI value computed while receiving the frame [dBm]
-     * \param [IN] snr     Raw SNR value given by the radio hardware
-     *                     FSK : N/A ( set to 0 )
-     *                     LoRa: SNR value in dB
+     * RX_DONE: RSSI value computed while receiving the frame [dBm]
      */
-    void    ( *RxDone )( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr );
+    int16_t Rssi;
     /*!
-     * \brief  Rx Timeout callback prototype.
+     * RX_DONE: raw SNR value given by the radio hardware
+     *          FSK : N/A ( set to 0 )
+     *          LoRa: SNR value in dB
      */
-    void    ( *RxTimeout )( void );
+    int8_t Snr;
     /*!
-     * \brief Rx Error callback prototype.
+     * CAD_DONE: channel activity detected during the CAD
      */
-    void    ( *RxError )( void );
+    bool ChannelActivityDetected;
     /*!
-     * \brief  FHSS Change Channel callback prototype.
-     *
-     * \param [IN] currentChannel   Index number of the current channel
+     * Cycle counter ( DWT ) when the interrupt occurred
      */
-    void ( *FhssChangeChannel )( uint8_t currentChannel );
+    uint32_t IrqTime;
+}RadioEvent_t;
 
-    /*!
-     * \brief CAD Done callback prototype.
-     *
-     * \param [IN] channelDetected    Channel Activity detected during the CAD
-     */
-    void ( *CadDone ) ( bool channelActivityDetected );
-}RadioEvents_t;
+/*!
+ * \brief Size of each half of the radio buffer used by Preload
+ */
+#define RADIO_TX_HALF_SIZE                          128
 
 /*!
  * \brief Radio driver definition
@@ -97,10 +102,8 @@ struct Radio_s
 {
     /*!
      * \brief Initializes the radio
-     *
-     * \param [IN] events Structure containing the driver callback functions
      */
-    void    ( *Init )( RadioEvents_t *events );
+    void    ( *Init )( void );
     /*!
      * Return current radio status
      *
@@ -253,6 +256,33 @@ struct Radio_s
      * \param [IN]: size       Buffer size
      */
     void    ( *Send )( uint8_t *buffer, uint8_t size );
+    /*!
+     * \brief Sends a header followed by a payload without copying them to a
+     *        single buffer. The payload can be read straight from the flash
+     *
+     * \param [IN]: header     Header pointer
+     * \param [IN]: headerSize Header size
+     * \param [IN]: payload    Payload pointer
+     * \param [IN]: size       Payload size
+     */
+    void    ( *SendFrom )( uint8_t *header, uint8_t headerSize, const uint8_t *payload, uint8_t size );
+    /*!
+     * \brief Writes the next packet to the half of the radio buffer that is not
+     *        being transmitted, so it can be sent as soon as the current one ends.
+     *        The packet is lost if the radio receives or sleeps before it is sent
+     *
+     * \param [IN]: header     Header pointer
+     * \param [IN]: headerSize Header size
+     * \param [IN]: payload    Payload pointer ( NULL if size is 0 )
+     * \param [IN]: size       Payload size ( headerSize + size <= RADIO_TX_HALF_SIZE )
+     */
+    void    ( *Preload )( uint8_t *header, uint8_t headerSize, const uint8_t *payload, uint8_t size );
+    /*!
+     * \brief Sends the packet written by Preload
+     *
+     * \retval sent False if there is no packet preloaded
+     */
+    bool    ( *SendPreloaded )( void );
     /*!
      * \brief Sets the radio in sleep mode
      */
@@ -340,6 +370,13 @@ struct Radio_s
      * \brief Process radio irq
      */
     void ( *IrqProcess )( void );
+    /*!
+     * \brief Reads the next radio event
+     *
+     * \param [OUT] event Event read
+     * \retval      read  False if there is no event
+     */
+    bool ( *GetEvent )( RadioEvent_t *event );
     /*
      * The next functions are available only on SX126x radios.
      */
@@ -371,4 +408,12 @@ struct Radio_s
  */
 extern const struct Radio_s Radio;
 
+/*!
+ * \brief Gets the time from the radio interrupt to the application reading its event
+ *
+ * \param [OUT] last Latency of the last event read [us]
+ * \param [OUT] max  Maximum latency since the radio initialization [us]
+ */
+void RadioGetEventLatency( uint32_t *last, uint32_t *max );
+
 #endif // __RADIO_H__
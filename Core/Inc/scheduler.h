@@ -0,0 +1,52 @@
+/*
+ * scheduler.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Run-to-completion event scheduler. The interrupts (radio DIO, timers) and the
+ *  handlers themselves post events to a queue, and the main loop dispatches them
+ *  one by one to the registered handlers. When the queue is empty the MCU sleeps
+ *  (WFI) until the next interrupt.
+ */
+
+#ifndef INC_SCHEDULER_H_
+#define INC_SCHEDULER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32l1xx_hal.h"
+
+#define SCHEDULER_QUEUE_SIZE		16			//Events waiting to be dispatched
+
+//EVENTS
+typedef enum
+{
+	EVT_RADIO,			//DIO interrupt of the SX126x (Radio.IrqProcess)
+	EVT_RADIO_EVENT,	//Radio event queued for the application (Radio.GetEvent)
+	EVT_COMMS,			//New state of the comms state machine
+	EVT_TICK,			//End of the Scheduler_Wait period
+	EVT_I2C,			//End of the I2C batch (I2CQueue_Submit)
+	EVT_COUNT,
+}Event_t;
+
+typedef void (*EventHandler_t)(void);
+
+/*Sets the function called when the event is dispatched*/
+void Scheduler_Register(Event_t event, EventHandler_t handler);
+
+/*Adds an event to the queue (it can be called from an interrupt)*/
+void Scheduler_Post(Event_t event);
+
+/*Dispatches the queued events, returns false if the queue was empty*/
+bool Scheduler_Dispatch(void);
+
+/*Dispatches the events during period ms, sleeping while there are none*/
+void Scheduler_Wait(uint32_t period);
+
+/*IWDG refreshed by Scheduler_Wait, which then sleeps in slices shorter than its window*/
+void Scheduler_Watchdog(IWDG_HandleTypeDef *hiwdg);
+
+/*Number of events lost because the queue was full*/
+uint32_t Scheduler_Overflows(void);
+
+#endif /* INC_SCHEDULER_H_ */
@@ -17,16 +17,16 @@
 #include "definitions.h"
 #include "configuration.h"
 
-/*Overwrites into the Temperatures Union the temperature of the 8 sensors*/
-void acquireTemp(I2C_HandleTypeDef *hi2c);
+/*Overwrites into the Temperatures Union the temperatures read by the last batch*/
+void acquireTemp(void);
 
-/*Overwrites into the Voltages Union the readings of the 12 voltages*/
-void acquireVoltage(I2C_HandleTypeDef *hi2c);
+/*Overwrites into the Voltages Union the voltage read by the last batch*/
+void acquireVoltage(void);
 
-/*Overwrites into the Currents Union the readings of the 7 currents*/
-void acquireCurrents(I2C_HandleTypeDef *hi2c);
+/*Overwrites into the Currents Union the current read by the last batch*/
+void acquireCurrents(void);
 
-/*Includes the functions above*/
-void sensorReadings(I2C_HandleTypeDef *hi2c);
+/*Starts the I2C batch that reads all the sensors, the functions above run when it ends*/
+void sensorReadings(void);
 
 #endif /* INC_SENSORREADINGS_H_ */
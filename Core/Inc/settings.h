@@ -0,0 +1,50 @@
+/*
+ * settings.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  RAM copy of the thresholds and configuration set by telecommand. It is loaded
+ *  once at boot and written through to the flash only when a telecommand changes
+ *  it, so the superloop reads plain variables instead of Read_Flash. Every change
+ *  increments the generation, so a consumer can skip the work when it has not moved.
+ */
+
+#ifndef INC_SETTINGS_H_
+#define INC_SETTINGS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct
+{
+	uint8_t nominal;				//Battery thresholds (NOMINAL_ADDR, LOW_ADDR, CRITICAL_ADDR)
+	uint8_t low;
+	uint8_t critical;
+	uint8_t exit_low;				//EXIT_LOW_ADDR
+	uint8_t exit_low_power;			//EXIT_LOW_POWER_FLAG_ADDR
+	uint8_t kp;
+	uint8_t gyro_res;
+	uint8_t sf;
+	uint8_t crc;
+	uint8_t photo_resol;
+	uint8_t photo_compression;
+	uint8_t f_min;					//TAKE_RF band
+	uint8_t f_max;
+	uint8_t delta_f;
+	uint8_t integration_time;
+	uint8_t pl_time[8];				//PL_TIME_ADDR: time of the payload (4 bytes photo, 8 bytes RF)
+}Settings_t;
+
+/*Reads all the settings from the flash (called once at boot)*/
+void Settings_Load(void);
+
+/*Current settings*/
+const Settings_t *Settings_Get(void);
+
+/*Incremented every time a setting changes*/
+uint32_t Settings_Generation(void);
+
+/*Write_Flash that also updates the RAM copy of the settings in the range*/
+void Settings_Write(uint32_t StartPageAddress, uint8_t *Data, uint16_t numberofbytes);
+
+#endif /* INC_SETTINGS_H_ */
@@ -0,0 +1,47 @@
+/*
+ * spectrum.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Spectrogram of the RF payload (electrosmog). The SX126x sweeps the band set by
+ *  TAKE_RF and the instantaneous RSSI of every bin is averaged, as power, during the
+ *  integration time. Every sweep is one row, written to the flash as soon as it ends,
+ *  so only one row is kept in RAM. Stored at SPECTRUM_ADDR:
+ *
+ *  	| bins (2) | f min (1) | f max (1) | delta f (1) | integration (1) | rows ... | 0 (2) |
+ *
+ *  	row: | length (2) | PackBits of the row |
+ *
+ *  f min and f max are MHz above SPECTRUM_F_BASE, delta f in SPECTRUM_F_UNIT and the
+ *  integration time in ms per bin. A row has one byte per bin: its power in dB above
+ *  SPECTRUM_DBM_MIN. Every SPECTRUM_KEY_ROWS rows the row is stored as it is, the
+ *  others as the difference (modulo 256) to the previous row; changes of up to
+ *  SPECTRUM_DEADBAND dB are dropped, so a quiet band gives long runs of zeros.
+ *  Multi-byte fields are big endian.
+ */
+
+#ifndef INC_SPECTRUM_H_
+#define INC_SPECTRUM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SPECTRUM_F_BASE				700000000	//Hz, frequency of F_MIN = 0
+#define SPECTRUM_F_UNIT				125000		//Hz, unit of DELTA_F (the LoRa bandwidth)
+#define SPECTRUM_MAX_BINS			256
+#define SPECTRUM_DBM_MIN			(-150)		//Power of the value 0 of the rows
+#define SPECTRUM_DBM_MAX			(-30)		//Stronger signals are clipped
+#define SPECTRUM_KEY_ROWS			16			//Rows between two rows stored without difference
+#define SPECTRUM_DEADBAND			1			//dB, smaller changes are not stored (noise)
+#define SPECTRUM_HEADER_SIZE		6
+
+/*Reads the TAKE_RF configuration and starts the spectrogram, returns false if it is not valid*/
+bool Spectrum_Start(void);
+
+/*Integrates the next bin (blocks during the integration time), returns false when the memory is full*/
+bool Spectrum_Step(void);
+
+/*Ends the spectrogram, returns its size in bytes*/
+uint32_t Spectrum_Stop(void);
+
+#endif /* INC_SPECTRUM_H_ */
@@ -21,11 +21,15 @@ Maintainer: Miguel Luis and Gregory Cristian
  */
 struct Spi_s
 {
-    SPI_HandleTypeDef Spi;
+    SPI_HandleTypeDef Spi;              // Must be the first member (the HAL callbacks get this handle)
     Gpio_t Mosi;
     Gpio_t Miso;
     Gpio_t Sclk;
     Gpio_t Nss;
+    DMA_HandleTypeDef DmaTx;
+    DMA_HandleTypeDef DmaRx;
+    volatile bool Busy;                 // DMA transfer in progress
+    void ( *Callback )( void );         // Called when the DMA transfer is done
 };
 
 #endif  // __SPI_MCU_H__
@@ -73,4 +73,44 @@ void SpiFrequency( Spi_t *obj, uint32_t hz );
  */
 uint16_t SpiInOut( Spi_t *obj, uint16_t outData );
 
+/*!
+ * \brief Sends a block of bytes, the received bytes are discarded. It returns
+ *        when the transfer is done
+ *
+ * \param [IN] obj     SPI object
+ * \param [IN] buffer  Bytes to be sent (can be in RAM or in the flash)
+ * \param [IN] size    Number of bytes
+ */
+void SpiOut( Spi_t *obj, const uint8_t *buffer, uint16_t size );
+
+/*!
+ * \brief Receives a block of bytes (0x00 is sent). It returns when the
+ *        transfer is done
+ *
+ * \param [IN] obj     SPI object
+ * \param [OUT] buffer Received bytes
+ * \param [IN] size    Number of bytes
+ */
+void SpiIn( Spi_t *obj, uint8_t *buffer, uint16_t size );
+
+/*!
+ * \brief Starts a DMA transfer. The interrupts stay enabled during the transfer
+ *        and callback is called from the DMA interrupt when it is done
+ *
+ * \param [IN] obj      SPI object
+ * \param [IN] tx       Bytes to be sent (NULL => 0x00 is sent)
+ * \param [OUT] rx      Received bytes (NULL => discarded)
+ * \param [IN] size     Number of bytes
+ * \param [IN] callback Function called at the end of the transfer (can be NULL)
+ * \retval status       true if the transfer has been started
+ */
+bool SpiTransfer( Spi_t *obj, const uint8_t *tx, uint8_t *rx, uint16_t size, void ( *callback )( void ) );
+
+/*!
+ * \brief Waits for the end of the current DMA transfer
+ *
+ * \param [IN] obj     SPI object
+ */
+void SpiWait( Spi_t *obj );
+
 #endif  // __SPI_H__
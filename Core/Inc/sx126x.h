@@ -759,6 +759,18 @@ uint8_t SX126xGetPayload( uint8_t *payload, uint8_t *size, uint8_t maxSize );
  */
 void SX126xSendPayload( uint8_t *payload, uint8_t size, uint32_t timeout );
 
+/*!
+ * \brief Sends a header followed by a payload, each one written straight from
+ *        where it is stored (the payload can be read from the flash)
+ *
+ * \param [in]  header        A pointer to the header to send
+ * \param [in]  headerSize    The size of the header
+ * \param [in]  payload       A pointer to the payload to send
+ * \param [in]  size          The size of the payload
+ * \param [in]  timeout       The timeout for Tx operation
+ */
+void SX126xSendPayloadFrom( uint8_t *header, uint8_t headerSize, const uint8_t *payload, uint8_t size, uint32_t timeout );
+
 /*!
  * \brief Sets the Sync Word given by index used in GFSK
  *
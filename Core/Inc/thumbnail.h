@@ -0,0 +1,38 @@
+/*
+ * thumbnail.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Thumbnail of a stored photo, so the ground can look at it before spending a pass
+ *  on the full image. The baseline JPEG of the camera is entropy decoded without any
+ *  IDCT: the DC coefficient of every 8x8 luminance block is the mean of the block, so
+ *  the thumbnail is a grey image 8 times smaller in each direction (80x60 bytes for a
+ *  640x480 photo). Only one row of blocks is kept in RAM and the huffman symbols are
+ *  read straight from the memory-mapped flash.
+ *
+ *  Stored SLOT_THUMB_OFFSET bytes after the photo, in the same slot of the catalog:
+ *
+ *  	| width (2) | height (2) | width x height bytes, row by row |
+ *
+ *  The size fields are big endian; the thumbnail is sent with THUMB_ID_FLAG set in
+ *  the image id of the packet header (see packetizer.h).
+ */
+
+#ifndef INC_THUMBNAIL_H_
+#define INC_THUMBNAIL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define THUMB_HEADER_SIZE			4
+#define THUMB_MAX_WIDTH				128			//Pixels of the thumbnail (1024 pixels of the photo)
+#define THUMB_MAX_HEIGHT			96
+#define THUMB_ID_FLAG				0x80		//Image id bit of the thumbnail packets
+
+/*Makes the thumbnail of the JPEG stored at src (at most length bytes), returns its size or 0*/
+uint16_t Thumbnail_Make(uint32_t src, uint32_t length, uint32_t dst);
+
+/*Size of the thumbnail stored at addr (0 if there is none)*/
+uint16_t Thumbnail_Size(uint32_t addr);
+
+#endif /* INC_THUMBNAIL_H_ */
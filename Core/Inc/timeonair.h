@@ -0,0 +1,30 @@
+/*
+ * timeonair.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Time on air of a LoRa packet (SX126x datasheet, section 6.1.4), without the
+ *  radio driver, so it is also built by the host tests (Host/).
+ */
+
+#ifndef INC_TIMEONAIR_H_
+#define INC_TIMEONAIR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*Modulation and packet parameters, with the values of the SX126x registers*/
+typedef struct {
+	uint8_t bandwidth;						//LORA_BW_125, LORA_BW_250 or LORA_BW_500 (4, 5, 6)
+	uint8_t spreading_factor;				//7 to 12
+	uint8_t coding_rate;					//LORA_CR_4_5 to LORA_CR_4_8 (1 to 4)
+	bool low_datarate_optimize;
+	bool crc;
+	bool fixed_length;						//Implicit header
+	uint16_t preamble;						//Symbols of preamble
+} TimeOnAirLoRa_t;
+
+/*Returns the time on air of a packet of length bytes, in ms (rounded as floor(ms + 0.999))*/
+uint32_t TimeOnAir_LoRa(const TimeOnAirLoRa_t *params, uint8_t length);
+
+#endif /* INC_TIMEONAIR_H_ */
@@ -22,11 +22,23 @@ typedef struct TimerEvent_s
 {
     uint32_t Timestamp;         //! Current timer value
     uint32_t ReloadValue;       //! Timer delay value
+    uint32_t Expiry;            //! Absolute expiry time [ms] (TimerGetCurrentTime base)
     bool IsRunning;             //! Is the timer currently running
     void ( *Callback )( void ); //! Timer IRQ callback function
-    struct TimerEvent_s *Next;  //! Pointer to the next Timer object.
+    uint8_t HeapIndex;          //! Position in the timers heap + 1 (0: not started)
 }TimerEvent_t;
 
+/*!
+ * \brief Maximum number of timers started at the same time. A timer is in the heap
+ *        at most once, so it must hold every TimerEvent_t of the firmware (8 now:
+ *        TxTimeoutTimer, RxTimeoutTimer, CalibrateSystemWakeupTimeTimer,
+ *        CADTimeoutTimer, RxAppTimeoutTimer, CadDelayTimer and the scheduler
+ *        TickTimer and SliceTimer). Can be set by the build, up to 255 (HeapIndex)
+ */
+#ifndef TIMER_HEAP_SIZE
+#define TIMER_HEAP_SIZE                             32
+#endif
+
 /*!
  * \brief Timer time variable definition
  */
@@ -107,4 +119,19 @@ TimerTime_t TimerGetFutureTime( TimerTime_t eventInFuture );
  */
 void TimerLowPowerHandler( void );
 
+/*!
+ * \brief Returns the longest time the timer module has kept the interrupts
+ *        disabled (TimerStart, TimerStop, TimerIrqHandler)
+ *
+ * \retval cycles Worst case IRQ masked time [CPU cycles]
+ */
+uint32_t TimerGetMaxCriticalCycles( void );
+
+/*!
+ * \brief Returns the number of TimerStart calls refused because the heap was full
+ *
+ * \retval count Timers that were not started (0 unless TIMER_HEAP_SIZE is too small)
+ */
+uint32_t TimerGetOverflows( void );
+
 #endif  // __TIMER_H__
@@ -0,0 +1,370 @@
+/*
+ * arq.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  The packets in flight are the ones between base (oldest not acknowledged) and
+ *  next_new (next packet never sent). There are at most WINDOW_SIZE of them, so their
+ *  state, offset and length are kept in circular arrays indexed by seq % WINDOW_SIZE.
+ *  The data size of the new packets only changes at the first packet of a block of
+ *  WINDOW_SIZE, so the ground can tell the offset of a packet rebuilt by the FEC.
+ *
+ *  The link is half duplex: the ground can only answer once the burst has been sent.
+ *  The burst length is sized from the measured round trip (end of the burst -> ACK),
+ *  so the time spent waiting for the ACK is a small part of the pass, and it is not
+ *  longer than needed so the lost packets are sent again as soon as possible. The
+ *  last packet is preloaded while the one before is on air, so the end of the burst
+ *  is only known at its TxDone (ARQ_TxDone), not when ARQ_Next runs out of packets.
+ *
+ *  next_offset never points to a delivered chunk: it jumps over them when a packet
+ *  is created, and a packet ends where the next delivered chunk starts.
+ */
+
+#include "comms.h"
+
+typedef enum
+{
+	ARQ_FREE,			//Slot not used
+	ARQ_SENT,			//Sent, waiting for the ACK
+	ARQ_LOST,			//Not received by the ground, to be sent again
+	ARQ_ACKED,			//Received by the ground
+}ArqState_t;
+
+static uint8_t state[WINDOW_SIZE];		//State of the packets in flight
+static uint16_t offsets[WINDOW_SIZE];	//Position in the photo of the packets in flight
+static uint8_t lengths[WINDOW_SIZE];	//Data size of the packets in flight
+static uint16_t base;					//Oldest packet not acknowledged
+static uint16_t next_new;				//Next packet never sent
+static uint16_t next_offset;			//Position of the next packet never sent
+static uint16_t total;					//Bytes of the photo
+static uint8_t data_size;				//Data size of the next blocks
+static uint8_t block_size;				//Data size of the current block
+static uint16_t window;					//Transmissions per burst
+static uint16_t burst;					//Transmissions left in the current burst
+static uint32_t packet_time;			//Air time of a packet (ms)
+static uint32_t srtt;					//Smoothed round trip (ms), 0 until measured
+static TimerTime_t burst_end;			//When the last packet of the burst was sent
+static bool pending_end;				//Burst over, its last packet still on air
+static bool waiting;					//Waiting for the ACK of the burst
+static uint8_t timeouts;				//Consecutive ACK timeouts
+static uint8_t loss;					//Packets of the last acknowledged burst lost (%)
+static const uint8_t *delivered = NULL;	//Bit n set if the ground has the chunk n (CATALOG_CHUNK bytes)
+static ArqDelivered_t on_delivered = NULL;
+
+static bool Delivered(uint16_t offset)
+{
+	uint16_t chunk = offset / CATALOG_CHUNK;
+	return delivered != NULL && chunk < 8*CATALOG_PROGRESS_SIZE && (delivered[chunk / 8] & (1 << (chunk % 8)));
+}
+
+static void Skip_Delivered(void)
+{
+	while (next_offset < total && Delivered(next_offset))
+	{
+		next_offset = (next_offset / CATALOG_CHUNK + 1) * CATALOG_CHUNK;
+	}
+	if (next_offset > total) next_offset = total;
+}
+
+/*Bytes from next_offset to the end of the photo or the next delivered chunk, at most limit*/
+static uint16_t Missing(uint16_t limit)
+{
+	uint32_t end = next_offset - next_offset % CATALOG_CHUNK + CATALOG_CHUNK;
+
+	while (end < total && end < (uint32_t)next_offset + limit && !Delivered(end)) end += CATALOG_CHUNK;
+	if (end > total) end = total;
+	return (end - next_offset < limit) ? end - next_offset : limit;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Window_Update                                                 		  *
+ * --------------------                                                               *
+ * Sizes the burst so the round trip is at most 1/ARQ_RTT_FACTOR of the burst time,	  *
+ * between ARQ_MIN_WINDOW and WINDOW_SIZE (the bits of the ACK bitmap)				  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+static void Window_Update(void)
+{
+	uint32_t size = WINDOW_SIZE;
+
+	if (srtt != 0 && packet_time != 0)
+	{
+		size = ARQ_RTT_FACTOR*srtt/packet_time + 1;
+		if (size < ARQ_MIN_WINDOW) size = ARQ_MIN_WINDOW;
+		if (size > WINDOW_SIZE) size = WINDOW_SIZE;
+	}
+	window = size;
+	burst = window;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  ARQ_Init                                                 		  		  *
+ * --------------------                                                               *
+ * The data size of the packets (ARQ_SetPacket) is kept								  *
+ *                                                                                    *
+ *  first: first packet to send (the packets before have already been acknowledged)	  *
+ *  first_offset: position of the first packet in the photo                           *
+ *  total_bytes: bytes of the photo					                                  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void ARQ_Init(uint16_t first, uint16_t first_offset, uint16_t total_bytes)
+{
+	for (uint8_t slot = 0; slot < WINDOW_SIZE; slot++) state[slot] = ARQ_FREE;
+	base = first;
+	next_new = first;
+	next_offset = first_offset;
+	total = total_bytes;
+	block_size = data_size;
+	waiting = false;
+	pending_end = false;
+	timeouts = 0;
+	loss = 0;
+	delivered = NULL;
+	on_delivered = NULL;
+	Window_Update();
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  ARQ_Track                                                 		  	  *
+ * --------------------                                                               *
+ * Called after ARQ_Init. The bitmap is read at every new packet, so the chunks		  *
+ * completed during the transfer are also skipped									  *
+ *                                                                                    *
+ *  bitmap: bit n (byte n/8, LSB first) set if the ground has the chunk n, or NULL	  *
+ *  callback: called for every packet acknowledged for the first time, or NULL		  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void ARQ_Track(const uint8_t *bitmap, ArqDelivered_t callback)
+{
+	delivered = bitmap;
+	on_delivered = callback;
+	Skip_Delivered();
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  ARQ_Next                                                 		  		  *
+ * --------------------                                                               *
+ * Chooses the next packet of the burst: first the lost ones, then new packets while  *
+ * they fit in the window. When the burst is over, the round trip with the ACK is	  *
+ * measured from the TxDone of its last packet (ARQ_TxDone)							  *
+ *                                                                                    *
+ *  seq: returns the sequence number of the packet	                                  *
+ *  offset: returns the position of its data in the photo                             *
+ *  length: returns the bytes of data				                                  *
+ *                                                                                    *
+ *  returns: ARQ_NEW, ARQ_RETX or ARQ_NONE if the ACK has to be received first		  *
+ *                                                                                    *
+ **************************************************************************************/
+ArqTx_t ARQ_Next(uint16_t *seq, uint16_t *offset, uint8_t *length)
+{
+	if (burst > 0)
+	{
+		for (uint16_t s = base; s < next_new; s++)
+		{
+			uint8_t slot = s % WINDOW_SIZE;
+			if (state[slot] == ARQ_LOST)
+			{
+				state[slot] = ARQ_SENT;
+				burst--;
+				*seq = s;
+				*offset = offsets[slot];
+				*length = lengths[slot];
+				return ARQ_RETX;
+			}
+		}
+		if (next_offset < total && next_new - base < window)
+		{
+			uint8_t slot = next_new % WINDOW_SIZE;
+			if (next_new % WINDOW_SIZE == 0) block_size = data_size;	//First packet of a block
+			state[slot] = ARQ_SENT;
+			offsets[slot] = next_offset;
+			lengths[slot] = Missing(block_size);
+			next_offset += lengths[slot];
+			Skip_Delivered();
+			burst--;
+			*seq = next_new++;
+			*offset = offsets[slot];
+			*length = lengths[slot];
+			return ARQ_NEW;
+		}
+	}
+
+	if (!waiting && next_new != base)
+	{
+		waiting = true;
+		pending_end = true;
+	}
+	return ARQ_NONE;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  ARQ_TxDone                                                 		  	  *
+ * --------------------                                                               *
+ * Called at the end of every transmission. The first one after the end of the		  *
+ * burst is its last packet: the round trip and the ACK timeout start there			  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void ARQ_TxDone(void)
+{
+	if (pending_end)
+	{
+		burst_end = TimerGetCurrentTime();
+		pending_end = false;
+	}
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  ARQ_Ack                                                 		  		  *
+ * --------------------                                                               *
+ * Marks the packets received and lost, slides the window and updates the round trip  *
+ * (srtt = 7/8 srtt + 1/8 sample) and the loss of the burst							  *
+ *                                                                                    *
+ *  ack_base: every packet before it has been received                                *
+ *  bitmap: bit i set if the packet ack_base + i has been received                    *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void ARQ_Ack(uint16_t ack_base, const uint8_t *bitmap)
+{
+	uint16_t sent = 0, lost = 0;
+
+	for (uint16_t s = base; s < next_new; s++)
+	{
+		uint8_t *slot = &state[s % WINDOW_SIZE];
+		uint16_t bit = s - ack_base;
+		uint8_t previous = *slot;
+
+		if (s < ack_base)
+		{
+			*slot = ARQ_ACKED;
+		}
+		else if (bit < WINDOW_SIZE)
+		{
+			if (*slot == ARQ_SENT) sent++;
+			if ((bitmap[bit/8] >> (bit%8)) & 1) *slot = ARQ_ACKED;
+			else if (*slot == ARQ_SENT)
+			{
+				*slot = ARQ_LOST;
+				lost++;
+			}
+		}
+		if (*slot == ARQ_ACKED && previous != ARQ_ACKED && on_delivered != NULL)
+		{
+			on_delivered(offsets[s % WINDOW_SIZE], lengths[s % WINDOW_SIZE]);
+		}
+	}
+	if (sent != 0) loss = 100*lost/sent;
+
+	while (base < next_new && state[base % WINDOW_SIZE] == ARQ_ACKED)
+	{
+		state[base % WINDOW_SIZE] = ARQ_FREE;
+		base++;
+	}
+
+	if (waiting && !pending_end)
+	{
+		uint32_t sample = TimerGetElapsedTime(burst_end);
+		srtt = (srtt == 0) ? sample : (7*srtt + sample)/8;
+	}
+	waiting = false;
+	pending_end = false;
+	timeouts = 0;
+	Window_Update();
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  ARQ_Timeout                                                 		  	  *
+ * --------------------                                                               *
+ * If the ACK has not arrived after max(ARQ_ACK_TIMEOUT, 2 srtt), every packet not	  *
+ * acknowledged is considered lost and a new burst starts (ARQ_MAX_TIMEOUTS times).	  *
+ * After that the link is given up: the packets stay lost, so the transfer continues *
+ * with them when it is restarted													  *
+ *                                                                                    *
+ *  returns: ARQ_TIMEOUT_RESEND if a new burst has to be sent, ARQ_TIMEOUT_LOST once  *
+ *  		 when the link is given up, ARQ_TIMEOUT_NONE otherwise					  *
+ *                                                                                    *
+ **************************************************************************************/
+ArqTimeout_t ARQ_Timeout(void)
+{
+	uint32_t timeout = (2*srtt > ARQ_ACK_TIMEOUT) ? 2*srtt : ARQ_ACK_TIMEOUT;
+
+	if (!waiting || pending_end || TimerGetElapsedTime(burst_end) < timeout)
+	{
+		return ARQ_TIMEOUT_NONE;
+	}
+
+	for (uint16_t s = base; s < next_new; s++)
+	{
+		if (state[s % WINDOW_SIZE] == ARQ_SENT) state[s % WINDOW_SIZE] = ARQ_LOST;
+	}
+	waiting = false;
+	burst = window;
+	if (timeouts >= ARQ_MAX_TIMEOUTS)
+	{
+		timeouts = 0;
+		return ARQ_TIMEOUT_LOST;
+	}
+	timeouts++;
+	return ARQ_TIMEOUT_RESEND;
+}
+
+uint16_t ARQ_Base(void)
+{
+	return base;
+}
+
+uint16_t ARQ_BaseOffset(void)
+{
+	return (base < next_new) ? offsets[base % WINDOW_SIZE] : next_offset;
+}
+
+uint8_t ARQ_BaseSize(void)
+{
+	return (base < next_new) ? lengths[base % WINDOW_SIZE] : block_size;
+}
+
+uint8_t ARQ_Loss(void)
+{
+	return loss;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  ARQ_SetPacket                                                 		  *
+ * --------------------                                                               *
+ * Changes the data size of the packets from the next block and their air time (new	  *
+ * SF/CR). The air time is used to size the next burst								  *
+ *                                                                                    *
+ *  size: bytes of data of the new packets			                                  *
+ *  air_time: air time of a packet (ms)			                                      *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void ARQ_SetPacket(uint8_t size, uint32_t air_time)
+{
+	data_size = size;
+	packet_time = air_time;
+	if (!waiting && burst == window) Window_Update();
+}
+
+bool ARQ_Done(void)
+{
+	return base == next_new && next_offset >= total;
+}
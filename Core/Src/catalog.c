@@ -0,0 +1,316 @@
+/*
+ * catalog.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Every change only writes the bytes of the entry that changed (an EEPROM byte
+ *  takes ~4 ms, 3 times), and a new entry is written before its flags, so a reset
+ *  in the middle leaves the slot free. The free slots are a bitmap in RAM.
+ *
+ *  The bytes received of every chunk of the photo being sent are counted in RAM
+ *  (each packet is acknowledged once by the ARQ), and only the progress bytes with
+ *  a new chunk completed are written, once per ACK. The counts of the chunks not
+ *  completed are lost with a reset, so those chunks are sent again.
+ */
+
+#include "catalog.h"
+#include "flash.h"
+#include "ecc.h"
+#include "nvlog.h"
+#include "timer.h"
+#include "string.h"
+#include "stddef.h"
+
+#define CATALOG_ID_MASK				0x7F		//The MSB of the id is THUMB_ID_FLAG
+
+static CatalogEntry_t entries[CATALOG_SLOTS];
+static uint8_t next_id = 0;						//Id of the next image stored
+static uint8_t used = 0;						//Bit n set if the slot n holds an image
+static int8_t selected = -1;					//Slot being sent (it is never evicted)
+static int8_t writing = -1;						//Slot given by Catalog_Allocate, not committed yet
+static uint8_t writing_priority;
+static uint16_t received[8*CATALOG_PROGRESS_SIZE];	//Bytes of every chunk of the selected photo received
+static uint16_t dirty = 0;						//Bit n set if the byte n of the progress has to be saved
+static bool dirty_flags = false;
+
+static uint32_t Entry_Addr(uint8_t slot)
+{
+	return CATALOG_ADDR + CATALOG_HEADER_SIZE + slot*sizeof(CatalogEntry_t);
+}
+
+static void Save(uint8_t slot, uint8_t offset, uint8_t length)
+{
+	Write_Flash(Entry_Addr(slot) + offset, (uint8_t *)&entries[slot] + offset, length);
+}
+
+static void Select(int8_t slot)
+{
+	if (slot != selected)
+	{
+		Catalog_Save();
+		memset(received, 0, sizeof(received));
+	}
+	selected = slot;
+}
+
+/*Images sent go first, then the lowest priority, then the oldest*/
+static bool Evict_First(const CatalogEntry_t *a, const CatalogEntry_t *b)
+{
+	bool a_sent = a->flags & CATALOG_SENT, b_sent = b->flags & CATALOG_SENT;
+
+	if (a_sent != b_sent) return a_sent;
+	if (a->priority != b->priority) return a->priority < b->priority;
+	return ((next_id - a->id) & CATALOG_ID_MASK) > ((next_id - b->id) & CATALOG_ID_MASK);
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Catalog_Init                                                 		  	  *
+ * --------------------                                                               *
+ * Loads the catalog (voted from the 3 copies). Without a valid header it is			  *
+ * created empty, and the ids continue after the last one of NVLOG_IMAGE_ID			  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void Catalog_Init(void)
+{
+	uint8_t header[CATALOG_HEADER_SIZE];
+
+	Read_Flash(CATALOG_ADDR, header, CATALOG_HEADER_SIZE);
+	Read_Flash(Entry_Addr(0), (uint8_t *)entries, sizeof(entries));
+
+	if (header[0] != CATALOG_MAGIC)
+	{
+		for (uint8_t slot = 0; slot < CATALOG_SLOTS; slot++)
+		{
+			if (entries[slot].flags == 0) continue;
+			entries[slot].flags = 0;
+			Save(slot, offsetof(CatalogEntry_t, flags), 1);
+		}
+		header[0] = CATALOG_MAGIC;
+		header[1] = (NVLog_Read(NVLOG_IMAGE_ID) + 1) & CATALOG_ID_MASK;
+		Write_Flash(CATALOG_ADDR, header, CATALOG_HEADER_SIZE);
+	}
+
+	next_id = header[1];
+	used = 0;
+	for (uint8_t slot = 0; slot < CATALOG_SLOTS; slot++)
+	{
+		if (entries[slot].flags & CATALOG_USED) used |= 1 << slot;
+	}
+	selected = -1;
+	writing = -1;
+	dirty = 0;
+	dirty_flags = false;
+}
+
+uint32_t Catalog_Addr(uint8_t slot)
+{
+	return (slot == 0) ? PHOTO_ADDR : SLOT_ADDR + (uint32_t)(slot - 1)*SLOT_SIZE;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Catalog_Allocate                                                 		  *
+ * --------------------                                                               *
+ * Takes a free slot or evicts the image chosen by Evict_First, unless it is being	  *
+ * sent or it has not been sent and has a higher priority. The slot stays free in	  *
+ * the catalog until Catalog_Commit (a failed capture can use it again)				  *
+ *                                                                                    *
+ *  priority: priority of the new image				                                  *
+ *                                                                                    *
+ *  returns: slot for the new image, -1 if none can be freed                         *
+ *                                                                                    *
+ **************************************************************************************/
+int8_t Catalog_Allocate(uint8_t priority)
+{
+	uint8_t free = ~used & ((1 << CATALOG_SLOTS) - 1);
+	int8_t victim = -1;
+
+	writing_priority = priority;
+	if (writing >= 0) return writing;
+
+	if (free != 0)
+	{
+		writing = __builtin_ctz(free);
+		return writing;
+	}
+
+	for (uint8_t slot = 0; slot < CATALOG_SLOTS; slot++)
+	{
+		if (slot == selected) continue;
+		if (victim < 0 || Evict_First(&entries[slot], &entries[victim])) victim = slot;
+	}
+	if (victim < 0) return -1;
+	if (!(entries[victim].flags & CATALOG_SENT) && entries[victim].priority > priority) return -1;
+
+	entries[victim].flags = 0;
+	Save(victim, offsetof(CatalogEntry_t, flags), 1);
+	used &= ~(1 << victim);
+	writing = victim;
+	return writing;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Catalog_Commit                                                 		  *
+ * --------------------                                                               *
+ *  slot: slot returned by Catalog_Allocate			                                  *
+ *  size: bytes of the photo						                                  *
+ *  thumb_size: bytes of the thumbnail (0 if there is none)                           *
+ *                                                                                    *
+ *  returns: id of the new image                                                      *
+ *                                                                                    *
+ **************************************************************************************/
+uint8_t Catalog_Commit(int8_t slot, uint16_t size, uint16_t thumb_size)
+{
+	if (slot < 0 || slot != writing) return 0;
+
+	CatalogEntry_t *entry = &entries[slot];
+	const uint8_t *photo = Flash_Map(Catalog_Addr(slot), size);
+
+	entry->id = next_id;
+	entry->priority = writing_priority;
+	entry->time = TimerGetCurrentTime() / 1000;		//RTC: the SysTick stops in the scheduler sleep
+	entry->size = size;
+	entry->thumb_size = thumb_size;
+	entry->crc = (photo != NULL) ? ECC_CRC(0xFFFF, photo, size) : 0;
+	memset(entry->progress, 0, CATALOG_PROGRESS_SIZE);
+	Save(slot, 1, sizeof(CatalogEntry_t) - 1);
+	entry->flags = CATALOG_USED;
+	Save(slot, offsetof(CatalogEntry_t, flags), 1);
+
+	next_id = (next_id + 1) & CATALOG_ID_MASK;
+	Write_Flash(CATALOG_ADDR + 1, &next_id, 1);
+	used |= 1 << slot;
+	writing = -1;
+	return entry->id;
+}
+
+uint8_t Catalog_Available(void)
+{
+	uint8_t available = 0;
+
+	for (uint8_t slot = 0; slot < CATALOG_SLOTS; slot++)
+	{
+		if (!(used & (1 << slot)) || ((entries[slot].flags & CATALOG_SENT) && slot != selected)) available++;
+	}
+	return available;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Catalog_Next                                                 		  	  *
+ * --------------------                                                               *
+ *  returns: entry of the image not sent with the highest priority (the oldest of	  *
+ *  		 them), NULL if there is none											  *
+ *                                                                                    *
+ **************************************************************************************/
+const CatalogEntry_t *Catalog_Next(void)
+{
+	int8_t next = -1;
+
+	for (uint8_t slot = 0; slot < CATALOG_SLOTS; slot++)
+	{
+		const CatalogEntry_t *entry = &entries[slot];
+		if (!(used & (1 << slot)) || (entry->flags & CATALOG_SENT)) continue;
+		if (next < 0 || entry->priority > entries[next].priority
+				|| (entry->priority == entries[next].priority && !Evict_First(&entries[next], entry)))
+		{
+			next = slot;
+		}
+	}
+	Select(next);
+	return (next < 0) ? NULL : &entries[next];
+}
+
+const CatalogEntry_t *Catalog_Open(uint8_t id)
+{
+	for (uint8_t slot = 0; slot < CATALOG_SLOTS; slot++)
+	{
+		if ((used & (1 << slot)) && entries[slot].id == (id & CATALOG_ID_MASK))
+		{
+			Select(slot);
+			return &entries[slot];
+		}
+	}
+	return NULL;
+}
+
+uint8_t Catalog_Slot(const CatalogEntry_t *entry)
+{
+	return entry - entries;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Catalog_Delivered                                                 	  *
+ * --------------------                                                               *
+ * Adds the bytes of a packet acknowledged for the first time to the chunks it		  *
+ * covers. When every chunk is complete the image is marked as sent					  *
+ *                                                                                    *
+ *  offset: position of the packet in the photo		                                  *
+ *  length: bytes of data of the packet				                                  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void Catalog_Delivered(uint16_t offset, uint8_t length)
+{
+	if (selected < 0) return;
+
+	CatalogEntry_t *entry = &entries[selected];
+	uint32_t end = (uint32_t)offset + length;
+	uint16_t chunks = (entry->size + CATALOG_CHUNK - 1) / CATALOG_CHUNK;
+	bool complete = true;
+
+	if (end > entry->size) end = entry->size;
+	if (chunks > 8*CATALOG_PROGRESS_SIZE) chunks = 8*CATALOG_PROGRESS_SIZE;
+
+	while (offset < end)
+	{
+		uint16_t chunk = offset / CATALOG_CHUNK;
+		uint32_t chunk_end = (uint32_t)(chunk + 1)*CATALOG_CHUNK;
+		if (chunk >= chunks) break;
+		if (chunk_end > entry->size) chunk_end = entry->size;
+		uint16_t bytes = ((end < chunk_end) ? end : chunk_end) - offset;
+
+		received[chunk] += bytes;
+		if (received[chunk] >= chunk_end - chunk*CATALOG_CHUNK && !(entry->progress[chunk / 8] & (1 << (chunk % 8))))
+		{
+			entry->progress[chunk / 8] |= 1 << (chunk % 8);
+			dirty |= 1 << (chunk / 8);
+		}
+		offset += bytes;
+	}
+
+	for (uint16_t chunk = 0; chunk < chunks && complete; chunk++)
+	{
+		complete = entry->progress[chunk / 8] & (1 << (chunk % 8));
+	}
+	if (complete && !(entry->flags & CATALOG_SENT))
+	{
+		entry->flags |= CATALOG_SENT;
+		dirty_flags = true;
+	}
+}
+
+void Catalog_Save(void)
+{
+	if (selected < 0) return;
+
+	for (uint8_t n = 0; dirty != 0; n++, dirty >>= 1)
+	{
+		if (dirty & 1) Save(selected, offsetof(CatalogEntry_t, progress) + n, 1);
+	}
+	if (dirty_flags) Save(selected, offsetof(CatalogEntry_t, flags), 1);
+	dirty_flags = false;
+}
+
+void Catalog_Sent(void)
+{
+	if (selected < 0 || (entries[selected].flags & CATALOG_SENT)) return;
+	entries[selected].flags |= CATALOG_SENT;
+	Save(selected, offsetof(CatalogEntry_t, flags), 1);
+}
@@ -28,39 +28,50 @@
 /*------TO DO----------*/
 /*
  * MULTY THREAD
- * MATRIX OF REED-SOLOMON => FADING IN SEVERAL PACKETS
  * Airtime timer
  *
  */
 
-static RadioEvents_t RadioEvents;	//To handle Radio library functions
-
-uint32_t air_time;					//LoRa air time value
+uint32_t air_time;					//LoRa air time of the longest packet
+uint8_t base_sf;					//Spreading factor configured (telecommands, ACKs and telemetry)
+uint8_t base_cr;					//Coding rate configured
+uint32_t settings_generation = 0;	//Settings_Generation() when base_sf/base_cr were read
+uint8_t radio_sf = 0;				//Spreading factor of the radio now (0 => not configured)
+uint8_t radio_cr = 0;				//Coding rate of the radio now
 uint8_t Buffer[BUFFER_SIZE];		//Buffer to store received packets or the next packet to transit
+const uint8_t *tx_data = NULL;		//Photo data sent straight from the flash after the header in Buffer (NULL => whole Buffer)
+uint8_t tx_length = 0;				//Bytes of tx_data
+uint8_t tx_header = PKT_HEADER_SIZE;	//Bytes of Buffer sent before tx_data
+uint8_t photo_data[PKT_MAX_DATA];	//Photo data copied from the flash cache when it cannot be mapped
+bool preload_telemetry = false;		//True if the packet preloaded in the radio is a telemetry packet
 
 uint8_t calib_packets = 0;			//Counter of the calibration packets received
 uint8_t tle_packets = 0;			//Counter of the tle packets received
 uint8_t telemetry_packets = 0;		//Counter of telemetry packets sent
+uint16_t history_packets = 0;		//History packets left to send after the telemetry (HISTORY_PARTS per page)
 
 
 /*
  * To avoid the variables being erased if a reset occurs, we have to store them in the Flash memory
  * Therefore, they have to be declared as a single-element array
  */
-uint8_t count_packet[] = {0};		//To count how many packets have been sent (maximum WINDOW_SIZE)
-uint8_t count_window[] = {0};		//To count the window number
+uint8_t count_packet[] = {0};		//First packet not acknowledged, inside its window (maximum WINDOW_SIZE)
+uint8_t count_window[] = {0};		//Window of the first packet not acknowledged
 uint8_t count_rtx[] = {0};			//To count the number of retransmitted packets
+uint8_t image_id[] = {0};			//Id of the photo being sent (in the header of its packets)
+const CatalogEntry_t *image = NULL;	//Entry of the image being sent (NULL => none)
+uint32_t image_addr = PHOTO_ADDR;	//Photo of the image being sent (its thumbnail is SLOT_THUMB_OFFSET after)
+uint16_t image_size = PHOTO_SIZE;	//Bytes of the photo being sent
+uint32_t data_addr = PHOTO_ADDR;	//Data being sent: the photo or its thumbnail
+uint16_t data_size = PHOTO_SIZE;	//Bytes of the data being sent
+uint8_t data_flag = 0;				//THUMB_ID_FLAG when the thumbnail is sent
 
 uint8_t i = 0;						//variable for loops
 uint8_t j=0;						//variable for loops
 uint8_t k=0;						//variable for loops
 
-uint64_t ack;						//Information rx in the ACK (0 => ack, 1 => nack)
-uint8_t nack_number;				//Number of the current packet to retransmit
-bool nack;							//True when retransmission necessary
-bool full_window;					//Stop & wait => to know when we reach the limit packet of the window
-bool statemach = true;				//If true, comms workflow follows the state machine. This value should be controlled by OBC
-									//Put true before activating the statemachine thread. Put false before ending comms thread
+bool statemach = false;				//If true, comms workflow follows the state machine. This value should be controlled by OBC
+									//Set by startComms, cleared by stopComms
 
 
 bool send_data = false;				//If true, the state machine send packets every airtime
@@ -82,6 +93,7 @@ typedef enum
     TX,
     TX_TIMEOUT,
     START_CAD,
+    CAD,
 }States_t;
 
 //Possible CAD events
@@ -108,48 +120,99 @@ uint16_t BufferSize = BUFFER_SIZE;		//Buffer size
 //TIMERS
 TimerEvent_t CADTimeoutTimer;			//CAD timer
 TimerEvent_t RxAppTimeoutTimer;			//Reception Timer
+TimerEvent_t CadDelayTimer;				//Delay before the next CAD
+
+static void CadDelayTimerIrq( void );
 
 
 /**************************************************************************************
  *                                                                                    *
- * 	Function:  configuration		                                                  *
+ * 	Function:  radioConfig			                                                  *
  * 	--------------------                                                              *
- * 	function to configure the transceiver and the transmission protocol parameters    *
+ * 	configures the LoRa modulation of the transceiver and computes its air time. 	  *
+ * 	TX and RX share the modulation, so the RX is configured too. Nothing is done if	  *
+ * 	the radio already uses that spreading factor and coding rate					  *
+ *                                                                                    *
+ *  sf: spreading factor (7 to 12)				                                      *
+ *  coding_rate: coding rate										                  *
  *                                                                                    *
  *  returns: nothing									                              *
  *                                                                                    *
  **************************************************************************************/
-void configuration(void){
-
-	Radio.Init( &RadioEvents );
-
-	Radio.SetChannel( RF_FREQUENCY );
-
-	uint8_t sf;
-	Read_Flash(SF_ADDR, &sf, 1);
-	uint8_t coding_rate;
-	Read_Flash(CRC_ADDR, &coding_rate, 1);
+void radioConfig(uint8_t sf, uint8_t coding_rate){
+	if (sf == radio_sf && coding_rate == radio_cr){
+		return;
+	}
 
 	Radio.SetTxConfig( MODEM_LORA, TX_OUTPUT_POWER, 0, LORA_BANDWIDTH, sf, coding_rate,
 								   LORA_PREAMBLE_LENGTH, LORA_FIX_LENGTH_PAYLOAD_ON,
 								   true, 0, 0, LORA_IQ_INVERSION_ON, TX_TIMEOUT_VALUE );	//In the original example it was 3000
 
+	//Air time calculus
+	air_time = Radio.TimeOnAir( MODEM_LORA , RADIO_TX_HALF_SIZE );
+	if (2*air_time > TX_TIMEOUT_VALUE){		//Slow SF: the TX timeout has to be longer than the packet
+		Radio.SetTxConfig( MODEM_LORA, TX_OUTPUT_POWER, 0, LORA_BANDWIDTH, sf, coding_rate,
+									   LORA_PREAMBLE_LENGTH, LORA_FIX_LENGTH_PAYLOAD_ON,
+									   true, 0, 0, LORA_IQ_INVERSION_ON, 2*air_time );
+	}
 
 	//SHALL WE CARE ABOUT THE RX TIMEOUT VALUE??? IF YES, CHANGE IT IN SetRx FUNCTION
 	Radio.SetRxConfig( MODEM_LORA, LORA_BANDWIDTH, sf, coding_rate, 0, LORA_PREAMBLE_LENGTH,
 								   LORA_SYMBOL_TIMEOUT, LORA_FIX_LENGTH_PAYLOAD_ON,
 								   0, true, 0, 0, LORA_IQ_INVERSION_ON, true );
 
+	radio_sf = sf;
+	radio_cr = coding_rate;
+}
 
+/**************************************************************************************
+ *                                                                                    *
+ * 	Function:  configuration		                                                  *
+ * 	--------------------                                                              *
+ * 	function to configure the transceiver and the transmission protocol parameters    *
+ *                                                                                    *
+ *  returns: nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void configuration(void){
 
-	//Air time calculus
-	air_time = Radio.TimeOnAir( MODEM_LORA , PACKET_LENGTH );
+	Radio.Init( );
+
+	Radio.SetChannel( RF_FREQUENCY );
+
+	base_sf = Settings_Get()->sf;
+	base_cr = Settings_Get()->crc;
+	settings_generation = Settings_Generation();
 
-	Flash_Read_Data( COUNT_PACKET_ADDR , &count_packet , sizeof(count_packet) );	//Read from Flash count_packet
-	Flash_Read_Data( COUNT_WINDOW_ADDR , &count_window , sizeof(count_window) ); 	//Read from Flash count_window
-	Flash_Read_Data( COUNT_RTX_ADDR , &count_rtx , sizeof(count_rtx) ); 			//Read from Flash count_rtx
-	ack = 0xFFFFFFFFFFFFFFFF;														//Initially confifured 111..111
-	nack = false;
+	radio_sf = 0;
+	radioConfig( base_sf, base_cr );
+	LinkAdapt_Init( base_sf, base_cr );
+
+	count_packet[0] = NVLog_Read( NVLOG_COUNT_PACKET );	//Read from the EEPROM log count_packet
+	count_window[0] = NVLog_Read( NVLOG_COUNT_WINDOW );	//Read from the EEPROM log count_window
+	count_rtx[0] = NVLog_Read( NVLOG_COUNT_RTX );		//Read from the EEPROM log count_rtx
+	image_id[0] = NVLog_Read( NVLOG_IMAGE_ID );
+	image = Catalog_Open( image_id[0] );				//Same image as before the reset, if it is still stored
+	uint8_t size = NVLog_Read( NVLOG_BASE_SIZE );		//Same data size as before the reset, so the sequence numbers keep their offset
+	if (size == 0){
+		size = Packetizer_DataSize();
+	}
+	ARQ_SetPacket( size, Radio.TimeOnAir( MODEM_LORA, PKT_HEADER_SIZE + size ) );
+	if (image != NULL && data_flag != 0){			//The last pass sent the thumbnail: the counters are not the ones of the photo
+		openImage( image );								//The photo starts again, without the chunks already delivered
+	}
+	else{
+		if (image != NULL){
+			image_addr = data_addr = Catalog_Addr( Catalog_Slot( image ) );
+			image_size = data_size = image->size;
+		}
+		data_flag = 0;
+		ARQ_Init( count_window[0]*WINDOW_SIZE + count_packet[0], NVLog_Read( NVLOG_BASE_OFFSET ), data_size );	//Resume after the last packet acknowledged
+		if (image != NULL){
+			ARQ_Track( image->progress, Catalog_Delivered );	//Nor the chunks received out of order
+		}
+		FEC_Init( data_size );
+	}
 	State = RX;
 
 };
@@ -157,23 +220,78 @@ void configuration(void){
 
 /**************************************************************************************
  *                                                                                    *
- * 	Function:  tx_function			                                                  *
+ * 	Function:  preload				                                                  *
+ * 	--------------------                                                              *
+ * 	packages the next packet and writes it to the free half of the radio buffer		  *
+ * 																					  *
+ *  returns: false if there is nothing to send until the next ACK                     *
+ *                                                                                    *
+ **************************************************************************************/
+bool preload(void){
+	if (!packaging())
+	{
+		return false;
+	}
+	preload_telemetry = send_telemetry;		//Cleared by packaging once the telemetry is over
+	if (tx_data != NULL)
+	{
+		Radio.Preload( Buffer, tx_header, tx_data, tx_length );	//No copy of the photo data to RAM
+	}
+	else
+	{
+		Radio.Preload( Buffer, BUFFER_SIZE, NULL, 0 );
+	}
+	return true;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * 	Function:  txConfig				                                                  *
  * 	--------------------                                                              *
- * 	function to transmit the next packet											  *
+ * 	configures the SF/CR of the preloaded packet: the configured ones for telemetry,  *
+ * 	the ones of the link adaptation for the photo									  *
  * 																					  *
  *  returns: nothing									                              *
  *                                                                                    *
  **************************************************************************************/
-void tx_function(void){
-	//configuration();
-	if (!full_window)
+void txConfig(void){
+	if (preload_telemetry){
+		radioConfig( base_sf, base_cr );
+	}
+	else{
+		radioConfig( LinkAdapt_SF(), LinkAdapt_CR() );	//Photo bursts use the SF/CR of the link adaptation
+	}
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * 	Function:  tx_function			                                                  *
+ * 	--------------------                                                              *
+ * 	function to transmit the next packet. It is already in the radio buffer			  *
+ * 	(preloaded while the previous one was on air) except for the first of a burst,	  *
+ * 	and the following one is preloaded while this one is on air						  *
+ * 																					  *
+ *  returns: false if there is nothing to send until the next ACK                     *
+ *                                                                                    *
+ **************************************************************************************/
+bool tx_function(void){
+	txConfig();
+	if (!Radio.SendPreloaded())
 	{
-		packaging(); //Start the TX by packaging all the data that will be transmitted
-		Radio.Send( Buffer, BUFFER_SIZE );
-		Flash_Write_Data( COUNT_PACKET_ADDR , &count_packet , sizeof(count_packet) );	//Read from Flash count_packet
-		Flash_Write_Data( COUNT_WINDOW_ADDR , &count_window , sizeof(count_window) ); 	//Read from Flash count_window
-		Flash_Write_Data( COUNT_RTX_ADDR , &count_rtx , sizeof(count_rtx) ); 			//Read from Flash count_rtx
+		if (!preload())		//First packet of the burst
+		{
+			return false;
+		}
+		txConfig();
+		Radio.SendPreloaded();
 	}
+	preload();				//Next packet, while this one is on air
+	NVLog_Write( NVLOG_COUNT_PACKET , count_packet[0] );	//One word appended only if the value changed
+	NVLog_Write( NVLOG_COUNT_WINDOW , count_window[0] );
+	NVLog_Write( NVLOG_COUNT_RTX , count_rtx[0] );
+	NVLog_Write( NVLOG_BASE_OFFSET , ARQ_BaseOffset() );
+	NVLog_Write( NVLOG_BASE_SIZE , ARQ_BaseSize() );
+	return true;
 };
 
 
@@ -195,103 +313,176 @@ void rx_function(void){
  *                                                                                    *
  * 	Function:  packaging                                                   			  *
  * --------------------                                                               *
- * 	to store in Buffer the next packet to send (taking into account that it could be  *
- * 	data coming from the payload, telemetry or a retransmission of a packet from the  *
- * 	last windows																	  *
+ * 	to store in Buffer the next packet to send (telemetry, or the packet of the photo  *
+ * 	chosen by the ARQ: a lost packet or a new one, or a parity packet of the FEC)	  *
+ * 	Photo packets: | header (PKT_HEADER_SIZE bytes) | tx_length bytes |				  *
+ * 	Only the header is stored in Buffer, tx_data points to the photo in the flash	  *
  *                                                                                    *
- *  returns: nothing									                              *
+ *  returns: false if there is nothing to send until the next ACK                     *
  *                                                                                    *
  **************************************************************************************/
-void packaging(void){
-	if (nack)	//NACK packets are sent at the beginning of the next window
-	{
-		while(i<sizeof(ack))
-		{
-			//function to obtain the packets to retx
-			if(!((ack >> i) & 1)) //When position of the ack & 1 != 1 --> its a 0 --> NACK
-			{
-				nack_number = i;	//Current packet to rtx
-				//Packet from last window => count_window - 1
-				Flash_Read_Data( PHOTO_ADDR + (count_window[0]-1)*WINDOW_SIZE*BUFFER_SIZE + (nack_number)*BUFFER_SIZE , &Buffer , sizeof(Buffer) );	//Direction in HEX
-				count_rtx[0]++;
-				i++;
-				break;	//Exits the while when the we find a packet to rtx
-			}
-			i++;
-		}
-		if (i==sizeof(ack)){
-			i=0;
-			ack = 0xFFFFFFFFFFFFFFFF;
-			nack = false;
-		}
-	}
-	else if (send_telemetry){
+bool packaging(void){
+	tx_data = NULL;
+	tx_header = PKT_HEADER_SIZE;
+	if (send_telemetry && telemetry_packets < num_telemetry){
 		Flash_Read_Data( TELEMETRY_ADDR + telemetry_packets*(UPLINK_BUFFER_SIZE-1) , &Buffer , sizeof(Buffer) );
-		Radio.Send( Buffer, BUFFER_SIZE );
 		telemetry_packets++;
-		if (telemetry_packets == num_telemetry){
-			send_telemetry = false;
+		return true;
+	}
+	else if (send_telemetry && history_packets > 0){	//History pages, the oldest first
+		uint16_t seq;
+		uint8_t part = (history_packets - 1) % HISTORY_PARTS;
+		uint32_t addr = History_Page( (history_packets - 1) / HISTORY_PARTS, &seq ) + (HISTORY_PARTS - 1 - part)*HISTORY_PACKET_DATA;
+		Buffer[0] = seq >> 8;
+		Buffer[1] = seq & 0xFF;
+		Buffer[2] = HISTORY_PARTS - 1 - part;
+		tx_header = HISTORY_HEADER_SIZE;
+		tx_length = HISTORY_PACKET_DATA;
+		tx_data = Flash_Map( addr , tx_length );
+		if (tx_data == NULL)
+		{
+			Flash_Read_Data( addr , photo_data , tx_length );
+			tx_data = photo_data;
 		}
+		history_packets--;
+		return true;
+	}
+	send_telemetry = false;	//Not with the last packet: the TX state still has to send it from the radio buffer
+	if (!send_data){		//Telemetry only: no photo packet after it
+		return false;
 	}
-	else //no NACKS nor telemetry
+	else //photo data (retransmissions are interleaved by the ARQ)
 	{
-		Flash_Read_Data( PHOTO_ADDR + count_window[0]*WINDOW_SIZE*BUFFER_SIZE + (count_packet[0]-count_rtx[0])*BUFFER_SIZE , &Buffer , sizeof(Buffer) );	//Direction in HEX
-		if (count_packet[0] < WINDOW_SIZE - 1)
+		uint16_t seq, offset;
+		ArqTx_t tx;
+
+		if (FEC_Next(&seq, &offset, &tx_data, &tx_length))	//Parity packets go right after the last packet of a block
+		{
+			Packetizer_Header( Buffer, seq, (image_id[0] & ~THUMB_ID_FLAG) | data_flag, offset, tx_data, tx_length );
+			return true;
+		}
+
+		tx = ARQ_Next(&seq, &offset, &tx_length);
+		if (tx == ARQ_NONE)
+		{
+			return false;
+		}
+		if (tx == ARQ_RETX)
+		{
+			count_rtx[0]++;
+		}
+		tx_data = Flash_Map( data_addr + offset , tx_length );
+		if (tx_data == NULL)	//The cached page could not be committed: copy it from the cache
 		{
-			count_packet[0]++;
+			Flash_Read_Data( data_addr + offset , photo_data , tx_length );	//Direction in HEX
+			tx_data = photo_data;
 		}
-		else
+		Packetizer_Header( Buffer, seq, (image_id[0] & ~THUMB_ID_FLAG) | data_flag, offset, tx_data, tx_length );
+		if (tx == ARQ_NEW)
 		{
-			count_packet[0] = 0;
-			count_window[0]++;
-			full_window = true;
+			FEC_Add(seq, offset, tx_data, tx_length);
 		}
+		return true;
 	}
 };
 
+/**************************************************************************************
+ *                                                                                    *
+ * 	Function:  openImage                                                              *
+ * 	--------------------                                                              *
+ * 	Starts sending the photo of an entry of the catalog. The chunks that the ground	  *
+ * 	already received in a previous pass are skipped									  *
+ *                                                                                    *
+ *  entry: image to send (from Catalog_Next or Catalog_Open)                          *
+ *                                                                                    *
+ *  returns: nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void openImage(const CatalogEntry_t *entry){
+	image = entry;
+	image_id[0] = entry->id;
+	NVLog_Write( NVLOG_IMAGE_ID , image_id[0] );
+	image_addr = Catalog_Addr( Catalog_Slot( entry ) );
+	image_size = entry->size;
+	data_addr = image_addr;
+	data_size = image_size;
+	data_flag = 0;
+	count_packet[0] = 0;
+	count_window[0] = 0;
+	count_rtx[0] 	= 0;
+	ARQ_Init( 0, 0, image_size );
+	ARQ_Track( entry->progress, Catalog_Delivered );
+	FEC_Init( image_size );
+}
+
 /**************************************************************************************
  *                                                                                    *
  * 	Function:  resetCommsParams                                                       *
  * 	--------------------                                                              *
- * 	This function is called when a new photo is stored in the last photo position,	  *
- * 	and we have to send the new photo (the old one is not necessary, otherwise we 	  *
- * 	would have not received a send photo telecommand)								  *																					      *
+ * 	This function is called when a new photo is stored in the catalog. The photo	  *
+ * 	being sent is finished first; otherwise the next one of the catalog (highest	  *
+ * 	priority, then oldest) is selected												  *
  *                                                                                    *
  *  returns: nothing									                              *
  *                                                                                    *
  **************************************************************************************/
 void resetCommsParams(void){
+	if (send_data && !ARQ_Done()){
+		return;
+	}
+	const CatalogEntry_t *next = Catalog_Next();
+	if (next != NULL){
+		openImage( next );
+	}
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * 	Function:  selectData	                                                          *
+ * 	--------------------                                                              *
+ * 	Chooses between the photo and its thumbnail for the next SEND_DATA. When the	  *
+ * 	choice changes the transfer starts again from the first packet					  *
+ *                                                                                    *
+ *  thumbnail: true to send the thumbnail (if there is one)                           *
+ *                                                                                    *
+ *  returns: nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void selectData(bool thumbnail){
+	uint16_t size = thumbnail ? Thumbnail_Size( image_addr + SLOT_THUMB_OFFSET ) : image_size;
+	if (size == 0){		//No thumbnail of this photo
+		size = image_size;
+		thumbnail = false;
+	}
+	if ((data_flag != 0) == thumbnail){
+		return;
+	}
+	data_addr = thumbnail ? image_addr + SLOT_THUMB_OFFSET : image_addr;
+	data_size = size;
+	data_flag = thumbnail ? THUMB_ID_FLAG : 0;
 	count_packet[0] = 0;
 	count_window[0] = 0;
-	count_rtx[0] 	= 0;
+	ARQ_Init( 0, 0, data_size );
+	if (!thumbnail){
+		ARQ_Track( image->progress, Catalog_Delivered );	//The delivery of the thumbnail is not stored
+	}
+	FEC_Init( data_size );
 }
 
 /**************************************************************************************
  *                                                                                    *
- * 	Function:  stateMachine			                                                  *
+ * 	Function:  startComms			                                                  *
  * 	--------------------                                                              *
- * 	communication process state machine												  *
- * 	States:																			  *
- * 	- RX_TIMEOUT: when the reception ends 											  *
- * 	- RX_ERROR: when an error in the reception process occurs						  *
- * 	- RX: when a packet has been received											  *
- * 	- TX: to transmit a packet														  *
- * 	- TX_TIMEOUT: when the transmission ends										  *
- * 	- START_CAD: to detect channel activity (necessary to receive packets correctly)  *
- * 	- LOWPOWER: when the transceiver is not transmitting nor receiving				  *
+ * 	configures the radio and starts the communication state machine. It does not	  *
+ * 	block: the state machine runs from the scheduler events (EVT_COMMS, EVT_RADIO)	  *
  * 																				      *
  *  returns: nothing									                              *
  *                                                                                    *
  **************************************************************************************/
-void stateMachine(void){
-    uint16_t PacketCnt = 0;
-
-    RadioEvents.TxDone = OnTxDone;
-    RadioEvents.RxDone = OnRxDone;
-    RadioEvents.TxTimeout = OnTxTimeout;
-    RadioEvents.RxTimeout = OnRxTimeout;
-    RadioEvents.RxError = OnRxError;
-    RadioEvents.CadDone = OnCadDone;
+void startComms(void){
+    Scheduler_Register( EVT_RADIO, Radio.IrqProcess );
+    Scheduler_Register( EVT_RADIO_EVENT, radioEvents );
+    Scheduler_Register( EVT_COMMS, stateMachine );
 
     //Timer used to restart the CAD
     TimerInit( &CADTimeoutTimer, CADTimeoutTimeoutIrq );
@@ -301,121 +492,240 @@ void stateMachine(void){
     TimerInit( &RxAppTimeoutTimer, RxTimeoutTimerIrq );
     TimerSetValue( &RxAppTimeoutTimer, RX_TIMER_TIMEOUT );
 
+    //Timer of the delay before restarting the CAD
+    TimerInit( &CadDelayTimer, CadDelayTimerIrq );
+    TimerSetValue( &CadDelayTimer, CAD_DELAY );
+
     configuration();
 
     SX126xConfigureCad( CAD_SYMBOL_NUM, CAD_DET_PEAK,CAD_DET_MIN, CAD_TIMEOUT_MS);      // Configure the CAD
     Radio.StartCad( );                                                                  // do the config and lunch first CAD
 
-    State = RX;
+    State = LOWPOWER;			//Wait for the CadDone
     statemach = true;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * 	Function:  stopComms			                                                  *
+ * 	--------------------                                                              *
+ * 	stops the communication state machine and puts the radio to sleep				  *
+ * 																				      *
+ *  returns: nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void stopComms(void){
+	if (!statemach){
+		return;
+	}
+	statemach = false;
+	TimerStop( &CADTimeoutTimer );
+	TimerStop( &RxAppTimeoutTimer );
+	TimerStop( &CadDelayTimer );
+	Radio.Sleep( );
+	State = LOWPOWER;
+}
+
+bool isCommsRunning(void){
+	return statemach;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * 	Function:  stateMachine			                                                  *
+ * 	--------------------                                                              *
+ * 	communication process state machine, handler of the EVT_COMMS event. Each call	  *
+ * 	processes the current state and runs to completion; if the next state needs		  *
+ * 	work, the event is posted again. The radio and timer callbacks post it when		  *
+ * 	they change the state, so nothing runs (and the MCU sleeps) in LOWPOWER			  *
+ * 	States:																			  *
+ * 	- RX_TIMEOUT: when the reception ends 											  *
+ * 	- RX_ERROR: when an error in the reception process occurs						  *
+ * 	- RX: when a packet has been received											  *
+ * 	- TX: to transmit a packet														  *
+ * 	- TX_TIMEOUT: when the transmission ends										  *
+ * 	- START_CAD: to detect channel activity (necessary to receive packets correctly)  *
+ * 	- LOWPOWER: when the transceiver is not transmitting nor receiving				  *
+ * 																				      *
+ *  returns: nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void stateMachine(void){
+    static uint16_t PacketCnt = 0;
+
+    if (!statemach){
+    	return;
+    }
 
-    while(statemach){
-		switch( State )
+	switch( State )
+	{
+		case RX_TIMEOUT:
 		{
-			case RX_TIMEOUT:
-			{
-				#if(FULL_DBG)
-					printf( "RX Timeout\r\n");
-				#endif
-				//RxTimeoutCnt++;
-				State = START_CAD;
-				break;
-			}
-			case RX_ERROR:
+			#if(FULL_DBG)
+				printf( "RX Timeout\r\n");
+			#endif
+			//RxTimeoutCnt++;
+			State = START_CAD;
+			break;
+		}
+		case RX_ERROR:
+		{
+			#if(FULL_DBG)
+				printf( "RX Error\r\n");
+			#endif
+			//RxErrorCnt++;
+			PacketReceived = false;
+			State = START_CAD;
+		break;
+		}
+		case RX:
+		{
+			if( PacketReceived == true )
 			{
+				PacketReceived = false;     // Reset flag
+				RxCorrectCnt++;         	// Update RX counter
+				State = START_CAD;			// The telecommand can change it (e.g. to TX)
+				process_telecommand(Buffer[0], Buffer[1]);	//We send the buffer to be used only in the cases of info = 1 byte
 				#if(FULL_DBG)
-					printf( "RX Error\r\n");
+					printf( "Rx Packet n %d\r\n", PacketCnt );
 				#endif
-				//RxErrorCnt++;
-				PacketReceived = false;
-				State = START_CAD;
-			break;
 			}
-			case RX:
+			else
 			{
-				if( PacketReceived == true )
+				if (CadRx == CAD_SUCCESS)
 				{
-					PacketReceived = false;     // Reset flag
-					RxCorrectCnt++;         	// Update RX counter
-					process_telecommand(Buffer[0], Buffer[1]);	//We send the buffer to be used only in the cases of info = 1 byte
+					//channelActivityDetectedCnt++;   // Update counter
 					#if(FULL_DBG)
-						printf( "Rx Packet n %d\r\n", PacketCnt );
+						printf( "Rxing\r\n");
 					#endif
-					State = START_CAD;
+					RxTimeoutTimerIrqFlag = false;
+					TimerReset(&RxAppTimeoutTimer);	// Start the Rx's's Timer
+					Radio.Rx( RX_TIMEOUT_VALUE );
 				}
 				else
 				{
-					if (CadRx == CAD_SUCCESS)
-					{
-						//channelActivityDetectedCnt++;   // Update counter
-						#if(FULL_DBG)
-							printf( "Rxing\r\n");
-						#endif
-						RxTimeoutTimerIrqFlag = false;
-						TimerReset(&RxAppTimeoutTimer);	// Start the Rx's's Timer
-						Radio.Rx( RX_TIMEOUT_VALUE );
-					}
-					else
-					{
-						TimerStart(&CADTimeoutTimer);   // Start the CAD's Timer
-					}
-					State = LOWPOWER;
+					TimerStart(&CADTimeoutTimer);   // Start the CAD's Timer
 				}
-				break;
+				State = LOWPOWER;
 			}
-			case TX:
-			{
+			break;
+		}
+		case TX:
+		{
+			#if(FULL_DBG)
 				printf("Send Packet n %d \r\n",PacketCnt);
-				if( PacketCnt == 0xFFFF)
-				{
-					PacketCnt = 0;
-				}
-				else
-				{
-					PacketCnt ++;
-				}
-				//Send Frame
-				DelayMs( 1 );
-				if (send_data){
-					tx_function();
-				}
-				State = LOWPOWER;
-				break;
+			#endif
+			if( PacketCnt == 0xFFFF)
+			{
+				PacketCnt = 0;
 			}
-			case TX_TIMEOUT:
+			else
 			{
-				State = LOWPOWER;
-				break;
+				PacketCnt ++;
+			}
+			//Send Frame (no delay: the TxDone -> next TX turnaround limits the packets per pass)
+			if ((send_data || send_telemetry) && tx_function()){
+				State = LOWPOWER;	//Wait for the TxDone
 			}
-			case START_CAD:
+			else{
+				State = START_CAD;	//End of the burst: listen for the ACK
+			}
+			break;
+		}
+		case TX_TIMEOUT:
+		{
+			State = LOWPOWER;
+			break;
+		}
+		case START_CAD:
+		{
+			//i++;    // Update NbTryCnt
+			TimerStop(&RxAppTimeoutTimer);  // Stop the Rx's Timer
+			if (send_data)
 			{
-				//i++;    // Update NbTryCnt
-				TimerStop(&RxAppTimeoutTimer);  // Stop the Rx's Timer
-				// Trace for debug
-				if(CadRx == CAD_FAIL)
+				ArqTimeout_t timeout = ARQ_Timeout();
+				if (timeout == ARQ_TIMEOUT_RESEND)
 				{
-					#if(FULL_DBG)
-						printf("No CAD detected\r\n");
-					#endif
+					State = TX;			//ACK lost: send the burst again
+					break;
 				}
-				CadRx = CAD_FAIL;           // Reset CAD flag
-				//DelayMs(randr(10,500));     //Add a random delay for the PER test => CHECK THIS WARNING
-				DelayMs(100);     //Add a random delay for the PER test => CHECK THIS WARNING
+				if (timeout == ARQ_TIMEOUT_LOST)
+				{
+					send_data = false;	//No ground station: the next SEND_DATA goes on from the packets lost
+				}
+			}
+			// Trace for debug
+			if(CadRx == CAD_FAIL)
+			{
 				#if(FULL_DBG)
-					printf("CAD %d\r\n",i);
+					printf("No CAD detected\r\n");
 				#endif
-				Radio.StartCad( );          //StartCad Again
-				State = LOWPOWER;
-			break;
 			}
-			case LOWPOWER:
-			default:
-				// Set low power
-				break;
+			CadRx = CAD_FAIL;           // Reset CAD flag
+			radioConfig( base_sf, base_cr );	//The ground sends at the configured SF/CR
+			//DelayMs(randr(10,500));     //Add a random delay for the PER test => CHECK THIS WARNING
+			TimerStart( &CadDelayTimer );	//The CAD starts after CAD_DELAY, the events keep running meanwhile
+			State = LOWPOWER;
+		break;
 		}
-    }
+		case CAD:
+		{
+			#if(FULL_DBG)
+				printf("CAD %d\r\n",i);
+			#endif
+			Radio.StartCad( );          //StartCad Again
+			State = LOWPOWER;
+		break;
+		}
+		case LOWPOWER:
+		default:
+			// Set low power
+			NVLog_Background();		//Prepare the next counters log sector while waiting
+			break;
+	}
+
+	if (State != LOWPOWER)
+	{
+		Scheduler_Post( EVT_COMMS );	//Process the next state
+	}
 }
 
+/**************************************************************************************
+ *                                                                                    *
+ * 	Function:  radioEvents   			                                              *
+ * 	--------------------                                                              *
+ * 	handler of the EVT_RADIO_EVENT event: reads the events queued by the radio		  *
+ * 	driver and calls the function of each one										  *
+ *                                                                                    *
+ *  returns: nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void radioEvents(void){
+	RadioEvent_t event;
+
+	while (Radio.GetEvent( &event )){
+		switch (event.Type){
+		case RADIO_EVENT_TX_DONE:
+			OnTxDone( );
+			break;
+		case RADIO_EVENT_TX_TIMEOUT:
+			OnTxTimeout( );
+			break;
+		case RADIO_EVENT_RX_DONE:
+			OnRxDone( event.Payload, event.Size, event.Rssi, event.Snr );
+			break;
+		case RADIO_EVENT_RX_TIMEOUT:
+			OnRxTimeout( );
+			break;
+		case RADIO_EVENT_RX_ERROR:
+			OnRxError( );
+			break;
+		case RADIO_EVENT_CAD_DONE:
+			OnCadDone( event.ChannelActivityDetected );
+			break;
+		}
+	}
+}
 
 /**************************************************************************************
  *                                                                                    *
@@ -429,7 +739,9 @@ void stateMachine(void){
 void OnTxDone( void )
 {
     Radio.Standby( );
+    ARQ_TxDone( );	//End of the burst if it was its last packet
     State = TX;
+    Scheduler_Post( EVT_COMMS );
 }
 
 /**************************************************************************************
@@ -458,6 +770,7 @@ void OnRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr )
     RssiMoy = (((RssiMoy * RxCorrectCnt) + RssiValue) / (RxCorrectCnt + 1));
     SnrMoy = (((SnrMoy * RxCorrectCnt) + SnrValue) / (RxCorrectCnt + 1));
     State = RX;
+    Scheduler_Post( EVT_COMMS );
 }
 
 /**************************************************************************************
@@ -472,7 +785,9 @@ void OnRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr )
 void OnTxTimeout( void )
 {
     Radio.Standby( );
+    ARQ_TxDone( );
     State = TX_TIMEOUT;
+    Scheduler_Post( EVT_COMMS );
 }
 
 /**************************************************************************************
@@ -490,6 +805,7 @@ void OnRxTimeout( void )
     if( RxTimeoutTimerIrqFlag )
     {
         State = RX_TIMEOUT;
+        Scheduler_Post( EVT_COMMS );
     }
     else
     {
@@ -515,6 +831,7 @@ void OnRxError( void )
 {
     Radio.Standby( );
     State = RX_ERROR;
+    Scheduler_Post( EVT_COMMS );
 }
 
 /**************************************************************************************
@@ -541,6 +858,7 @@ void OnCadDone( bool channelActivityDetected)
         CadRx = CAD_FAIL;
     }
     State = RX;
+    Scheduler_Post( EVT_COMMS );
 }
 
 /**************************************************************************************
@@ -556,6 +874,22 @@ static void CADTimeoutTimeoutIrq( void )
 {
     Radio.Standby( );
     State = START_CAD;
+    Scheduler_Post( EVT_COMMS );
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * 	Function:  CadDelayTimerIrq                                                       *
+ * 	--------------------                                                              *
+ * 	end of the delay between the START_CAD state and the CAD itself					  *
+ *                                                                                    *
+ *  returns: nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+static void CadDelayTimerIrq( void )
+{
+    State = CAD;
+    Scheduler_Post( EVT_COMMS );
 }
 
 /**************************************************************************************
@@ -604,20 +938,23 @@ void setContingency(bool cont){
 void process_telecommand(uint8_t header, uint8_t info) {
 	switch(header) {
 	case RESET2:
+		History_Flush();
+		Flash_Flush();	//Commit the cached writes before resetting
 		HAL_NVIC_SystemReset();
 		break;
 	case NOMINAL:
-		Write_Flash(NOMINAL_ADDR, &info, 1);
+		Settings_Write(NOMINAL_ADDR, &info, 1);
 		break;
 	case LOW:
-		Write_Flash(LOW_ADDR, &info, 1);
+		Settings_Write(LOW_ADDR, &info, 1);
 		break;
 	case CRITICAL:
-		Write_Flash(CRITICAL_ADDR, &info, 1);
+		Settings_Write(CRITICAL_ADDR, &info, 1);
 		break;
 	case EXIT_LOW_POWER:{
-		Write_Flash(EXIT_LOW_POWER_FLAG_ADDR, &info, 1);
-		Write_Flash(EXIT_LOW_ADDR, TRUE, 1);
+		uint8_t exit_low = TRUE;
+		Settings_Write(EXIT_LOW_POWER_FLAG_ADDR, &info, 1);
+		Settings_Write(EXIT_LOW_ADDR, &exit_low, 1);
 		break;
 	}
 	case SET_TIME:{
@@ -629,7 +966,7 @@ void process_telecommand(uint8_t header, uint8_t info) {
 		break;
 	}
 	case SET_CONSTANT_KP:
-		Write_Flash(KP_ADDR, &info, 1);
+		Settings_Write(KP_ADDR, &info, 1);
 		break;
 	case TLE:{
 		uint8_t tle[UPLINK_BUFFER_SIZE-1];
@@ -646,10 +983,26 @@ void process_telecommand(uint8_t header, uint8_t info) {
 	}
 	case SET_GYRO_RES:
 		/*4 possibles estats, rebrem 00/01/10/11*/
-		Write_Flash(GYRO_RES_ADDR, &info, 1);
+		Settings_Write(GYRO_RES_ADDR, &info, 1);
 		break;
 	case SEND_DATA:{
 		if (!contingency){
+			if (Settings_Generation() != settings_generation){	//A telecommand changed the settings since the last pass
+				settings_generation = Settings_Generation();
+				if (Settings_Get()->sf != base_sf || Settings_Get()->crc != base_cr){
+					base_sf = Settings_Get()->sf;
+					base_cr = Settings_Get()->crc;
+					LinkAdapt_Init( base_sf, base_cr );
+				}
+			}
+			if (image == NULL || (image->flags & CATALOG_SENT)){	//Next image of the catalog
+				image = Catalog_Next();
+				if (image == NULL){
+					break;
+				}
+				openImage( image );
+			}
+			selectData( info == SEND_THUMBNAIL );
 			State = TX;
 			send_data = true;
 		}
@@ -659,27 +1012,33 @@ void process_telecommand(uint8_t header, uint8_t info) {
 		if (!contingency){
 			send_telemetry = true;
 			num_telemetry = (uint8_t) 34/BUFFER_SIZE + 1; //cast to integer to erase the decimal part
+			telemetry_packets = 0;
+			History_Flush();	//info: pages of history to send after the snapshot
+			history_packets = ((info < History_Pages()) ? info : History_Pages()) * HISTORY_PARTS;
 			State = TX;
 		}
 		break;
 	}
 	case STOP_SENDING_DATA:{
-		send_data = false;
-		count_packet[0] = 0;
+		send_data = false;		//The next SEND_DATA continues from the packets not acknowledged
 		break;
 	}
 	case ACK_DATA:{
-		//check it
-	 	 ack = ack & Buffer[1];
-		 for(j=2; j<ACK_PAYLOAD_LENGTH; j++){
-			 ack = (ack << 8*j) & Buffer[j];
-		 }
-		 count_window[0] = 0;
-		 full_window = false;
-		 if (ack != 0xFFFFFFFFFFFFFFFF){
-			 nack = true;
-		 }
-		 State = TX;
+		ARQ_Ack( (Buffer[1] << 8) | Buffer[2], &Buffer[3] );	//Lost packets are sent again in the next burst
+		LinkAdapt_Update( SnrValue, ARQ_Loss() );				//SF/CR of the next burst
+		radioConfig( LinkAdapt_SF(), LinkAdapt_CR() );
+		uint8_t size = Packetizer_DataSize();					//Longest packet within PKT_TARGET_TOA
+		ARQ_SetPacket( size, Radio.TimeOnAir( MODEM_LORA, PKT_HEADER_SIZE + size ) );
+		count_window[0] = ARQ_Base() / WINDOW_SIZE;
+		count_packet[0] = ARQ_Base() % WINDOW_SIZE;
+		Catalog_Save();											//Chunks completed by this ACK, kept across passes and resets
+		if (ARQ_Done()){
+			send_data = false;
+			if (data_flag == 0){
+				Catalog_Sent();
+			}
+		}
+		State = TX;
 		break;
 	}
 	case SET_SF_CR: {
@@ -690,9 +1049,9 @@ void process_telecommand(uint8_t header, uint8_t info) {
 		else if (info == 3) SF = 10;
 		else if (info == 4) SF = 11;
 		else if (info == 5) SF = 12;
-		Write_Flash(SF_ADDR, &SF, 1);
+		Settings_Write(SF_ADDR, &SF, 1);
 		/*4 cases (4/5, 4/6, 4/7,1/2), so we will receive and store 0, 1, 2 or 3*/
-		Write_Flash(CRC_ADDR, &Buffer[2], 1);
+		Settings_Write(CRC_ADDR, &Buffer[2], 1);
 		break;
 	}
 	case SEND_CALIBRATION:{	//Rx calibration
@@ -710,19 +1069,21 @@ void process_telecommand(uint8_t header, uint8_t info) {
 	}
 	case TAKE_PHOTO:{
 		/*GUARDAR TEMPS FOTO?*/
-		Write_Flash(PAYLOAD_STATE_ADDR, TRUE, 1);
-		Write_Flash(PL_TIME_ADDR, &info, 4);
-		Write_Flash(PHOTO_RESOL_ADDR, &Buffer[5], 1);
-		Write_Flash(PHOTO_COMPRESSION_ADDR, &Buffer[6], 1);
+		uint8_t payload = TAKE_PHOTO;					//The PAYLOAD state runs this telecommand
+		Write_Flash(PAYLOAD_STATE_ADDR, &payload, 1);
+		Settings_Write(PL_TIME_ADDR, &Buffer[1], 4);		//Buffer[1..4]: time of the photo
+		Settings_Write(PHOTO_RESOL_ADDR, &Buffer[5], 1);
+		Settings_Write(PHOTO_COMPRESSION_ADDR, &Buffer[6], 1);
 		break;
 	}
 	case TAKE_RF:{
-		Write_Flash(PAYLOAD_STATE_ADDR, TRUE, 1);
-		Write_Flash(PL_TIME_ADDR, &info, 8);
-		Write_Flash(F_MIN_ADDR, &Buffer[9], 1);
-		Write_Flash(F_MAX_ADDR, &Buffer[10], 1);
-		Write_Flash(DELTA_F_ADDR, &Buffer[11], 1);
-		Write_Flash(INTEGRATION_TIME_ADDR, &Buffer[12], 1);
+		uint8_t payload = TAKE_RF;
+		Write_Flash(PAYLOAD_STATE_ADDR, &payload, 1);
+		Settings_Write(PL_TIME_ADDR, &Buffer[1], 8);		//Buffer[1..8]: time of the RF measurement
+		Settings_Write(F_MIN_ADDR, &Buffer[9], 1);
+		Settings_Write(F_MAX_ADDR, &Buffer[10], 1);
+		Settings_Write(DELTA_F_ADDR, &Buffer[11], 1);
+		Settings_Write(INTEGRATION_TIME_ADDR, &Buffer[12], 1);
 		break;
 	}
 	case SEND_CONFIG:{
@@ -12,12 +12,17 @@
  * \author    David Reiss
  */
 #include "configuration.h"
+#include "settings.h"
+#include "catalog.h"
+
+static uint8_t battery_capacity = 0xFF; //last battery level read by checkbatteries (0xFF => not read yet)
 
 /**************************************************************************************
  *                                                                                    *
  * Function:  checkbatteries                                                 		  *
  * --------------------                                                               *
- * Checks the current battery level	and stores it in the NVM						  *
+ * Checks the current battery level	and stores it in the NVM. Until the gauge		  *
+ * answers, the level is the last one stored										  *
  *                                                                                    *
  *  hi2c: I2C to read battery capacity							    				  *
  *															                          *
@@ -28,13 +33,16 @@ void checkbatteries(I2C_HandleTypeDef *hi2c){
 	uint8_t percentage;
 	HAL_StatusTypeDef ret;
 
-	ret = HAL_I2C_Master_Transmit(hi2c, BATTSENSOR_ADDR, (uint8_t*)0x06, 1, 500); //we want to read from the register 0x06
+	if (battery_capacity == 0xFF) { //first call: start from the last level stored, in case the gauge does not answer
+		Read_Flash(BATT_LEVEL_ADDR, &battery_capacity, 1);
+	}
+	ret = HAL_I2C_Mem_Read(hi2c, BATTSENSOR_ADDR, 0x06, I2C_MEMADD_SIZE_8BIT, &percentage, 1, 500); //we want to read from the register 0x06
 	if (ret != HAL_OK) {
 
-	} else {
-		HAL_I2C_Master_Receive(hi2c, BATTSENSOR_ADDR, &percentage, 1, 500);
+	} else if (percentage != battery_capacity) { //only written to the NVM when it changes
+		battery_capacity = percentage;
+		Write_Flash(BATT_LEVEL_ADDR, &percentage, 1);
 	}
-	Write_Flash(BATT_LEVEL_ADDR, &percentage, 1);
 }
 
 /**************************************************************************************
@@ -167,21 +175,16 @@ void initsensors(I2C_HandleTypeDef *hi2c) {
  *                                                                                    *
  **************************************************************************************/
 bool system_state(I2C_HandleTypeDef *hi2c){
-	uint8_t low, nominal, critical, battery_capacity;
-	checkbatteries(&hi2c);
+	const Settings_t *settings = Settings_Get();
+	checkbatteries(hi2c);
 
-	/*Read from memory the thresholds LOW, NOMINAL, CRITICAL and BATTERY LEVEL*/
-	Read_Flash(BATT_LEVEL_ADDR, &battery_capacity, 1);
-	Read_Flash(LOW_ADDR, &low, 1);
-	Read_Flash(NOMINAL_ADDR, &nominal, 1);
-	Read_Flash(CRITICAL_ADDR, &critical, 1);
-
-	if(battery_capacity < low) return false;
-	else if(battery_capacity < nominal) {
+	/*The thresholds LOW, NOMINAL, CRITICAL are kept in RAM (settings.c)*/
+	if(battery_capacity < settings->low) return false;
+	else if(battery_capacity < settings->nominal) {
 
 	}
 
-	if (!checktemperature(&hi2c)) return false;
+	if (!checktemperature(hi2c)) return false;
 	return true;
 }
 
@@ -253,18 +256,14 @@ void heater(int state){
  *                                                                                    *
  * Function:  checkmemory	                                             	  		  *
  * --------------------                                                               *
- * Since there will be enough space in the flash memory to store the data coming	  *
- * from the payloads, this function must decide if the photo/spectogram already 	  *
- * stored in memory can be overwritten												  *
+ * Decides if a new photo/spectrogram can be stored: a slot of the image catalog	  *
+ * must be free or hold an image that has already been sent							  *
  *																					  *
- *  hi2c: I2C to read from the temperature sensors				    				  *
- *															                          *
- *  returns: False if more than 3 solar panels are too hot or battery temperature 	  *
- *  		 is too low																  *
- *  		 True otherwise								                              *
+ *  returns: True if there is a slot for a new image								  *
+ *  		 False if all the images stored are waiting to be sent					  *
  *  		 																		  *
  **************************************************************************************/
 bool checkmemory(){
-
+	return Catalog_Available() > 0;
 }
 
@@ -0,0 +1,270 @@
+/*
+ * ecc.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  The syndrome is computed one word at a time: bit j of the XOR of the positions
+ *  of the bits set in a word is the parity of the word masked with the bits whose
+ *  position has bit j set, so a word costs 6 parities. A page is checked in a few
+ *  thousand cycles and the codes take 1.6 % of the space (TMR would take 200 %).
+ */
+
+#include "ecc.h"
+#include "flash.h"
+#include "nvlog.h"
+#include "stm32l1xx_hal.h"
+#include "string.h"
+
+#define ECC_WORDS					(FLASH_PAGE_SIZE / 4)
+
+typedef struct {
+	uint32_t start;
+	uint16_t pages;
+} EccRegion_t;
+
+static const EccRegion_t regions[] = {
+	{ PHOTO_ADDR,		(HISTORY_ADDR - PHOTO_ADDR) / FLASH_PAGE_SIZE },	//Slot 0 of the catalog
+	{ HISTORY_ADDR,		HISTORY_PAGES },
+	{ SPECTRUM_ADDR,	SPECTRUM_SIZE / FLASH_PAGE_SIZE },
+	{ SLOT_ADDR,		SLOT_PAGES },										//Other slots
+};
+
+#define ECC_REGIONS					(sizeof(regions) / sizeof(regions[0]))
+
+static const uint16_t crc_nibble[16] = {	//CRC-16-CCITT (0x1021) of every nibble
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+static uint32_t page[ECC_WORDS];				//Page being checked
+static uint16_t scrub_index = 0;				//Next page of the scrubber (over all the regions)
+static EccStats_t ecc_stats;
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  ECC_CRC                                                 		  	  	  *
+ * --------------------                                                               *
+ * CRC-16-CCITT (0x1021), one nibble at a time (16-entry table)						  *
+ *                                                                                    *
+ *  crc: CRC of the previous data (0xFFFF to start)	                                  *
+ *  data: data to add (RAM or flash)				                                  *
+ *  length: bytes of data							                                  *
+ *                                                                                    *
+ *  returns: CRC including data                                                       *
+ *                                                                                    *
+ **************************************************************************************/
+uint16_t ECC_CRC(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+	for (uint32_t n = 0; n < length; n++)
+	{
+		crc = (crc << 4) ^ crc_nibble[(crc >> 12) ^ (data[n] >> 4)];
+		crc = (crc << 4) ^ crc_nibble[(crc >> 12) ^ (data[n] & 0x0F)];
+	}
+	return crc;
+}
+
+static uint32_t Parity(uint32_t word)
+{
+	word ^= word >> 16;
+	word ^= word >> 8;
+	word ^= word >> 4;
+	return (0x6996 >> (word & 0xF)) & 1;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Page_Code                                                 		  	  *
+ * --------------------                                                               *
+ *  words: page to encode							                                  *
+ *  crc: where the CRC-16 of the page is stored		                                  *
+ *                                                                                    *
+ *  returns: ECC_VALID | parity | syndrome of the page                                *
+ *                                                                                    *
+ **************************************************************************************/
+static uint16_t Page_Code(const uint32_t *words, uint16_t *crc)
+{
+	uint32_t syndrome = 0, parity = 0;
+
+	for (uint8_t n = 0; n < ECC_WORDS; n++)
+	{
+		uint32_t word = words[n];
+		uint32_t odd = Parity(word);
+
+		parity ^= odd;
+		syndrome ^= (odd ? (uint32_t)n << 5 : 0)
+				| Parity(word & 0xAAAAAAAA)
+				| Parity(word & 0xCCCCCCCC) << 1
+				| Parity(word & 0xF0F0F0F0) << 2
+				| Parity(word & 0xFF00FF00) << 3
+				| Parity(word & 0xFFFF0000) << 4;
+	}
+	*crc = ECC_CRC(0xFFFF, (const uint8_t *)words, FLASH_PAGE_SIZE);
+	return ECC_VALID | (parity ? ECC_PARITY : 0) | (syndrome & ECC_SYNDROME);
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Code_Addr                                                 		  	  *
+ * --------------------                                                               *
+ *  address: any address of a payload page			                                  *
+ *                                                                                    *
+ *  returns: address of the code of the page, 0 if the page is not protected          *
+ *                                                                                    *
+ **************************************************************************************/
+static uint32_t Code_Addr(uint32_t address)
+{
+	uint16_t index = 0;
+
+	for (uint8_t n = 0; n < ECC_REGIONS; n++)
+	{
+		uint32_t end = regions[n].start + (uint32_t)regions[n].pages*FLASH_PAGE_SIZE;
+		if (address >= regions[n].start && address < end)
+		{
+			return ECC_ADDR + (index + (address - regions[n].start) / FLASH_PAGE_SIZE) * ECC_CODE_SIZE;
+		}
+		index += regions[n].pages;
+	}
+	return 0;
+}
+
+static uint32_t Page_Addr(uint16_t index)
+{
+	for (uint8_t n = 0; n < ECC_REGIONS; n++)
+	{
+		if (index < regions[n].pages) return regions[n].start + (uint32_t)index*FLASH_PAGE_SIZE;
+		index -= regions[n].pages;
+	}
+	return 0;
+}
+
+static void Write_Code(uint32_t address, uint16_t check, uint16_t crc)
+{
+	uint8_t code[ECC_CODE_SIZE] = { check >> 8, check & 0xFF, crc >> 8, crc & 0xFF };
+	Flash_Write_Data(Code_Addr(address), code, ECC_CODE_SIZE);
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  ECC_Protect                                                 		  	  *
+ * --------------------                                                               *
+ * Reads the pages of the range (through the page cache, so the data may not be		  *
+ * committed yet) and stores their codes											  *
+ *                                                                                    *
+ *  address: first address of the range				                              *
+ *  length: bytes of the range						                                  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void ECC_Protect(uint32_t address, uint32_t length)
+{
+	uint32_t first = address - (address % FLASH_PAGE_SIZE);
+	uint16_t check, crc;
+
+	for (uint32_t addr = first; addr < address + length; addr += FLASH_PAGE_SIZE)
+	{
+		if (Code_Addr(addr) == 0) continue;
+		Flash_Read_Data(addr, (uint8_t *)page, FLASH_PAGE_SIZE);
+		check = Page_Code(page, &crc);
+		Write_Code(addr, check, crc);
+	}
+}
+
+void ECC_Invalidate(uint32_t address, uint32_t length)
+{
+	uint32_t first = address - (address % FLASH_PAGE_SIZE);
+
+	for (uint32_t addr = first; addr < address + length; addr += FLASH_PAGE_SIZE)
+	{
+		if (Code_Addr(addr) != 0) Write_Code(addr, 0, 0);
+	}
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Check_Page                                                 		  	  *
+ * --------------------                                                               *
+ * With an odd number of wrong bits the syndromes differ in the position of the bit  *
+ * (if there is only one). The fix is kept if the CRC agrees; if the page as read	  *
+ * agrees with the CRC or with the syndrome instead, the wrong bits were in the code, *
+ * which is written again															  *
+ *                                                                                    *
+ *  address: page to check							                                  *
+ *  check, crc: stored code of the page				                                  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+static void Check_Page(uint32_t address, uint16_t check, uint16_t crc)
+{
+	uint16_t read_crc, fixed_crc;
+	uint16_t diff;
+
+	Flash_Read_Data(address, (uint8_t *)page, FLASH_PAGE_SIZE);
+	diff = check ^ Page_Code(page, &read_crc);
+	ecc_stats.checked++;
+	if (diff == 0 && read_crc == crc) return;
+
+	if (diff & ECC_PARITY)
+	{
+		uint16_t bit = diff & ECC_SYNDROME;
+		((uint8_t *)page)[bit >> 3] ^= 1 << (bit & 7);
+		Page_Code(page, &fixed_crc);
+		if (fixed_crc == crc)
+		{
+			Flash_Write_Data(address, (uint8_t *)page, FLASH_PAGE_SIZE);
+			ecc_stats.corrected++;
+			return;
+		}
+		((uint8_t *)page)[bit >> 3] ^= 1 << (bit & 7);
+	}
+
+	if (read_crc == crc || diff == 0)			//Both checks cannot fail with the same wrong bits
+	{
+		Write_Code(address, check ^ diff, read_crc);
+		ecc_stats.corrected++;
+		return;
+	}
+
+	//Logged once: the code is dropped, the page is left as it is
+	ecc_stats.uncorrectable++;
+	ecc_stats.last_error = address;
+	NVLog_Write(NVLOG_ECC_ERRORS, NVLog_Read(NVLOG_ECC_ERRORS) + 1);
+	Write_Code(address, 0, 0);
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  ECC_Scrub                                                 		  	  *
+ * --------------------                                                               *
+ * Walks all the payload pages, ECC_SCRUB_PAGES protected pages per call (the pages  *
+ * without a code only cost the read of the code)									  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void ECC_Scrub(void)
+{
+	uint16_t total = ECC_SIZE / ECC_CODE_SIZE;
+	uint8_t checked = 0;
+	uint8_t code[ECC_CODE_SIZE];
+
+	for (uint16_t n = 0; n < total && checked < ECC_SCRUB_PAGES; n++)
+	{
+		uint32_t address = Page_Addr(scrub_index);
+		scrub_index = (scrub_index + 1) % total;
+		if (address == 0) continue;
+
+		Flash_Read_Data(Code_Addr(address), code, ECC_CODE_SIZE);
+		uint16_t check = (code[0] << 8) | code[1];
+		if (!(check & ECC_VALID)) continue;
+
+		Check_Page(address, check, (code[2] << 8) | code[3]);
+		checked++;
+	}
+}
+
+void ECC_Get_Stats(EccStats_t *stats)
+{
+	*stats = ecc_stats;
+}
@@ -0,0 +1,156 @@
+/*
+ * fec.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  The multiplications use the log/exp tables of GF(256), built in RAM at init
+ *  (768 bytes, faster than the flash wait states). gf_exp is doubled so that
+ *  log(a) + log(c) never needs a modulo. The parity of the current block is
+ *  accumulated while its packets are sent, so only FEC_PARITY_PACKETS packets
+ *  are kept in RAM. A shorter last packet is taken as padded with zeros.
+ */
+
+#include "comms.h"
+
+#define GF_POLYNOMIAL			0x11D
+
+static uint8_t gf_exp[510];
+static uint8_t gf_log[256];
+
+static uint8_t parity[FEC_PARITY_PACKETS][PKT_MAX_DATA];
+static uint16_t total;					//Bytes of the photo
+static uint16_t block;					//Block being accumulated
+static uint16_t block_offset;			//Offset of the first packet of the block
+static uint8_t block_length;			//Data size of the packets of the block
+static uint8_t count;					//Packets of the block accumulated (in order)
+static uint8_t pending;					//Parity packets left to send
+static bool valid;						//False if a packet of the block was missed (e.g. after a reset)
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  FEC_Init                                                 		  		  *
+ * --------------------                                                               *
+ *  total_bytes: bytes of the photo					                                  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void FEC_Init(uint16_t total_bytes)
+{
+	uint16_t x = 1;
+
+	for (uint16_t n = 0; n < 255; n++)
+	{
+		gf_exp[n] = x;
+		gf_exp[n + 255] = x;
+		gf_log[x] = n;
+		x <<= 1;
+		if (x & 0x100) x ^= GF_POLYNOMIAL;
+	}
+	gf_log[0] = 0;			//Never used (0 is skipped)
+
+	total = total_bytes;
+	count = 0;
+	pending = 0;
+	valid = false;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  FEC_Mul_Add                                                 		  	  *
+ * --------------------                                                               *
+ * parity ^= c * data over GF(256), with c given by its logarithm					  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+static void FEC_Mul_Add(uint8_t *out, const uint8_t *data, uint8_t length, uint8_t log_c)
+{
+	for (uint8_t n = 0; n < length; n++)
+	{
+		uint8_t d = data[n];
+		if (d != 0) out[n] ^= gf_exp[gf_log[d] + log_c];
+	}
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  FEC_Add                                                 		  		  *
+ * --------------------                                                               *
+ * Accumulates a data packet in the parity of its block. The packets of a block must  *
+ * arrive in order from the first one, with consecutive data, otherwise no parity is *
+ * sent for that block																  *
+ * After the last packet of the block, the parity packets become pending			  *
+ *                                                                                    *
+ *  seq: sequence number of the packet				                                  *
+ *  offset: position of the data in the photo		                                  *
+ *  data: data of the packet (RAM or flash)                        					  *
+ *  length: bytes of data (all the packets of a block but the last of the photo have  *
+ *  the same length)																  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void FEC_Add(uint16_t seq, uint16_t offset, const uint8_t *data, uint8_t length)
+{
+	uint8_t index = seq % WINDOW_SIZE;
+
+	if (FEC_PARITY_PACKETS == 0) return;
+
+	if (index == 0)
+	{
+		memset(parity, 0, sizeof(parity));
+		block = seq / WINDOW_SIZE;
+		block_offset = offset;
+		block_length = length;
+		count = 0;
+		pending = 0;
+		valid = true;
+	}
+	if (!valid || block != seq / WINDOW_SIZE || index != count || length > block_length
+			|| offset != block_offset + index*block_length)
+	{
+		valid = false;
+		return;
+	}
+
+	for (uint8_t j = 0; j < FEC_PARITY_PACKETS; j++)
+	{
+		uint8_t log_c = (255 - gf_log[j ^ (FEC_PARITY_PACKETS + index)]) % 255;	//log(1/(x_j + y_i))
+		FEC_Mul_Add(parity[j], data, length, log_c);
+	}
+	count++;
+
+	if (count == WINDOW_SIZE || offset + length >= total)
+	{
+		pending = FEC_PARITY_PACKETS;
+		valid = false;
+	}
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  FEC_Next                                                 		  		  *
+ * --------------------                                                               *
+ *  id: returns the id of the parity packet (sent instead of the sequence number)	  *
+ *  offset: returns the offset of the first packet of the block                       *
+ *  data: returns a pointer to the parity			                                  *
+ *  length: returns the bytes of parity (data size of the packets of the block)       *
+ *                                                                                    *
+ *  returns: true if there is a parity packet to send                                 *
+ *                                                                                    *
+ **************************************************************************************/
+bool FEC_Next(uint16_t *id, uint16_t *offset, const uint8_t **data, uint8_t *length)
+{
+	uint8_t j;
+
+	if (pending == 0) return false;
+
+	j = FEC_PARITY_PACKETS - pending;
+	*id = FEC_PARITY_FLAG | (block << 4) | j;
+	*offset = block_offset;
+	*data = parity[j];
+	*length = block_length;
+	pending--;
+	return true;
+}
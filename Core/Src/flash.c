@@ -11,6 +11,44 @@
 #include "string.h"
 #include "stdio.h"
 
+/*
+ * RAM write-back cache in front of the program memory. Small writes to the same
+ * 256-byte page are merged in RAM and the page is only erased and programmed
+ * when it is flushed or evicted.
+ */
+typedef struct {
+	uint32_t page;								//Base address of the cached page (0 => free slot)
+	bool dirty;									//True when the RAM copy differs from the flash
+	uint32_t data[FLASH_PAGE_SIZE/4];			//Page contents (word aligned for half page programming)
+} FlashCachePage_t;
+
+static FlashCachePage_t cache[FLASH_CACHE_PAGES];
+static uint8_t cache_victim = 0;				//Next slot to evict when the cache is full
+static FlashStats_t flash_stats;				//Erase/program counters
+
+/*
+ * Sequential page writer used to store long streams (the photo) without keeping them
+ * in RAM. Two page buffers: one is being filled while the other is programmed.
+ */
+static FlashCachePage_t stream[2];
+static uint8_t stream_active = 0;				//Buffer being filled
+static uint16_t stream_fill = 0;				//Bytes in the active buffer
+static uint32_t stream_addr = 0;				//Page where the active buffer goes
+static uint32_t stream_left = 0;				//Bytes that can still be appended to the stream
+
+/*
+ * Redundant ranges where a copy disagreed with the other two, repaired in the
+ * background by Flash_Scrub.
+ */
+typedef struct {
+	uint32_t address;							//First address of the range (first copy)
+	uint16_t length;							//Bytes of the range
+	uint16_t done;								//Bytes already repaired
+} FlashScrub_t;
+
+static FlashScrub_t scrub[FLASH_SCRUB_QUEUE];
+static uint8_t scrub_head = 0;					//Next range to repair
+static uint8_t scrub_count = 0;					//Ranges in the queue
 
 /**************************************************************************************
  *                                                                                    *
@@ -28,23 +66,143 @@
  **************************************************************************************/
 static uint32_t GetPage(uint32_t Address)
 {
-  for (int indx=0; indx<128; indx++)
-  {
-	  if((Address < (0x08000000 + (FLASH_PAGE_SIZE *(indx+1))) ) && (Address >= (0x08000000 + FLASH_PAGE_SIZE*indx)))
-	  {
-		  return (0x08000000 + FLASH_PAGE_SIZE*indx);
-	  }
-  }
+	return Address & ~(FLASH_PAGE_SIZE - 1);
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Is_Program_Memory                                                 	  *
+ * --------------------                                                               *
+ * Tells if the address belongs to the program memory (cached, erased by pages) or	  *
+ * to the data EEPROM (byte programmable, no erase needed)							  *
+ *                                                                                    *
+ *  Address: address to check			                                              *
+ *                                                                                    *
+ *  returns: true if the address is in the program memory                             *
+ *                                                                                    *
+ **************************************************************************************/
+static bool Is_Program_Memory(uint32_t Address)
+{
+	return (Address >= FLASH_BASE) && (Address < FLASH_EEPROM_BASE);
+}
 
-  return 0;
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Cache_Commit                                                 		  	  *
+ * --------------------                                                               *
+ * Writes a dirty cached page back to the flash: one page erase and two half page	  *
+ * programming operations. Half pages left all zeros are skipped, because the		  *
+ * STM32L1 program memory reads 0x00 once erased									  *
+ *                                                                                    *
+ *  slot: cache slot to commit					                                      *
+ *                                                                                    *
+ *  returns: 0 or the HAL flash error code                                            *
+ *                                                                                    *
+ **************************************************************************************/
+static uint32_t Cache_Commit(FlashCachePage_t *slot)
+{
+	FLASH_EraseInitTypeDef EraseInitStruct;
+	uint32_t PAGEError;
+	uint32_t half, w;
+
+	if (slot->page == 0 || !slot->dirty) return 0;
+
+	HAL_FLASH_Unlock();
+
+	EraseInitStruct.TypeErase   = FLASH_TYPEERASE_PAGES;
+	EraseInitStruct.PageAddress = slot->page;
+	EraseInitStruct.NbPages     = 1;
+	if (HAL_FLASHEx_Erase(&EraseInitStruct, &PAGEError) != HAL_OK)
+	{
+		HAL_FLASH_Lock();
+		return HAL_FLASH_GetError();
+	}
+	flash_stats.erases++;
+
+	for (half = 0; half < 2; half++)
+	{
+		uint32_t *words = &slot->data[half*FLASH_HALF_PAGE_WORDS];
+		for (w = 0; w < FLASH_HALF_PAGE_WORDS && words[w] == 0; w++);
+		if (w == FLASH_HALF_PAGE_WORDS) continue;	//Nothing to program in this half page
+
+		if (HAL_FLASHEx_HalfPageProgram(slot->page + half*FLASH_PAGE_SIZE/2, words) != HAL_OK)
+		{
+			HAL_FLASH_Lock();
+			return HAL_FLASH_GetError();
+		}
+		flash_stats.programs++;
+	}
+
+	HAL_FLASH_Lock();
+
+	slot->dirty = false;
+	return 0;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Cache_Lookup                                                 		  	  *
+ * --------------------                                                               *
+ * Looks for a page in the cache													  *
+ *                                                                                    *
+ *  page: base address of the page				                                      *
+ *                                                                                    *
+ *  returns: the cache slot holding the page or NULL if it is not cached              *
+ *                                                                                    *
+ **************************************************************************************/
+static FlashCachePage_t *Cache_Lookup(uint32_t page)
+{
+	for (int indx = 0; indx < FLASH_CACHE_PAGES; indx++)
+	{
+		if (cache[indx].page == page) return &cache[indx];
+	}
+	return NULL;
 }
 
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Cache_Load                                                 		  	  *
+ * --------------------                                                               *
+ * Returns the cache slot of a page, bringing it into the cache if needed. When		  *
+ * the cache is full, a slot is evicted (committing it first if it is dirty)		  *
+ *                                                                                    *
+ *  page: base address of the page				                                      *
+ *  fill: false when the whole page is going to be overwritten (no need to read it)  *
+ *  error: where the commit error of the evicted page is stored					  *
+ *                                                                                    *
+ *  returns: the cache slot holding the page or NULL if the eviction failed           *
+ *                                                                                    *
+ **************************************************************************************/
+static FlashCachePage_t *Cache_Load(uint32_t page, bool fill, uint32_t *error)
+{
+	FlashCachePage_t *slot = Cache_Lookup(page);
+	if (slot != NULL) return slot;
+
+	slot = Cache_Lookup(0);						//Free slot
+	if (slot == NULL)
+	{
+		slot = &cache[cache_victim];
+		cache_victim = (cache_victim + 1) % FLASH_CACHE_PAGES;
+		*error = Cache_Commit(slot);
+		if (*error != 0) return NULL;			//Keep the dirty page, it has not been saved
+	}
+
+	slot->page = page;
+	slot->dirty = false;
+	if (fill)
+	{
+		memcpy(slot->data, (uint8_t *)page, FLASH_PAGE_SIZE);
+	}
+	return slot;
+}
 
 /**************************************************************************************
  *                                                                                    *
  * Function:  Flash_Write_Data                                                 		  *
  * --------------------                                                               *
- * Writes in the flash memory														  *
+ * Writes in the flash memory. Program memory writes are merged in the RAM page		  *
+ * cache and only reach the flash on Flash_Flush or when the page is evicted.		  *
+ * Data EEPROM writes are programmed directly (no erase is needed there)			  *
  *                                                                                    *
  *  StartPageAddress: first address to be written		                              *
  *	Data: information to be stored in the FLASH/EEPROM memory						  *
@@ -55,52 +213,228 @@ static uint32_t GetPage(uint32_t Address)
  **************************************************************************************/
 uint32_t Flash_Write_Data (uint32_t StartPageAddress, uint8_t *Data, uint16_t numberofbytes)
 {
+	uint32_t error = 0;
+	uint32_t sofar=0;
 
-	static FLASH_EraseInitTypeDef EraseInitStruct;
-	uint32_t PAGEError;
-	int sofar=0;
+	if (!Is_Program_Memory(StartPageAddress))
+	{
+		HAL_FLASHEx_DATAEEPROM_Unlock();
+		while (sofar<numberofbytes)
+		{
+			if (HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_BYTE, StartPageAddress + sofar, Data[sofar]) != HAL_OK)
+			{
+				HAL_FLASHEx_DATAEEPROM_Lock();
+				return HAL_FLASH_GetError ();
+			}
+			flash_stats.programs++;
+			sofar++;
+		}
+		HAL_FLASHEx_DATAEEPROM_Lock();
+		return 0;
+	}
 
-	  /* Unlock the Flash to enable the flash control register access *************/
-	   HAL_FLASH_Unlock();
+	while (sofar<numberofbytes)
+	{
+		uint32_t page = GetPage(StartPageAddress + sofar);
+		uint32_t offset = StartPageAddress + sofar - page;
+		uint32_t chunk = FLASH_PAGE_SIZE - offset;
+		if (chunk > numberofbytes - sofar) chunk = numberofbytes - sofar;
 
-	   /* Erase the user Flash area*/
+		bool fill = (chunk != FLASH_PAGE_SIZE);
+		FlashCachePage_t *slot = Cache_Load(page, fill, &error);
+		if (slot == NULL) return error;
 
-	  uint32_t StartPage = GetPage(StartPageAddress);
-	  uint32_t EndPageAdress = StartPageAddress + numberofbytes;
-	  uint32_t EndPage = GetPage(EndPageAdress);
+		//A page loaded without fill holds the bytes of its previous page, not the flash
+		if (!fill || memcmp((uint8_t *)slot->data + offset, &Data[sofar], chunk) != 0)
+		{
+			memcpy((uint8_t *)slot->data + offset, &Data[sofar], chunk);
+			slot->dirty = true;
+		}
+		sofar += chunk;
+	}
 
-	   /* Fill EraseInit structure*/
-	   EraseInitStruct.TypeErase   = FLASH_TYPEERASE_PAGES;
-	   EraseInitStruct.PageAddress = StartPage;
-	   EraseInitStruct.NbPages     = ((EndPage - StartPage)/FLASH_PAGE_SIZE) +1;
+	return 0;
+}
 
-	   if (HAL_FLASHEx_Erase(&EraseInitStruct, &PAGEError) != HAL_OK)
-	   {
-	     /*Error occurred while page erase.*/
-		  return HAL_FLASH_GetError ();
-	   }
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Flash_Flush                                                		 	  *
+ * --------------------                                                               *
+ * Commits every dirty page of the cache to the flash. It must be called at the		  *
+ * state transitions and before any reset, otherwise cached writes are lost		  *
+ *                                                                                    *
+ *  returns: 0 or the HAL flash error code of the first failing page                  *
+ *                                                                                    *
+ **************************************************************************************/
+uint32_t Flash_Flush(void)
+{
+	uint32_t error, first_error = 0;
 
-	   /* Program the user Flash area word by word*/
+	for (int indx = 0; indx < FLASH_CACHE_PAGES; indx++)
+	{
+		error = Cache_Commit(&cache[indx]);
+		if (error != 0 && first_error == 0) first_error = error;
+	}
+	flash_stats.flushes++;
+	return first_error;
+}
 
-	   while (sofar<numberofbytes)
-	   {
-	     if (HAL_FLASH_Program(FLASH_TYPEPROGRAMDATA_BYTE, StartPageAddress, Data[sofar]) == HAL_OK)
-	     {
-	    	 StartPageAddress += 1;  // use StartPageAddress += 2 for half word and 8 for double word
-	    	 sofar++;
-	     }
-	     else
-	     {
-	       /* Error occurred while writing data in Flash memory*/
-	    	 return HAL_FLASH_GetError ();
-	     }
-	   }
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Stream_Commit                                                 		  	  *
+ * --------------------                                                               *
+ * Programs the active stream buffer in its page and switches to the other buffer.	  *
+ * A cached copy of the page is dropped, the stream overwrites it					  *
+ *                                                                                    *
+ *  returns: 0 or the HAL flash error code                                            *
+ *                                                                                    *
+ **************************************************************************************/
+static uint32_t Stream_Commit(void)
+{
+	FlashCachePage_t *slot = &stream[stream_active];
+	FlashCachePage_t *cached = Cache_Lookup(stream_addr);
+	uint32_t error;
+
+	if (cached != NULL)
+	{
+		cached->page = 0;
+		cached->dirty = false;
+	}
 
-	   /* Lock the Flash to disable the flash control register access (recommended
-	      to protect the FLASH memory against possible unwanted operation) *********/
-	   HAL_FLASH_Lock();
+	slot->page = stream_addr;
+	slot->dirty = true;
+	error = Cache_Commit(slot);
 
-	   return 0;
+	stream_addr += FLASH_PAGE_SIZE;
+	stream_active ^= 1;
+	stream_fill = 0;
+	return error;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Flash_Stream_Begin                                                	  *
+ * --------------------                                                               *
+ * Starts a sequential write in the program memory. Only one page per buffer is kept  *
+ * in RAM, whatever the length of the stream										  *
+ *                                                                                    *
+ *  StartPageAddress: first address to be written (page aligned)                      *
+ *  capacity: bytes of the destination region, the writes past it are refused         *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void Flash_Stream_Begin(uint32_t StartPageAddress, uint32_t capacity)
+{
+	stream_addr = GetPage(StartPageAddress);
+	stream_left = capacity;
+	stream_active = 0;
+	stream_fill = 0;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Flash_Stream_Write                                                	  *
+ * --------------------                                                               *
+ * Appends data to the stream. Every page is erased and programmed once, as soon as	  *
+ * its buffer is full. The bytes past the capacity of the stream are dropped		  *
+ *                                                                                    *
+ *	Data: information to be stored													  *
+ *	numberofbytes: Data size in Bytes					    						  *
+ *															                          *
+ *  returns: 0, the HAL flash error code of the first failing page or				  *
+ *  		 FLASH_STREAM_FULL															  *
+ *                                                                                    *
+ **************************************************************************************/
+uint32_t Flash_Stream_Write(const uint8_t *Data, uint16_t numberofbytes)
+{
+	uint32_t error, first_error = 0;
+
+	if (numberofbytes > stream_left)
+	{
+		first_error = FLASH_STREAM_FULL;
+		numberofbytes = stream_left;
+	}
+	stream_left -= numberofbytes;
+
+	while (numberofbytes > 0)
+	{
+		uint16_t chunk = FLASH_PAGE_SIZE - stream_fill;
+		if (chunk > numberofbytes) chunk = numberofbytes;
+
+		memcpy((uint8_t *)stream[stream_active].data + stream_fill, Data, chunk);
+		stream_fill += chunk;
+		Data += chunk;
+		numberofbytes -= chunk;
+
+		if (stream_fill == FLASH_PAGE_SIZE)
+		{
+			error = Stream_Commit();
+			if (error != 0 && first_error == 0) first_error = error;
+		}
+	}
+	return first_error;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Flash_Stream_End                                                	 	  *
+ * --------------------                                                               *
+ * Programs the last (partial) page of the stream. The rest of the page is left		  *
+ * erased (0x00)																	  *
+ *                                                                                    *
+ *  returns: 0 or the HAL flash error code                                            *
+ *                                                                                    *
+ **************************************************************************************/
+uint32_t Flash_Stream_End(void)
+{
+	if (stream_fill == 0) return 0;
+
+	memset((uint8_t *)stream[stream_active].data + stream_fill, 0, FLASH_PAGE_SIZE - stream_fill);
+	return Stream_Commit();
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  EEPROM_Write_Word                                                		  *
+ * --------------------                                                               *
+ * Programs one 32-bit word of the data EEPROM (no erase needed). Writing 0 erases	  *
+ * the word																			  *
+ *                                                                                    *
+ *  Address: word aligned address in the data EEPROM	                              *
+ *	Data: word to be stored															  *
+ *															                          *
+ *  returns: 0 or the HAL flash error code				                              *
+ *                                                                                    *
+ **************************************************************************************/
+uint32_t EEPROM_Write_Word(uint32_t Address, uint32_t Data)
+{
+	HAL_StatusTypeDef status;
+
+	HAL_FLASHEx_DATAEEPROM_Unlock();
+	status = HAL_FLASHEx_DATAEEPROM_Program(FLASH_TYPEPROGRAMDATA_WORD, Address, Data);
+	HAL_FLASHEx_DATAEEPROM_Lock();
+
+	if (status != HAL_OK) return HAL_FLASH_GetError();
+	flash_stats.programs++;
+	return 0;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Flash_Get_Stats                                                		  *
+ * --------------------                                                               *
+ * Copies the flash erase/program counters, used to measure the flash cost of		  *
+ * the different code paths														  *
+ *                                                                                    *
+ *  stats: where the counters are copied				                              *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void Flash_Get_Stats(FlashStats_t *stats)
+{
+	*stats = flash_stats;
 }
 
 
@@ -119,10 +453,10 @@ uint32_t Flash_Write_Data (uint32_t StartPageAddress, uint8_t *Data, uint16_t nu
  *                                                                                    *
  **************************************************************************************/
 void Write_Flash(uint32_t StartPageAddress, uint8_t *Data, uint16_t numberofbytes) {
-	if (StartPageAddress >= 0x08080000 && StartPageAddress <= 0x08083FFF) {
+	if (StartPageAddress >= REDUNDANT_ADDR && StartPageAddress <= REDUNDANT_END_ADDR) {
 		Flash_Write_Data(StartPageAddress, Data, numberofbytes);
-		Flash_Write_Data(StartPageAddress + 0x1555, Data, numberofbytes);
-		Flash_Write_Data(StartPageAddress + 0x2AAA, Data, numberofbytes);
+		Flash_Write_Data(StartPageAddress + REDUNDANT_COPY2, Data, numberofbytes);
+		Flash_Write_Data(StartPageAddress + REDUNDANT_COPY3, Data, numberofbytes);
 	}
 	else {
 		Flash_Write_Data(StartPageAddress, Data, numberofbytes);
@@ -133,7 +467,7 @@ void Write_Flash(uint32_t StartPageAddress, uint8_t *Data, uint16_t numberofbyte
  *                                                                                    *
  * Function:  Flash_Read_Data                                                 		  *
  * --------------------                                                               *
- * Writes in the flash memory														  *
+ * Reads from the flash memory (from the page cache if the page is cached)			  *
  *                                                                                    *
  *  StartPageAddress: first address to be read		                              *
  *	RxBuf: Where the data read from memory will be stored							  *
@@ -144,25 +478,113 @@ void Write_Flash(uint32_t StartPageAddress, uint8_t *Data, uint16_t numberofbyte
  **************************************************************************************/
 void Flash_Read_Data (uint32_t StartPageAddress, uint8_t *RxBuf, uint16_t numberofbytes)
 {
-	while (1)
+	while (numberofbytes > 0)
 	{
+		uint32_t page = GetPage(StartPageAddress);
+		uint32_t offset = StartPageAddress - page;
+		uint32_t chunk = FLASH_PAGE_SIZE - offset;
+		if (chunk > numberofbytes) chunk = numberofbytes;
+
+		FlashCachePage_t *slot = Is_Program_Memory(StartPageAddress) ? Cache_Lookup(page) : NULL;
+		if (slot != NULL)
+		{
+			memcpy(RxBuf, (uint8_t *)slot->data + offset, chunk);	//The cached copy is the most recent one
+		}
+		else
+		{
+			memcpy(RxBuf, (uint8_t *)StartPageAddress, chunk);
+		}
+		StartPageAddress += chunk;
+		RxBuf += chunk;
+		numberofbytes -= chunk;
+	}
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Flash_Map                                                 		  	  *
+ * --------------------                                                               *
+ * Gives direct access to data stored in the memory-mapped flash, so it can be sent	  *
+ * without copying it. The cached pages of the range are committed first, so the	  *
+ * flash holds the most recent data													  *
+ *                                                                                    *
+ *  StartPageAddress: first address to be read		                              *
+ *	numberofbytes: Data size in Bytes					    						  *
+ *															                          *
+ *  returns: pointer to the data or NULL if a cached page could not be committed	  *
+ *                                                                                    *
+ **************************************************************************************/
+const uint8_t *Flash_Map(uint32_t StartPageAddress, uint16_t numberofbytes)
+{
+	if (Is_Program_Memory(StartPageAddress))
+	{
+		for (int indx = 0; indx < FLASH_CACHE_PAGES; indx++)
+		{
+			if (cache[indx].dirty && cache[indx].page < StartPageAddress + numberofbytes
+					&& cache[indx].page + FLASH_PAGE_SIZE > StartPageAddress)
+			{
+				if (Cache_Commit(&cache[indx]) != 0) return NULL;
+			}
+		}
+	}
+	return (const uint8_t *)StartPageAddress;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Vote                                                 		  	  		  *
+ * --------------------                                                               *
+ * Bitwise majority of the 3 copies, 32 bits at a time ((a&b)|(a&c)|(b&c)), read	  *
+ * directly from the memory-mapped EEPROM. The copies are 0x1555 bytes apart, so at	  *
+ * most one of them is word aligned: the words are read with memcpy (unaligned LDR)	  *
+ *                                                                                    *
+ *  Address: first address of the first copy		                              	  *
+ *	out: Buffer to store the voted data												  *
+ *	numberofbytes: Data size in bytes												  *
+ *															                          *
+ *  returns: bit n set if the copy n+1 disagreed with the result                      *
+ *                                                                                    *
+ **************************************************************************************/
+static uint8_t Vote(uint32_t Address, uint8_t *out, uint16_t numberofbytes)
+{
+	const uint8_t *copy1 = (const uint8_t *)Address;
+	const uint8_t *copy2 = (const uint8_t *)(Address + REDUNDANT_COPY2);
+	const uint8_t *copy3 = (const uint8_t *)(Address + REDUNDANT_COPY3);
+	uint32_t diff1 = 0, diff2 = 0, diff3 = 0;
+	uint16_t i = 0;
 
-		*RxBuf = *(__IO uint8_t *)StartPageAddress;
-		StartPageAddress += 1;
-		RxBuf++;
-		numberofbytes--;
-		if (numberofbytes == 0) break;
+	for (; i + 4 <= numberofbytes; i += 4)
+	{
+		uint32_t a, b, c, m;
+		memcpy(&a, &copy1[i], 4);
+		memcpy(&b, &copy2[i], 4);
+		memcpy(&c, &copy3[i], 4);
+		m = (a & b) | (a & c) | (b & c);
+		memcpy(&out[i], &m, 4);
+		diff1 |= a ^ m;
+		diff2 |= b ^ m;
+		diff3 |= c ^ m;
 	}
+	for (; i < numberofbytes; i++)
+	{
+		uint8_t a = copy1[i], b = copy2[i], c = copy3[i];
+		uint8_t m = (a & b) | (a & c) | (b & c);
+		out[i] = m;
+		diff1 |= a ^ m;
+		diff2 |= b ^ m;
+		diff3 |= c ^ m;
+	}
+	return (diff1 ? 1 : 0) | (diff2 ? 2 : 0) | (diff3 ? 4 : 0);
 }
 
 /**************************************************************************************
  *                                                                                    *
  * Function:  Check_Redundancy                                                 		  *
  * --------------------                                                               *
- * Reads the data from the 3 addresses where it is stored and chooses the value		  *
- * that coincides at least in 2 of the 3 addresses (in case one gets corrupted)		  *
- * All the addresses of variables with Redundancy follow the same pattern: each		  *
- * address is separated 0x4000 positions in memory									  *
+ * Reads the data from the 3 addresses where it is stored and keeps, bit by bit,	  *
+ * the value of at least 2 of the 3 copies (in case one gets corrupted). The copies	  *
+ * are at Address, Address + 0x1555 and Address + 0x2AAA. If a copy disagreed, the	  *
+ * range is queued to be repaired by Flash_Scrub									  *
  *                                                                                    *
  *  Address: first address to be read		                              			  *
  *	RxDef: Buffer to store the lecture that coincides at least 2 times				  *
@@ -173,27 +595,63 @@ void Flash_Read_Data (uint32_t StartPageAddress, uint8_t *RxBuf, uint16_t number
  **************************************************************************************/
 
 void Check_Redundancy(uint32_t Address, uint8_t *RxDef, uint16_t numberofbytes) {
-	uint8_t lect1[numberofbytes], lect2[numberofbytes], lect3[numberofbytes];
-	Flash_Read_Data(Address, lect1, numberofbytes);
-	Flash_Read_Data(Address + 0x1555, lect2, numberofbytes);
-	Flash_Read_Data(Address + 0x2AAA, lect3, numberofbytes);
+	if (Vote(Address, RxDef, numberofbytes) == 0) return;
 
-	bool coincidence12 = true, coincidence13 = true, coincidence23 = true;
-	for (int i = 0; i < numberofbytes; i++) {
-		if (lect1[i] != lect2[i]) coincidence12 = false;
-		if (lect1[i] != lect3[i]) coincidence13 = false;
-		if (lect2[i] != lect3[i]) coincidence23 = false;
+	for (uint8_t n = 0; n < scrub_count; n++) {
+		FlashScrub_t *entry = &scrub[(scrub_head + n) % FLASH_SCRUB_QUEUE];
+		if (entry->address == Address && entry->length >= numberofbytes) return;	//Already queued
 	}
-	if(coincidence12 || coincidence13) {
-		Flash_Read_Data(Address, RxDef, numberofbytes);
+	if (scrub_count < FLASH_SCRUB_QUEUE) {	//When full, it is queued again by the next read
+		FlashScrub_t *entry = &scrub[(scrub_head + scrub_count) % FLASH_SCRUB_QUEUE];
+		entry->address = Address;
+		entry->length = numberofbytes;
+		entry->done = 0;
+		scrub_count++;
 	}
-	else if(coincidence23) {
-		Flash_Read_Data(Address + 0x4000, RxDef, numberofbytes);
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Flash_Scrub                                                 		  	  *
+ * --------------------                                                               *
+ * Votes FLASH_SCRUB_CHUNK bytes of the oldest queued range again and rewrites only	  *
+ * the bytes of the copies that disagree (an EEPROM byte takes ~4 ms to program),	  *
+ * so it can be called from the main loop											  *
+ *                                                                                    *
+ *  returns: true if there is still something to repair                               *
+ *                                                                                    *
+ **************************************************************************************/
+bool Flash_Scrub(void)
+{
+	uint8_t voted[FLASH_SCRUB_CHUNK];
+
+	if (scrub_count == 0) return false;
+
+	FlashScrub_t *entry = &scrub[scrub_head];
+	uint32_t address = entry->address + entry->done;
+	uint16_t chunk = entry->length - entry->done;
+	if (chunk > FLASH_SCRUB_CHUNK) chunk = FLASH_SCRUB_CHUNK;
+
+	uint8_t bad = Vote(address, voted, chunk);
+	for (uint8_t copy = 0; copy < 3; copy++)
+	{
+		if (!(bad & (1 << copy))) continue;
+
+		uint32_t base = address + ((copy == 0) ? 0 : (copy == 1) ? REDUNDANT_COPY2 : REDUNDANT_COPY3);
+		for (uint16_t i = 0; i < chunk; i++)
+		{
+			if (*(const uint8_t *)(base + i) == voted[i]) continue;
+			if (Flash_Write_Data(base + i, &voted[i], 1) == 0) flash_stats.repairs++;
+		}
 	}
 
-	else {
-		*RxDef = lect1; /*PREGUNTAR QUÈ FER QUAN NO COINCIDEIX CAP LECTURA (POC PROBABLE)*/
+	entry->done += chunk;
+	if (entry->done >= entry->length)
+	{
+		scrub_head = (scrub_head + 1) % FLASH_SCRUB_QUEUE;
+		scrub_count--;
 	}
+	return scrub_count != 0;
 }
 
 /**************************************************************************************
@@ -211,7 +669,7 @@ void Check_Redundancy(uint32_t Address, uint8_t *RxDef, uint16_t numberofbytes)
  *                                                                                    *
  **************************************************************************************/
 void Read_Flash(uint32_t StartPageAddress, uint8_t *RxBuf, uint16_t numberofbytes) {
-	if (StartPageAddress >= 0x08080000 && StartPageAddress <= 0x08083FFF) {
+	if (StartPageAddress >= REDUNDANT_ADDR && StartPageAddress <= REDUNDANT_END_ADDR) {
 		Check_Redundancy(StartPageAddress, RxBuf, numberofbytes);
 	}
 	else {
@@ -0,0 +1,188 @@
+/*
+ * history.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  The page being filled is kept in RAM and written once, when the next record does
+ *  not fit (one page erase for ~100 samples). After a reset the ring is scanned for
+ *  the page with the highest sequence number; the samples of the RAM page are lost
+ *  unless History_Flush was called before (RESET2 does it).
+ */
+
+#include "history.h"
+#include "flash.h"
+#include "ecc.h"
+#include "timer.h"
+#include "stm32l1xx_hal.h"
+#include "string.h"
+
+static uint8_t page[FLASH_PAGE_SIZE];			//Page being filled
+static uint16_t fill = 0;						//Bytes used in page (0 => no header yet)
+static uint8_t newest = HISTORY_PAGES - 1;		//Last page written to the ring
+static uint16_t seq = 0;						//Sequence number of the page being filled
+static uint8_t stored = 0;						//Pages of the ring in use
+static uint8_t last[HISTORY_FIELDS];			//Previous sample
+static uint32_t last_time;						//Seconds of the previous sample
+static bool sampled = false;					//False until the first sample since the boot
+
+static uint32_t Page_Addr(uint8_t index)
+{
+	return HISTORY_ADDR + (uint32_t)index*FLASH_PAGE_SIZE;
+}
+
+static uint8_t Varint(uint8_t *out, uint16_t value)
+{
+	uint8_t n = 0;
+
+	while (value >= 0x80)
+	{
+		out[n++] = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	out[n++] = value;
+	return n;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  History_Init                                                 		  	  *
+ * --------------------                                                               *
+ * Scans the headers of the ring: the newest page is the one with the highest		  *
+ * sequence number (compared modulo 2^16)											  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void History_Init(void)
+{
+	bool found = false;
+
+	stored = 0;
+	for (uint8_t index = 0; index < HISTORY_PAGES; index++)
+	{
+		const uint8_t *header = (const uint8_t *)Page_Addr(index);
+		if (header[0] != HISTORY_MAGIC) continue;
+
+		uint16_t page_seq = (header[1] << 8) | header[2];
+		stored++;
+		if (!found || (int16_t)(page_seq - seq) > 0)
+		{
+			seq = page_seq;
+			newest = index;
+			found = true;
+		}
+	}
+	if (found) seq++;
+	fill = 0;
+	sampled = false;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  History_Flush                                                 		  *
+ * --------------------                                                               *
+ * Writes the page being filled to the next page of the ring (overwriting the		  *
+ * oldest one) and starts a new page												  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void History_Flush(void)
+{
+	if (fill == 0) return;
+
+	memset(&page[fill], 0, FLASH_PAGE_SIZE - fill);
+	newest = (newest + 1) % HISTORY_PAGES;
+	Flash_Write_Data(Page_Addr(newest), page, FLASH_PAGE_SIZE);
+	ECC_Protect(Page_Addr(newest), FLASH_PAGE_SIZE);
+	if (stored < HISTORY_PAGES) stored++;
+	seq++;
+	fill = 0;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  History_Sample                                                 		  *
+ * --------------------                                                               *
+ * Appends the snapshot stored by sensorReadings. The first sample of a page is		  *
+ * stored as it is, the next ones as deltas to the previous sample					  *
+ *                                                                                    *
+ *  returns: true if a sample has been taken		                                  *
+ *                                                                                    *
+ **************************************************************************************/
+bool History_Sample(void)
+{
+	uint8_t fields[HISTORY_FIELDS];
+	uint8_t record[3 + 2*HISTORY_FIELDS];
+	uint8_t length = 0;
+	uint16_t mask = 0;
+	uint32_t now = TimerGetCurrentTime() / 1000;		//RTC: the SysTick stops in the scheduler sleep
+
+	if (sampled && now - last_time < HISTORY_PERIOD) return false;
+
+	Read_Flash(TEMP_ADDR, fields, 7);
+	Read_Flash(VOLTAGE_ADDR, &fields[7], 1);
+	Read_Flash(CURRENT_ADDR, &fields[8], 1);
+	Read_Flash(BATT_LEVEL_ADDR, &fields[9], 1);
+
+	if (fill != 0)
+	{
+		for (uint8_t n = 0; n < HISTORY_FIELDS; n++)
+		{
+			if (fields[n] != last[n]) mask |= 1 << n;
+		}
+		length = Varint(record, (now - last_time > 0xFFFF) ? 0xFFFF : now - last_time);
+		length += Varint(&record[length], mask);
+		for (uint8_t n = 0; n < HISTORY_FIELDS; n++)
+		{
+			int8_t delta = fields[n] - last[n];
+			uint8_t zigzag = ((uint8_t)delta << 1) ^ (uint8_t)(delta >> 7);
+			if (mask & (1 << n)) length += Varint(&record[length], zigzag);
+		}
+		if (fill + length >= FLASH_PAGE_SIZE) History_Flush();	//Keep a 0 at the end of the page
+	}
+
+	if (fill == 0)
+	{
+		page[0] = HISTORY_MAGIC;
+		page[1] = seq >> 8;
+		page[2] = seq & 0xFF;
+		page[3] = now >> 24;
+		page[4] = now >> 16;
+		page[5] = now >> 8;
+		page[6] = now & 0xFF;
+		memcpy(&page[7], fields, HISTORY_FIELDS);
+		fill = HISTORY_PAGE_HEADER;
+	}
+	else
+	{
+		memcpy(&page[fill], record, length);
+		fill += length;
+	}
+
+	memcpy(last, fields, HISTORY_FIELDS);
+	last_time = now;
+	sampled = true;
+	return true;
+}
+
+uint8_t History_Pages(void)
+{
+	return stored;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  History_Page                                                 		  	  *
+ * --------------------                                                               *
+ *  back: 0 for the newest page, 1 for the previous one...                           *
+ *  seq_out: where the sequence number of the page is stored                          *
+ *                                                                                    *
+ *  returns: address of the page in the flash                                         *
+ *                                                                                    *
+ **************************************************************************************/
+uint32_t History_Page(uint8_t back, uint16_t *seq_out)
+{
+	*seq_out = seq - 1 - back;
+	return Page_Addr((newest + HISTORY_PAGES - back % HISTORY_PAGES) % HISTORY_PAGES);
+}
@@ -0,0 +1,143 @@
+/*
+ * i2cqueue.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  The next read is started from the completion (or error) interrupt of the
+ *  previous one, so a whole batch only costs the interrupts of the HAL. A read
+ *  that fails (no ACK, bus error) is marked and the batch goes on with the next.
+ */
+
+#include "i2cqueue.h"
+#include "scheduler.h"
+#include "timer.h"
+
+static I2C_HandleTypeDef *handle = NULL;
+static I2CTransfer_t *transfers;				//Batch being run
+static uint8_t total;							//Reads of the batch
+static volatile uint8_t current;				//Read in progress (total => batch ended)
+static I2CCallback_t done;
+static volatile bool busy = false;
+static TimerTime_t started;						//Time of the submission (RTC, it also runs in sleep)
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Start_Next                                                 		  	  *
+ * --------------------                                                               *
+ * Starts the read at current, skipping the ones that cannot be started. After the	  *
+ * last one, posts EVT_I2C (it is called from the interrupts)						  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+static void Start_Next(void)
+{
+	while (current < total)
+	{
+		I2CTransfer_t *transfer = &transfers[current];
+		if (HAL_I2C_Mem_Read_IT(handle, transfer->address, transfer->reg, I2C_MEMADD_SIZE_8BIT,
+				transfer->data, transfer->length) == HAL_OK) return;
+		transfer->ok = false;
+		current++;
+	}
+	Scheduler_Post(EVT_I2C);
+}
+
+static void OnBatchDone(void)
+{
+	if (current < total) return;				//Late event of a batch dropped by the timeout
+	busy = false;
+	if (done != NULL) done(transfers, total);
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  I2CQueue_Init                                                 		  *
+ * --------------------                                                               *
+ * Fast-mode needs PCLK1 >= 4 MHz; with a slower clock the bus stays at the speed	  *
+ * set by MX_I2C1_Init																  *
+ *                                                                                    *
+ *  hi2c: I2C of the sensors						                                  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void I2CQueue_Init(I2C_HandleTypeDef *hi2c)
+{
+	handle = hi2c;
+	Scheduler_Register(EVT_I2C, OnBatchDone);
+
+	if (hi2c->Init.ClockSpeed < I2CQUEUE_FAST_SPEED && HAL_RCC_GetPCLK1Freq() >= I2C_MIN_PCLK_FREQ_FAST)
+	{
+		hi2c->Init.ClockSpeed = I2CQUEUE_FAST_SPEED;
+		hi2c->Init.DutyCycle = I2C_DUTYCYCLE_2;
+		HAL_I2C_Init(hi2c);
+	}
+
+	HAL_NVIC_SetPriority(I2C1_EV_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+	HAL_NVIC_SetPriority(I2C1_ER_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  I2CQueue_Submit                                                 		  *
+ * --------------------                                                               *
+ * Starts the batch and returns at once. The batch (and the buffers of its reads)	  *
+ * must stay valid until the callback. A batch not finished after I2CQUEUE_TIMEOUT_MS *
+ * (stuck, or its EVT_I2C lost) is dropped without its callback, and if it was		  *
+ * stuck the peripheral is reset													  *
+ *                                                                                    *
+ *  batch: reads to do, in order					                                  *
+ *  count: number of reads							                                  *
+ *  callback: function called in the main loop when the batch ends                   *
+ *                                                                                    *
+ *  returns: false if the previous batch is still running                             *
+ *                                                                                    *
+ **************************************************************************************/
+bool I2CQueue_Submit(I2CTransfer_t *batch, uint8_t count, I2CCallback_t callback)
+{
+	if (handle == NULL) return false;
+
+	if (busy)
+	{
+		if (TimerGetElapsedTime(started) < I2CQUEUE_TIMEOUT_MS) return false;
+
+		busy = false;
+		if (current < total)	//Stuck (a slave holding the bus): start again from a clean peripheral
+		{
+			HAL_I2C_DeInit(handle);
+			HAL_I2C_Init(handle);
+		}
+	}
+
+	for (uint8_t n = 0; n < count; n++) batch[n].ok = true;
+	transfers = batch;
+	total = count;
+	current = 0;
+	done = callback;
+	started = TimerGetCurrentTime();
+	busy = true;
+	Start_Next();
+	return true;
+}
+
+bool I2CQueue_Busy(void)
+{
+	return busy;
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	if (hi2c != handle || current >= total) return;
+	current++;
+	Start_Next();
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+	if (hi2c != handle || current >= total) return;
+	transfers[current++].ok = false;
+	Start_Next();
+}
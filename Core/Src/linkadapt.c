@@ -0,0 +1,76 @@
+/*
+ * linkadapt.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  The SNR reported by the SX126x does not depend on the spreading factor, so the
+ *  SNR of an ACK received at the configured SF tells the margin of every SF. The SF
+ *  goes down (faster) one step per burst, and up (more robust) at once.
+ */
+
+#include "linkadapt.h"
+
+//Demodulation floor of SF7..SF12 (tenths of dB)
+static const int16_t snr_floor[LINK_MAX_SF - LINK_MIN_SF + 1] = { -75, -100, -125, -150, -175, -200 };
+
+static uint8_t link_sf;
+static uint8_t link_cr;
+
+void LinkAdapt_Init(uint8_t sf, uint8_t cr)
+{
+	link_sf = (sf < LINK_MIN_SF || sf > LINK_MAX_SF) ? LINK_MAX_SF : sf;
+	link_cr = (cr < LINK_MIN_CR || cr > LINK_MAX_CR) ? LINK_MIN_CR : cr;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  LinkAdapt_Update                                                 		  *
+ * --------------------                                                               *
+ *  snr: SNR of the last ACK (dB)					                                  *
+ *  loss: packets of the last burst lost (%)		                                  *
+ *                                                                                    *
+ *  returns: true if the SF or the CR of the next burst has changed                   *
+ *                                                                                    *
+ **************************************************************************************/
+bool LinkAdapt_Update(int8_t snr, uint8_t loss)
+{
+	uint8_t sf = LINK_MAX_SF, cr = link_cr;
+
+	if (!LINK_ADAPTATION) return false;
+
+	for (uint8_t candidate = LINK_MIN_SF; candidate <= LINK_MAX_SF; candidate++)
+	{
+		if (10*snr - snr_floor[candidate - LINK_MIN_SF] >= 10*LINK_SNR_MARGIN)
+		{
+			sf = candidate;
+			break;
+		}
+	}
+
+	if (loss >= LINK_LOSS_HIGH)
+	{
+		if (sf <= link_sf) sf = (link_sf < LINK_MAX_SF) ? link_sf + 1 : LINK_MAX_SF;
+		if (cr < LINK_MAX_CR) cr++;
+	}
+	else if (loss <= LINK_LOSS_LOW && cr > LINK_MIN_CR)
+	{
+		cr--;
+	}
+
+	if (sf < link_sf) sf = link_sf - 1;		//Faster only one step at a time
+
+	if (sf == link_sf && cr == link_cr) return false;
+	link_sf = sf;
+	link_cr = cr;
+	return true;
+}
+
+uint8_t LinkAdapt_SF(void)
+{
+	return link_sf;
+}
+
+uint8_t LinkAdapt_CR(void)
+{
+	return link_cr;
+}
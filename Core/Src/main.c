@@ -32,6 +32,8 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+#define MAIN_LOOP_PERIOD 1000 //ms between iterations of the state machine, the events are dispatched meanwhile
+#define SPECTRUM_SLICE 150 //ms of spectrogram per iteration: with the last bin (up to 256 ms) still below the IWDG window
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -94,13 +96,13 @@ int main(void)
   HAL_Init();
 
   /* USER CODE BEGIN Init */
-  pthread_t thread_comms;
-
-  bool payload_state; //bool which indicates when do we need to go to PAYLOAD state
+  uint8_t payload_state; //telecommand of the payload to run (TAKE_PHOTO or TAKE_RF), 0 when there is none
+  bool spectrum_running = false; //a spectrogram is being recorded, one slice per iteration
   bool comms_state; //bool which indicates if we are in region of contact with GS, then go to COMMS state
 
   uint8_t percentatge;
   uint8_t telecommand_aux;
+  uint8_t lastState = INIT; //state of the previous iteration, to detect the state transitions
 
   /* USER CODE END Init */
 
@@ -121,6 +123,13 @@ int main(void)
   MX_UART4_Init();
   MX_IWDG_Init();
   /* USER CODE BEGIN 2 */
+  Scheduler_Watchdog(&hiwdg); //Scheduler_Wait refreshes the IWDG, its waits are longer than the IWDG window
+  Settings_Load(); //RAM copy of the thresholds and configuration
+  NVLog_Init(); //find the latest persisted comms counters
+  Catalog_Init(); //stored images and their downlink progress (needs the image id of the log)
+  History_Init(); //find the newest page of the telemetry history
+  cameraInit(&huart4); //DMA channels of the camera UART
+  I2CQueue_Init(&hi2c1); //interrupts of the sensors I2C
   //stateMachine();
   /* USER CODE END 2 */
 
@@ -145,7 +154,11 @@ int main(void)
 				Read_Flash(COMMS_STATE_ADDR, &comms_state, 1);
 				if(payload_state) currentState = PAYLOAD; /*payload becomes true if a telecommand to acquire data is received*/
 				else if(comms_state)	currentState = COMMS;	/*comms becomes true when we have acquired the data and we need to send it*/
-				sensorReadings(&hi2c1); /*Updates the values of temperatures, voltages and currents*/
+				sensorReadings(); /*Starts the update of temperatures, voltages and currents, stored when the I2C batch ends*/
+				History_Sample(); /*Every HISTORY_PERIOD, appends them to the telemetry history*/
+				NVLog_Background(); /*Erases the next counters log sector in small steps*/
+				Flash_Scrub(); /*Repairs the redundant copies that disagreed in a read*/
+				ECC_Scrub(); /*Checks a few payload pages, fixing the single-bit errors*/
 				/*ADCS tasks needed??*/
 				//Add Rx mode here
 				Write_Flash(PREVIOUS_STATE_ADDR, IDLE, 1);
@@ -155,13 +168,9 @@ int main(void)
 		case COMMS:
 
 			//If it is the first time we enter in COMMS when getting contact with the Ground station:
-			configuration();
-			//pthread_create(&thread_comms, NULL, stateMachine(), NULL);	//INITIALIZE COMMS THREAD
-			stateMachine();	//this line must be deleted (initialize in thread)
-			//AFTER THAT => NOT ENTER IN COMMS TILL CONTACT TIME WITH GS ENDS
+			if (!isCommsRunning()) startComms();	//the comms state machine runs from the scheduler events, interleaved with the other states
 
-			//WHEN CONTACT TIME ENDS
-			//kill comms thread
+			//WHEN CONTACT TIME ENDS => stopComms()
 
 
 			/* check if the picture or spectrogram has to be sent and send it if needed */
@@ -191,6 +200,25 @@ int main(void)
 //				Write_Flash(PAYLOAD_STATE_ADDR, FALSE, 1);
 //			}
 
+			if(payload_state == TAKE_RF) {
+				/* The radio is taken from the comms until the spectrogram ends: memory full,
+				 * wrong band or contact with the GS */
+				if(!spectrum_running) {
+					if(isCommsRunning()) stopComms();
+					spectrum_running = Spectrum_Start();
+				}
+				uint32_t slice = HAL_GetTick();
+				while(spectrum_running && !comms_state && HAL_GetTick() - slice < SPECTRUM_SLICE) {
+					spectrum_running = Spectrum_Step();
+				}
+				if(!spectrum_running || comms_state) {
+					Spectrum_Stop();
+					spectrum_running = false;
+					payload_state = FALSE;
+					Write_Flash(PAYLOAD_STATE_ADDR, &payload_state, 1);
+				}
+			}
+
 			currentState = IDLE;
 			if(!system_state(&hi2c1)) currentState = CONTINGENCY;
 			Write_Flash(PREVIOUS_STATE_ADDR, PAYLOAD, 1);
@@ -205,7 +233,7 @@ int main(void)
 
 				  checkbatteries(&hi2c1); //check the batteries
 		  	  	  Read_Flash(BATT_LEVEL_ADDR, &percentatge, 1); //read the battery level and store it on the percentatge variable
-		  	 	  Read_Flash(EXIT_LOW_ADDR, &telecommand_aux, 1);//read the exit low flag and store it on the telecommand_aux
+		  	 	  telecommand_aux = Settings_Get()->exit_low;//read the exit low flag and store it on the telecommand_aux
 
 				  if (percentatge <= NOMINAL && percentatge >= LOW){ //if batteries are between those values stay on contingency
 					  enter_LPRun_Mode();
@@ -224,7 +252,7 @@ int main(void)
 
 				  checkbatteries(&hi2c1);
 		  	      Read_Flash(BATT_LEVEL_ADDR, &percentatge, 1);
-		  	      Read_Flash(EXIT_LOW_ADDR, &telecommand_aux, 1);
+		  	      telecommand_aux = Settings_Get()->exit_low;
 
 				  if (percentatge >= NOMINAL + THRESHOLD){ //look whether the batteries are OK or not to mover or not to IDLE
 
@@ -279,7 +307,8 @@ int main(void)
 		  	  checkbatteries(&hi2c1);
 		  	  Read_Flash(BATT_LEVEL_ADDR, &percentatge, 1);
 
-		  	  //END COMMS THREAD HERE
+		  	  stopComms(); //END COMMS HERE
+		  	  Flash_Flush(); //the IWDG will reset the system, do not lose the cached writes
 
 			  while (percentatge <= LOW && percentatge >= CRITICAL){ //if we are kept between those values it means we have not increased that much and neither decreased
 
@@ -305,7 +334,8 @@ int main(void)
 			  checkbatteries(&hi2c1);
 			  Read_Flash(BATT_LEVEL_ADDR, &percentatge, 1);
 
-		  	  //END COMMS THREAD HERE
+		  	  stopComms(); //END COMMS HERE
+		  	  Flash_Flush(); //the IWDG will reset the system, do not lose the cached writes
 
 
 			  while (percentatge <= CRITICAL ){
@@ -326,6 +356,14 @@ int main(void)
 	  break;
 
 	  }
+
+	  /* the cached flash pages are committed at every state transition */
+	  if (currentState != lastState) {
+		  Flash_Flush();
+		  lastState = currentState;
+	  }
+
+	  Scheduler_Wait(MAIN_LOOP_PERIOD); /* runs the comms events, the MCU sleeps when there are none */
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
@@ -0,0 +1,267 @@
+/*
+ * nvlog.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  The log uses two sectors of the data EEPROM (NVLOG_ADDR). Word 0 of a sector is
+ *  its header (magic + generation) and the rest are records appended in order:
+ *
+ *  	| key (8 bits) | value (16 bits) | check (8 bits) |
+ *
+ *  The active sector is the one with a valid header and the highest generation.
+ *  When it is full, the latest value of every key is copied to the other sector and
+ *  its header is written last, so a reset in the middle keeps the old sector valid.
+ *  The STM32L1 data EEPROM reads 0 once erased, so free words are the zero ones.
+ */
+
+#include "nvlog.h"
+#include "flash.h"
+#include "stm32l1xx_hal.h"
+
+#define NVLOG_MAGIC					0xC0DE
+#define NVLOG_SECTOR_WORDS			(NVLOG_SECTOR_SIZE/4)
+#define NVLOG_COMPACT_THRESHOLD		(3*NVLOG_SECTOR_WORDS/4)	//Background compaction above this
+
+static bool initialized = false;
+static uint8_t active;							//Active sector (0 or 1)
+static uint16_t generation;						//Generation of the active sector
+static uint16_t next;							//Next free word of the active sector
+static uint16_t clean_index;					//Next word of the inactive sector to erase
+static uint16_t values[NVLOG_KEYS+1];			//Latest value of every key
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Word_Addr                                                 		  	  *
+ * --------------------                                                               *
+ *  sector: sector number (0 or 1)					                                  *
+ *  index: word index inside the sector			                                      *
+ *                                                                                    *
+ *  returns: address of the word				                                      *
+ *                                                                                    *
+ **************************************************************************************/
+static uint32_t Word_Addr(uint8_t sector, uint16_t index)
+{
+	return NVLOG_ADDR + sector*NVLOG_SECTOR_SIZE + 4*index;
+}
+
+static uint32_t Read_Word(uint8_t sector, uint16_t index)
+{
+	return *(__IO uint32_t *)Word_Addr(sector, index);
+}
+
+static uint8_t Record_Check(uint8_t key, uint16_t value)
+{
+	return (uint8_t)(key + (value >> 8) + value) ^ 0xA5;
+}
+
+static uint32_t Record(uint8_t key, uint16_t value)
+{
+	return ((uint32_t)key << 24) | ((uint32_t)value << 8) | Record_Check(key, value);
+}
+
+static bool Header_Valid(uint32_t header)
+{
+	return (header >> 16) == NVLOG_MAGIC;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Clean_Word                                                 		  	  *
+ * --------------------                                                               *
+ * Erases the word clean_index of a sector (only if it is not already 0)			  *
+ *                                                                                    *
+ *  sector: sector being erased (the inactive one, or 0 when formatting)		      *
+ *                                                                                    *
+ *  returns: true if a write has been needed	                                      *
+ *                                                                                    *
+ **************************************************************************************/
+static bool Clean_Word(uint8_t sector)
+{
+	bool written = false;
+
+	if (Read_Word(sector, clean_index) != 0)
+	{
+		EEPROM_Write_Word(Word_Addr(sector, clean_index), 0);
+		written = true;
+	}
+	clean_index++;
+	return written;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Compact                                                 		  	  	  *
+ * --------------------                                                               *
+ * Copies the latest value of every key to the inactive sector and makes it the		  *
+ * active one. The header is written at the end										  *
+ *                                                                                    *
+ *  returns: 0 or the HAL flash error code                                            *
+ *                                                                                    *
+ **************************************************************************************/
+static uint32_t Compact(void)
+{
+	uint8_t other = active ^ 1;
+	uint16_t index = 1;
+	uint32_t error;
+
+	while (clean_index < NVLOG_SECTOR_WORDS) Clean_Word(other);	//Only if the background did not finish
+
+	for (uint8_t key = 1; key <= NVLOG_KEYS; key++)
+	{
+		if (values[key] == 0) continue;
+		error = EEPROM_Write_Word(Word_Addr(other, index), Record(key, values[key]));
+		if (error != 0) return error;
+		index++;
+	}
+	error = EEPROM_Write_Word(Word_Addr(other, 0), ((uint32_t)NVLOG_MAGIC << 16) | (uint16_t)(generation + 1));
+	if (error != 0) return error;
+
+	active = other;
+	generation++;
+	next = index;
+	clean_index = 0;			//The old sector has to be erased now
+	return 0;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  NVLog_Init                                                 		  	  *
+ * --------------------                                                               *
+ * Selects the active sector, finds its first free word with a binary search (the	  *
+ * records are contiguous) and reads the records backwards until the latest value	  *
+ * of every key has been found														  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void NVLog_Init(void)
+{
+	uint32_t header0 = Read_Word(0, 0), header1 = Read_Word(1, 0);
+	uint16_t lo, hi, mid;
+	uint8_t found = 0, remaining = NVLOG_KEYS;
+
+	for (uint8_t key = 0; key <= NVLOG_KEYS; key++) values[key] = 0;
+
+	if (Header_Valid(header0) && Header_Valid(header1))
+	{
+		active = ((int16_t)((uint16_t)header1 - (uint16_t)header0) > 0) ? 1 : 0;
+	}
+	else if (Header_Valid(header1))
+	{
+		active = 1;
+	}
+	else
+	{
+		active = 0;
+		if (!Header_Valid(header0))		//First boot: format the sector 0
+		{
+			clean_index = 0;
+			while (clean_index < NVLOG_SECTOR_WORDS) Clean_Word(0);
+			EEPROM_Write_Word(Word_Addr(0, 0), ((uint32_t)NVLOG_MAGIC << 16) | 1);
+		}
+	}
+	generation = (uint16_t)Read_Word(active, 0);
+
+	lo = 1;
+	hi = NVLOG_SECTOR_WORDS;
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (Read_Word(active, mid) != 0) lo = mid + 1;
+		else hi = mid;
+	}
+	next = lo;
+
+	for (uint16_t index = next; index > 1 && remaining > 0; index--)
+	{
+		uint32_t record = Read_Word(active, index - 1);
+		uint8_t key = record >> 24;
+		uint16_t value = (record >> 8) & 0xFFFF;
+
+		if (key == 0 || key > NVLOG_KEYS || Record_Check(key, value) != (record & 0xFF)) continue;	//Corrupted record
+		if (found & (1 << key)) continue;		//There is a newer record of this key
+		values[key] = value;
+		found |= 1 << key;
+		remaining--;
+	}
+
+	clean_index = 0;
+	initialized = true;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  NVLog_Read                                                 		  	  *
+ * --------------------                                                               *
+ *  key: key to read (NVLOG_COUNT_PACKET...)		                                  *
+ *                                                                                    *
+ *  returns: latest value of the key (0 if it has never been written)                 *
+ *                                                                                    *
+ **************************************************************************************/
+uint16_t NVLog_Read(uint8_t key)
+{
+	if (!initialized) NVLog_Init();
+	if (key == 0 || key > NVLOG_KEYS) return 0;
+	return values[key];
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  NVLog_Write                                                 		  	  *
+ * --------------------                                                               *
+ * Appends a record with the new value of the key. It costs one word write, unless	  *
+ * the active sector is full and it has to be compacted first						  *
+ *                                                                                    *
+ *  key: key to write (NVLOG_COUNT_PACKET...)		                                  *
+ *  value: new value								                                  *
+ *                                                                                    *
+ *  returns: 0 or the HAL flash error code                                            *
+ *                                                                                    *
+ **************************************************************************************/
+uint32_t NVLog_Write(uint8_t key, uint16_t value)
+{
+	uint32_t error;
+
+	if (!initialized) NVLog_Init();
+	if (key == 0 || key > NVLOG_KEYS || values[key] == value) return 0;
+
+	if (next == NVLOG_SECTOR_WORDS)
+	{
+		error = Compact();
+		if (error != 0) return error;
+	}
+
+	error = EEPROM_Write_Word(Word_Addr(active, next), Record(key, value));
+	if (error != 0) return error;
+	next++;
+	values[key] = value;
+	return 0;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  NVLog_Background                                                 		  *
+ * --------------------                                                               *
+ * To be called when the system is idle. It erases up to NVLOG_BACKGROUND_WORDS		  *
+ * words of the inactive sector and, once it is clean, compacts the active sector	  *
+ * if it is getting full, so NVLog_Write never has to wait for it					  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void NVLog_Background(void)
+{
+	uint8_t writes = 0;
+
+	if (!initialized) return;
+
+	while (clean_index < NVLOG_SECTOR_WORDS && writes < NVLOG_BACKGROUND_WORDS)
+	{
+		if (Clean_Word(active ^ 1)) writes++;
+	}
+
+	if (clean_index == NVLOG_SECTOR_WORDS && next >= NVLOG_COMPACT_THRESHOLD)
+	{
+		Compact();
+	}
+}
@@ -0,0 +1,64 @@
+/*
+ * packetizer.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  The time on air grows with the length, so the data size is found with a binary
+ *  search on Radio.TimeOnAir (integer only, a few us per call).
+ */
+
+#include "comms.h"
+#include "ecc.h"
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Packetizer_DataSize                                                 	  *
+ * --------------------                                                               *
+ * Longest data size (PKT_MIN_DATA to PKT_MAX_DATA) of a packet whose time on air is  *
+ * at most PKT_TARGET_TOA with the SF/BW/CR configured in the radio					  *
+ *                                                                                    *
+ *  returns: data size of the photo packets (bytes)                                   *
+ *                                                                                    *
+ **************************************************************************************/
+uint8_t Packetizer_DataSize(void)
+{
+	uint8_t low = PKT_MIN_DATA, high = PKT_MAX_DATA;
+
+	while (low < high)
+	{
+		uint8_t size = (low + high + 1) / 2;
+		if (Radio.TimeOnAir(MODEM_LORA, PKT_HEADER_SIZE + size) <= PKT_TARGET_TOA) low = size;
+		else high = size - 1;
+	}
+	return low;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Packetizer_Header                                                 	  *
+ * --------------------                                                               *
+ *  header: where the PKT_HEADER_SIZE bytes are written                               *
+ *  seq: sequence number of the packet (or id of the parity packet)                   *
+ *  image: id of the photo							                                  *
+ *  offset: position of the data in the photo		                                  *
+ *  data: data of the packet (RAM or flash)			                                  *
+ *  length: bytes of data							                                  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void Packetizer_Header(uint8_t *header, uint16_t seq, uint8_t image, uint16_t offset, const uint8_t *data, uint8_t length)
+{
+	uint16_t crc;
+
+	header[0] = seq >> 8;
+	header[1] = seq & 0xFF;
+	header[2] = image;
+	header[3] = offset >> 8;
+	header[4] = offset & 0xFF;
+	header[5] = length;
+	crc = ECC_CRC(0xFFFF, header, 6);			//Same CRC-16-CCITT as the check codes of the flash
+	crc = ECC_CRC(crc, data, length);
+	header[6] = crc >> 8;
+	header[7] = crc & 0xFF;
+}
@@ -7,16 +7,34 @@
 
 #include <payload_camera.h>
 #include <flash.h>
+#include <thumbnail.h>
+#include <ecc.h>
+#include <catalog.h>
 
 //VARIABLES
 uint8_t dataBuffer[201], bufferLength;
 uint32_t frameLength;
-uint16_t framePointer;
+uint32_t framePointer;
+uint32_t imageAddr = PHOTO_ADDR;	//slot of the image catalog being written
 
 uint8_t commInit[2] = {0x56, 0x00};
 uint8_t commCapture = 0x36;
 uint32_t bSize = 128;
 
+//DMA ENGINE (UART4 is served by DMA2 channel 3 (RX) and channel 5 (TX))
+DMA_HandleTypeDef hdma_uart4_rx;
+DMA_HandleTypeDef hdma_uart4_tx;
+uint8_t rxRing[CAM_RX_RING];	//circular DMA reception, written by the DMA and read by the parser
+uint16_t rxTail;				//next byte of rxRing to parse
+uint8_t cmdFrame[16];			//command being transmitted (the DMA reads it until the end of the transfer)
+const uint8_t readMarker[5] = {0x76, 0x00, 0x32, 0x00, 0x00};	//header and footer of the 0x32 response
+
+typedef enum {
+	CAM_HEADER,		//waiting for the 5 bytes before the data
+	CAM_DATA,		//data of the chunk, streamed to the flash
+	CAM_FOOTER,		//waiting for the 5 bytes after the data
+} CamParser_t;
+
 //COMANDOS
 uint8_t captureImageCmd[] = {0x01, 0x00};
 uint8_t stopCaptureCmd[] = {0x01, 0x03};
@@ -55,14 +73,16 @@ bool runCommand(UART_HandleTypeDef *huart, uint8_t command, uint8_t *hexData, ui
     readResponse(huart, 100, 10);
   }
 
-  // Send the data
-  HAL_UART_Transmit(huart, commInit, 2, HAL_MAX_DELAY);
-  HAL_UART_Transmit(huart, &command, 1, HAL_MAX_DELAY);
-
-  for (int i = 0; i < dataArrayLength; i++)
+  // Send the data, the whole command in one transfer
+  if (dataArrayLength > sizeof(cmdFrame) - 3)
   {
-	  HAL_UART_Transmit(huart, &hexData[i], 1, HAL_MAX_DELAY);
+    return false;
   }
+  cmdFrame[0] = commInit[0];
+  cmdFrame[1] = commInit[1];
+  cmdFrame[2] = command;
+  memcpy(&cmdFrame[3], hexData, dataArrayLength);
+  HAL_UART_Transmit(huart, cmdFrame, 3 + dataArrayLength, 100);
 
   // Check the data
   if (readResponse(huart, expLength, 100) != expLength)
@@ -83,6 +103,40 @@ bool runCommand(UART_HandleTypeDef *huart, uint8_t command, uint8_t *hexData, ui
   return true;
 }
 
+void cameraInit(UART_HandleTypeDef *huart)
+{ // Links the DMA channels of UART4 to the handle, used by retrieveImage
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  hdma_uart4_rx.Instance = DMA2_Channel3;
+  hdma_uart4_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_uart4_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_uart4_rx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_uart4_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_uart4_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_uart4_rx.Init.Mode = DMA_CIRCULAR;
+  hdma_uart4_rx.Init.Priority = DMA_PRIORITY_HIGH;
+  HAL_DMA_Init(&hdma_uart4_rx);
+  __HAL_LINKDMA(huart, hdmarx, hdma_uart4_rx);
+
+  hdma_uart4_tx.Instance = DMA2_Channel5;
+  hdma_uart4_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_uart4_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_uart4_tx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_uart4_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_uart4_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_uart4_tx.Init.Mode = DMA_NORMAL;
+  hdma_uart4_tx.Init.Priority = DMA_PRIORITY_LOW;
+  HAL_DMA_Init(&hdma_uart4_tx);
+  __HAL_LINKDMA(huart, hdmatx, hdma_uart4_tx);
+
+  HAL_NVIC_SetPriority(DMA2_Channel3_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Channel3_IRQn);
+  HAL_NVIC_SetPriority(DMA2_Channel5_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Channel5_IRQn);
+  HAL_NVIC_SetPriority(UART4_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(UART4_IRQn);
+}
+
 bool captureImage(UART_HandleTypeDef *huart){
 	return runCommand(huart, 0x36, captureImageCmd, sizeof(captureImageCmd), 5, true);
 }
@@ -117,47 +171,137 @@ void getFrameLength(UART_HandleTypeDef *huart)
   frameLength |= dataBuffer[8];
 }
 
-void retrieveImage(UART_HandleTypeDef *huart)
-{ // * Retrieve photo data
+static bool requestChunk(UART_HandleTypeDef *huart, uint16_t address, uint8_t length)
+{ // Sends the 0x32 read command of a chunk without waiting for the answer
+  uint32_t start = HAL_GetTick();
 
-	uint8_t dataVect[frameLength];
+  while (huart->gState != HAL_UART_STATE_READY) // previous command still being sent
+  {
+    if (HAL_GetTick() - start > CAM_TIMEOUT_MS) return false;
+  }
 
-	//todo errase this bucle. Use the memset function (search this function on the internet)
-	for(int i = 0; i < frameLength; i++){
-	  dataVect[i] = 0;
-	}
+  uint8_t readCmd[] = {0x56, 0x00, 0x32, 0x0C, 0x0, 0x0A, 0x0, 0x0,
+                       address >> 8, address & 0xFF, 0x0, 0x0,
+                       0x0, length, 0x0, 0x0A
+                      };
+  memcpy(cmdFrame, readCmd, sizeof(readCmd));
+  return HAL_UART_Transmit_DMA(huart, cmdFrame, sizeof(readCmd)) == HAL_OK;
+}
+
+bool retrieveImage(UART_HandleTypeDef *huart)
+{ // * Retrieve photo data, streamed to the flash page by page (no frame-sized buffer)
+  // The reception runs in a circular DMA buffer and the next chunk is requested as soon as
+  // the data of the previous one has arrived, so the capture time is set by the baud rate
+
+	CamParser_t state = CAM_HEADER;
+	uint8_t matched = 0;				// bytes of the header/footer found
+	uint8_t chunkLeft = 0;				// data bytes of the chunk being received
+	uint8_t nextLength;					// data bytes of the chunk requested
+	uint8_t retries = 0;
+	uint32_t lastRx;
+	bool ok = true;
+
+	framePointer = 0;
+	Flash_Stream_Begin(imageAddr, SLOT_THUMB_OFFSET); // the thumbnail goes after the photo
 
-	while (frameLength > 0)
+	rxTail = 0;
+	if (HAL_UART_Receive_DMA(huart, rxRing, CAM_RX_RING) != HAL_OK)
 	{
-		HAL_Delay(100);
+		return false;
+	}
+	nextLength = min(bSize, frameLength);
+	requestChunk(huart, framePointer, nextLength);
+	lastRx = HAL_GetTick();
 
-		int toRead = min(bSize, frameLength); // Bytes read each loop
-		uint8_t hexData[] = {0x0C, 0x0, 0x0A, 0x0, 0x0,
-							 framePointer >> 8, framePointer & 0xFF, 0x0, 0x0,
-							 0x0, toRead, 0x0, 0x0A
-							};
+	while (framePointer < frameLength || state != CAM_HEADER)
+	{
+		uint16_t head = (CAM_RX_RING - __HAL_DMA_GET_COUNTER(huart->hdmarx)) % CAM_RX_RING;
 
-		if (!runCommand(huart, 0x32, hexData, sizeof(hexData), 5, false))
+		if (head == rxTail)
 		{
-			HAL_Delay(1);
+			if (HAL_GetTick() - lastRx < CAM_TIMEOUT_MS) continue;
+
+			// Nothing received: ask again from the first byte not stored
+			if (state == CAM_FOOTER && framePointer >= frameLength) break;
+			if (++retries > CAM_RETRIES)
+			{
+				ok = false;
+				break;
+			}
+			if (huart->RxState == HAL_UART_STATE_READY) // reception aborted by a UART error
+			{
+				HAL_UART_Receive_DMA(huart, rxRing, CAM_RX_RING);
+				head = 0;
+			}
+			rxTail = head;
+			state = CAM_HEADER;
+			matched = 0;
+			nextLength = min(bSize, frameLength - framePointer);
+			requestChunk(huart, framePointer, nextLength);
+			lastRx = HAL_GetTick();
+			continue;
 		}
-		if (readResponse(huart, toRead + 5, 0xff) == 0) // +5 for verification header
+		lastRx = HAL_GetTick();
+
+		uint16_t used = 1;
+		uint8_t *data = &rxRing[rxTail];
+
+		if (state == CAM_DATA)
 		{
-			HAL_Delay(1);
+			used = min(((head > rxTail) ? head : CAM_RX_RING) - rxTail, chunkLeft);
+			if (Flash_Stream_Write(data, used) != 0) // full or flash error: the image is lost
+			{
+				ok = false;
+				break;
+			}
+			framePointer += used;
+			chunkLeft -= used;
+			if (chunkLeft == 0)
+			{
+				if (framePointer < frameLength) // pipelined with the footer of this chunk
+				{
+					nextLength = min(bSize, frameLength - framePointer);
+					requestChunk(huart, framePointer, nextLength);
+				}
+				retries = 0;
+				state = CAM_FOOTER;
+			}
 		}
-
-		for(int i = 0; i < toRead; i++){
-		  dataVect[framePointer+i] = dataBuffer[i];
+		else
+		{
+			if (*data == readMarker[matched]) matched++;
+			else matched = (*data == readMarker[0]) ? 1 : 0;
+
+			if (matched == sizeof(readMarker))
+			{
+				matched = 0;
+				if (state == CAM_HEADER)
+				{
+					chunkLeft = nextLength;
+					state = CAM_DATA;
+				}
+				else
+				{
+					state = CAM_HEADER;
+				}
+			}
 		}
-
-		framePointer += toRead;
-		frameLength -= toRead;
+		rxTail = (rxTail + used) % CAM_RX_RING;
 	}
 
-	Write_Flash(PHOTO_ADDR, dataVect, sizeof(dataVect));
+	HAL_UART_DMAStop(huart);
+	Flash_Stream_End();
+	return ok;
 }
 
 bool takePhoto(UART_HandleTypeDef *huart){
+	//slot for the new image (the oldest image already sent, if all are used)
+	int8_t slot = Catalog_Allocate(CATALOG_PRIORITY_NORMAL);
+	if(slot < 0){
+		return false;
+	}
+	imageAddr = Catalog_Addr(slot);
+
 	//takePhoto
 	if(!captureImage(huart)){
 		//todo create a protocol in order to handle errors in the communication
@@ -167,8 +311,31 @@ bool takePhoto(UART_HandleTypeDef *huart){
 	//actualize frameLength
 	getFrameLength(huart);
 
+	//the photo must fit before the thumbnail of its slot (a cut JPEG would be useless)
+	if(frameLength == 0 || frameLength > SLOT_THUMB_OFFSET){
+		stopCapture(huart);
+		return false;
+	}
+
+	//the old codes do not match the new image
+	ECC_Invalidate(imageAddr, SLOT_SIZE);
+
 	//saves the image to the flash mem
-	retrieveImage(huart);
+	if(!retrieveImage(huart)){
+		stopCapture(huart);
+		return false;
+	}
+
+	//grey thumbnail (1/8 scale) that the ground can ask for before the full image
+	uint16_t photoSize = frameLength;
+	uint16_t thumbSize = Thumbnail_Make(imageAddr, photoSize, imageAddr + SLOT_THUMB_OFFSET);
+
+	//check codes against radiation bit flips while the image waits to be sent
+	ECC_Protect(imageAddr, photoSize);
+	ECC_Protect(imageAddr + SLOT_THUMB_OFFSET, thumbSize);
+
+	//the image is only listed once it is complete
+	Catalog_Commit(slot, photoSize, thumbSize);
 
 	//stops capture
 	stopCapture(huart);
@@ -26,13 +26,13 @@
 #include "radio.h"
 #include "sx126x.h"
 #include "sx126x-board.h"
+#include "scheduler.h"
+#include "timeonair.h"
 
 /*!
  * \brief Initializes the radio
- *
- * \param [IN] events Structure containing the driver callback functions
  */
-void RadioInit( RadioEvents_t *events );
+void RadioInit( void );
 
 /*!
  * Return current radio status
@@ -196,6 +196,35 @@ uint32_t RadioTimeOnAir( RadioModems_t modem, uint8_t pktLen );
  */
 void RadioSend( uint8_t *buffer, uint8_t size );
 
+/*!
+ * \brief Sends a header followed by a payload without copying them to a single
+ *        buffer. The payload can be read straight from the flash
+ *
+ * \param [IN]: header     Header pointer
+ * \param [IN]: headerSize Header size
+ * \param [IN]: payload    Payload pointer
+ * \param [IN]: size       Payload size
+ */
+void RadioSendFrom( uint8_t *header, uint8_t headerSize, const uint8_t *payload, uint8_t size );
+
+/*!
+ * \brief Writes the next packet to the half of the radio buffer that is not
+ *        being transmitted
+ *
+ * \param [IN]: header     Header pointer
+ * \param [IN]: headerSize Header size
+ * \param [IN]: payload    Payload pointer ( NULL if size is 0 )
+ * \param [IN]: size       Payload size
+ */
+void RadioPreload( uint8_t *header, uint8_t headerSize, const uint8_t *payload, uint8_t size );
+
+/*!
+ * \brief Sends the packet written by RadioPreload
+ *
+ * \retval sent False if there is no packet preloaded
+ */
+bool RadioSendPreloaded( void );
+
 /*!
  * \brief Sets the radio in sleep mode
  */
@@ -293,10 +322,18 @@ void RadioSetPublicNetwork( bool enable );
 uint32_t RadioGetWakeupTime( void );
 
 /*!
- * \brief Process radio irq
+ * \brief Process radio irq: reads the IRQ status and queues the radio events
  */
 void RadioIrqProcess( void );
 
+/*!
+ * \brief Reads the next radio event
+ *
+ * \param [OUT] event Event read
+ * \retval      read  False if there is no event
+ */
+bool RadioGetEvent( RadioEvent_t *event );
+
 /*!
  * \brief Sets the radio in reception mode with Max LNA gain for the given time
  * \param [IN] timeout Reception timeout [ms]
@@ -328,6 +365,9 @@ const struct Radio_s Radio =
     RadioCheckRfFrequency,
     RadioTimeOnAir,
     RadioSend,
+    RadioSendFrom,
+    RadioPreload,
+    RadioSendPreloaded,
     RadioSleep,
     RadioStandby,
     RadioRx,
@@ -342,6 +382,7 @@ const struct Radio_s Radio =
     RadioSetPublicNetwork,
     RadioGetWakeupTime,
     RadioIrqProcess,
+    RadioGetEvent,
     // Available on SX126x only
     RadioRxBoosted,
     RadioSetRxDutyCycle
@@ -392,11 +433,6 @@ const FskBandwidth_t FskBandwidths[] =
 
 const RadioLoRaBandwidths_t Bandwidths[] = { LORA_BW_125, LORA_BW_250, LORA_BW_500 };
 
-//                                          SF12    SF11    SF10    SF9    SF8    SF7
-static double RadioLoRaSymbTime[3][6] = {{ 32.768, 16.384, 8.192, 4.096, 2.048, 1.024 },  // 125 KHz
-                                         { 16.384, 8.192,  4.096, 2.048, 1.024, 0.512 },  // 250 KHz
-                                         { 8.192,  4.096,  2.048, 1.024, 0.512, 0.256 }}; // 500 KHz
-
 uint8_t MaxPayloadLength = 0xFF;
 
 uint32_t TxTimeout = 0;
@@ -408,8 +444,6 @@ bool RxContinuous = false;
 PacketStatus_t RadioPktStatus;
 uint8_t RadioRxPayload[255];
 
-bool IrqFired = false;
-
 /*
  * SX126x DIO IRQ callback functions prototype
  */
@@ -446,9 +480,43 @@ typedef struct
 static RadioPublicNetwork_t RadioPublicNetwork = { false };
 
 /*!
- * Radio callbacks variable
+ * Radio events queue ( single producer: RadioIrqProcess, single consumer: RadioGetEvent )
  */
-static RadioEvents_t* RadioEvents;
+#define RADIO_EVENT_QUEUE_SIZE                      8   // Power of 2 ( free running 8 bits indexes )
+
+static RadioEvent_t RadioEventQueue[RADIO_EVENT_QUEUE_SIZE];
+static volatile uint8_t RadioEventHead = 0;
+static volatile uint8_t RadioEventTail = 0;
+static uint32_t RadioEventOverflows = 0;
+
+/*!
+ * Latency from the interrupt to RadioGetEvent [us]
+ */
+static uint32_t RadioEventLatency = 0;
+static uint32_t RadioEventMaxLatency = 0;
+
+/*!
+ * Cycle counter when the last DIO / timeout interrupt occurred
+ */
+static volatile uint32_t DioIrqTime = 0;
+static volatile uint32_t TimeoutIrqTime = 0;
+
+/*!
+ * Timeout timers expired, to be queued by RadioIrqProcess
+ */
+#define TIMEOUT_PENDING_TX                          0x01
+#define TIMEOUT_PENDING_RX                          0x02
+
+static volatile uint8_t TimeoutPending = 0;
+
+/*!
+ * TX pipeline: the packet on air and the next one use the two halves of the
+ * radio buffer ( the reception uses the first half, so it drops the next packet )
+ */
+static uint8_t TxBaseAddress = 0x00;        // Half being transmitted
+static uint8_t TxPreloadAddress = 0x00;     // Half of the next packet
+static uint8_t TxPreloadSize = 0;
+static bool TxPreloaded = false;
 
 /*
  * Public global variables
@@ -491,15 +559,15 @@ static uint8_t RadioGetFskBandwidthRegValue( uint32_t bandwidth )
     while( 1 );
 }
 
-void RadioInit( RadioEvents_t *events )
+void RadioInit( void )
 {
-    RadioEvents = events;
-
     SX126xInit( RadioOnDioIrq );
     SX126xSetStandby( STDBY_RC );
     SX126xSetRegulatorMode( USE_DCDC );
 
     SX126xSetBufferBaseAddress( 0x00, 0x00 );
+    TxBaseAddress = 0x00;
+    TxPreloaded = false;
     SX126xSetTxParams( 0, RADIO_RAMP_200_US );
     SX126xSetDioIrqParams( IRQ_RADIO_ALL, IRQ_RADIO_ALL, IRQ_RADIO_NONE, IRQ_RADIO_NONE );
 
@@ -507,7 +575,11 @@ void RadioInit( RadioEvents_t *events )
     TimerInit( &TxTimeoutTimer, RadioOnTxTimeoutIrq );
     TimerInit( &RxTimeoutTimer, RadioOnRxTimeoutIrq );
 
-    IrqFired = false;
+    BoardDisableIrq( );
+    TimeoutPending = 0;
+    RadioEventHead = RadioEventTail;
+    BoardEnableIrq( );
+    RadioEventMaxLatency = 0;
 }
 
 RadioState_t RadioGetStatus( void )
@@ -837,29 +909,29 @@ uint32_t RadioTimeOnAir( RadioModems_t modem, uint8_t pktLen )
         break;
     case MODEM_LORA:
         {
-            double ts = RadioLoRaSymbTime[SX126x.ModulationParams.Params.LoRa.Bandwidth - 4][12 - SX126x.ModulationParams.Params.LoRa.SpreadingFactor];
-            // time of preamble
-            double tPreamble = ( SX126x.PacketParams.Params.LoRa.PreambleLength + 4.25 ) * ts;
-            // Symbol length of payload and time
-            double tmp = ceil( ( 8 * pktLen - 4 * SX126x.ModulationParams.Params.LoRa.SpreadingFactor +
-                                 28 + 16 * SX126x.PacketParams.Params.LoRa.CrcMode -
-                                 ( ( SX126x.PacketParams.Params.LoRa.HeaderType == LORA_PACKET_FIXED_LENGTH ) ? 20 : 0 ) ) /
-                                 ( double )( 4 * ( SX126x.ModulationParams.Params.LoRa.SpreadingFactor -
-                                 ( ( SX126x.ModulationParams.Params.LoRa.LowDatarateOptimize > 0 ) ? 2 : 0 ) ) ) ) *
-                                 ( ( SX126x.ModulationParams.Params.LoRa.CodingRate % 4 ) + 4 );
-            double nPayload = 8 + ( ( tmp > 0 ) ? tmp : 0 );
-            double tPayload = nPayload * ts;
-            // Time on air
-            double tOnAir = tPreamble + tPayload;
-            // return milli seconds
-            airTime = floor( tOnAir + 0.999 );
+            // Integer only, see timeonair.c
+            TimeOnAirLoRa_t params = {
+                .bandwidth = SX126x.ModulationParams.Params.LoRa.Bandwidth,
+                .spreading_factor = SX126x.ModulationParams.Params.LoRa.SpreadingFactor,
+                .coding_rate = SX126x.ModulationParams.Params.LoRa.CodingRate,
+                .low_datarate_optimize = SX126x.ModulationParams.Params.LoRa.LowDatarateOptimize > 0,
+                .crc = SX126x.PacketParams.Params.LoRa.CrcMode == LORA_CRC_ON,
+                .fixed_length = SX126x.PacketParams.Params.LoRa.HeaderType == LORA_PACKET_FIXED_LENGTH,
+                .preamble = SX126x.PacketParams.Params.LoRa.PreambleLength,
+            };
+            airTime = TimeOnAir_LoRa( &params, pktLen );
         }
         break;
     }
     return airTime;
 }
 
-void RadioSend( uint8_t *buffer, uint8_t size )
+/*!
+ * \brief Enables the Tx interrupts and sets the length of the next packet
+ *
+ * \param [IN]: size       Packet size
+ */
+static void RadioPrepareTx( uint8_t size )
 {
     SX126xSetDioIrqParams( IRQ_TX_DONE | IRQ_RX_TX_TIMEOUT,
                            IRQ_TX_DONE | IRQ_RX_TX_TIMEOUT,
@@ -875,17 +947,77 @@ void RadioSend( uint8_t *buffer, uint8_t size )
         SX126x.PacketParams.Params.Gfsk.PayloadLength = size;
     }
     SX126xSetPacketParams( &SX126x.PacketParams );
+}
+
+/*!
+ * \brief Transmits from the start of the radio buffer ( Send / SendFrom )
+ */
+static void RadioTxFromStart( void )
+{
+    TxPreloaded = false;
+    if( TxBaseAddress != 0x00 )
+    {
+        TxBaseAddress = 0x00;
+        SX126xSetBufferBaseAddress( 0x00, 0x00 );
+    }
+}
+
+void RadioSend( uint8_t *buffer, uint8_t size )
+{
+    RadioTxFromStart( );
+    RadioPrepareTx( size );
 
     SX126xSendPayload( buffer, size, 0 );
     TimerSetValue( &TxTimeoutTimer, TxTimeout );
     TimerStart( &TxTimeoutTimer );
 }
 
+void RadioSendFrom( uint8_t *header, uint8_t headerSize, const uint8_t *payload, uint8_t size )
+{
+    RadioTxFromStart( );
+    RadioPrepareTx( headerSize + size );
+
+    SX126xSendPayloadFrom( header, headerSize, payload, size, 0 );
+    TimerSetValue( &TxTimeoutTimer, TxTimeout );
+    TimerStart( &TxTimeoutTimer );
+}
+
+void RadioPreload( uint8_t *header, uint8_t headerSize, const uint8_t *payload, uint8_t size )
+{
+    // The data buffer can be written while the other half is on air
+    TxPreloadAddress = TxBaseAddress ^ RADIO_TX_HALF_SIZE;
+    SX126xWriteBuffer( TxPreloadAddress, header, headerSize );
+    if( size > 0 )
+    {
+        SX126xWriteBuffer( TxPreloadAddress + headerSize, ( uint8_t* )payload, size );
+    }
+    TxPreloadSize = headerSize + size;
+    TxPreloaded = true;
+}
+
+bool RadioSendPreloaded( void )
+{
+    if( TxPreloaded == false )
+    {
+        return false;
+    }
+    TxPreloaded = false;
+    TxBaseAddress = TxPreloadAddress;
+    SX126xSetBufferBaseAddress( TxBaseAddress, 0x00 );
+    RadioPrepareTx( TxPreloadSize );
+
+    SX126xSetTx( 0 );
+    TimerSetValue( &TxTimeoutTimer, TxTimeout );
+    TimerStart( &TxTimeoutTimer );
+    return true;
+}
+
 void RadioSleep( void )
 {
     SleepParams_t params = { 0 };
 
     params.Fields.WarmStart = 1;
+    TxPreloaded = false;
     SX126xSetSleep( params );
 
     DelayMs( 2 );
@@ -898,6 +1030,8 @@ void RadioStandby( void )
 
 void RadioRx( uint32_t timeout )
 {
+    TxPreloaded = false;        // The reception overwrites the first half of the buffer
+
     SX126xSetDioIrqParams( IRQ_RADIO_ALL, //IRQ_RX_DONE | IRQ_RX_TX_TIMEOUT,
                            IRQ_RADIO_ALL, //IRQ_RX_DONE | IRQ_RX_TX_TIMEOUT,
                            IRQ_RADIO_NONE,
@@ -921,6 +1055,8 @@ void RadioRx( uint32_t timeout )
 
 void RadioRxBoosted( uint32_t timeout )
 {
+    TxPreloaded = false;        // The reception overwrites the first half of the buffer
+
     SX126xSetDioIrqParams( IRQ_RADIO_ALL, //IRQ_RX_DONE | IRQ_RX_TX_TIMEOUT,
                            IRQ_RADIO_ALL, //IRQ_RX_DONE | IRQ_RX_TX_TIMEOUT,
                            IRQ_RADIO_NONE,
@@ -944,6 +1080,8 @@ void RadioRxBoosted( uint32_t timeout )
 
 void RadioSetRxDutyCycle( uint32_t rxTime, uint32_t sleepTime )
 {
+    TxPreloaded = false;        // The reception overwrites the first half of the buffer
+
     SX126xSetRxDutyCycle( rxTime, sleepTime );
 }
 
@@ -1045,117 +1183,201 @@ uint32_t RadioGetWakeupTime( void )
 
 void RadioOnTxTimeoutIrq( void )
 {
-    if( ( RadioEvents != NULL ) && ( RadioEvents->TxTimeout != NULL ) )
+    TimeoutIrqTime = DWT->CYCCNT;
+    TimeoutPending |= TIMEOUT_PENDING_TX;
+    Scheduler_Post( EVT_RADIO );
+}
+
+void RadioOnRxTimeoutIrq( void )
+{
+    TimeoutIrqTime = DWT->CYCCNT;
+    TimeoutPending |= TIMEOUT_PENDING_RX;
+    Scheduler_Post( EVT_RADIO );
+}
+
+void RadioOnDioIrq( void )
+{
+    DioIrqTime = DWT->CYCCNT;
+    Scheduler_Post( EVT_RADIO );    // RadioIrqProcess runs from the scheduler, out of the interrupt
+}
+
+/*!
+ * \brief Adds an event at the end of the queue. Only RadioIrqProcess adds events
+ *        and only RadioGetEvent removes them, so no lock is needed
+ *
+ * \param [IN] type    Event type
+ * \param [IN] irqTime Cycle counter when the interrupt occurred
+ * \retval     event   Event to fill, NULL if the queue is full
+ */
+static RadioEvent_t* RadioPushEvent( RadioEventType_t type, uint32_t irqTime )
+{
+    uint8_t tail = RadioEventTail;
+    RadioEvent_t *event;
+
+    if( ( uint8_t )( tail - RadioEventHead ) >= RADIO_EVENT_QUEUE_SIZE )
     {
-        RadioEvents->TxTimeout( );
+        RadioEventOverflows++;
+        return NULL;
     }
+    event = &RadioEventQueue[tail % RADIO_EVENT_QUEUE_SIZE];
+    memset( event, 0, sizeof( RadioEvent_t ) );
+    event->Type = type;
+    event->IrqTime = irqTime;
+    return event;
 }
 
-void RadioOnRxTimeoutIrq( void )
+/*!
+ * \brief Makes the last event filled visible to RadioGetEvent
+ */
+static void RadioCommitEvent( void )
 {
-    if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
+    __DMB( );       // The event is written before the index
+    RadioEventTail++;
+    Scheduler_Post( EVT_RADIO_EVENT );
+}
+
+bool RadioGetEvent( RadioEvent_t *event )
+{
+    uint8_t head = RadioEventHead;
+    uint32_t latency;
+
+    if( head == RadioEventTail )
+    {
+        return false;
+    }
+    __DMB( );       // The index is read before the event
+    *event = RadioEventQueue[head % RADIO_EVENT_QUEUE_SIZE];
+    __DMB( );
+    RadioEventHead = head + 1;
+
+    latency = ( DWT->CYCCNT - event->IrqTime ) / ( SystemCoreClock / 1000000 );
+    RadioEventLatency = latency;
+    if( latency > RadioEventMaxLatency )
     {
-        RadioEvents->RxTimeout( );
+        RadioEventMaxLatency = latency;
     }
+    return true;
 }
 
-void RadioOnDioIrq( void )
+void RadioGetEventLatency( uint32_t *last, uint32_t *max )
 {
-    IrqFired = true;
+    *last = RadioEventLatency;
+    *max = RadioEventMaxLatency;
 }
 
 void RadioIrqProcess( void )
 {
-    if( IrqFired == true )
+    RadioEvent_t *event;
+    uint32_t irqTime = DioIrqTime;
+    uint8_t timeouts;
+
+    BoardDisableIrq( );
+    timeouts = TimeoutPending;
+    TimeoutPending = 0;
+    BoardEnableIrq( );
+
+    if( ( timeouts & TIMEOUT_PENDING_TX ) && ( event = RadioPushEvent( RADIO_EVENT_TX_TIMEOUT, TimeoutIrqTime ) ) != NULL )
     {
-        BoardDisableIrq( );
-        IrqFired = false;
-        BoardEnableIrq( );
+        RadioCommitEvent( );
+    }
+    if( ( timeouts & TIMEOUT_PENDING_RX ) && ( event = RadioPushEvent( RADIO_EVENT_RX_TIMEOUT, TimeoutIrqTime ) ) != NULL )
+    {
+        RadioCommitEvent( );
+    }
 
-        uint16_t irqRegs = SX126xGetIrqStatus( );
+    // The status is read once: every event of this interrupt comes from it
+    uint16_t irqRegs = SX126xGetIrqStatus( );
 
-        SX126xClearIrqStatus( IRQ_RADIO_ALL );
+    if( irqRegs == 0 )
+    {
+        return;     // Already processed ( one EVT_RADIO per DIO interrupt ) or timeout only
+    }
+    SX126xClearIrqStatus( IRQ_RADIO_ALL );
 
-        if( ( irqRegs & IRQ_TX_DONE ) == IRQ_TX_DONE )
+    if( ( irqRegs & IRQ_TX_DONE ) == IRQ_TX_DONE )
+    {
+        TimerStop( &TxTimeoutTimer );
+        if( ( event = RadioPushEvent( RADIO_EVENT_TX_DONE, irqTime ) ) != NULL )
         {
-            TimerStop( &TxTimeoutTimer );
-            if( ( RadioEvents != NULL ) && ( RadioEvents->TxDone != NULL ) )
-            {
-                RadioEvents->TxDone( );
-            }
+            RadioCommitEvent( );
         }
+    }
 
-        if( ( irqRegs & IRQ_RX_DONE ) == IRQ_RX_DONE )
-        {
-            uint8_t size;
+    if( ( irqRegs & IRQ_RX_DONE ) == IRQ_RX_DONE )
+    {
+        uint8_t size;
 
-            TimerStop( &RxTimeoutTimer );
-            SX126xGetPayload( RadioRxPayload, &size , 255 );
-            SX126xGetPacketStatus( &RadioPktStatus );
-            if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
-            {
-                RadioEvents->RxDone( RadioRxPayload, size, RadioPktStatus.Params.LoRa.SignalRssiPkt, RadioPktStatus.Params.LoRa.SnrPkt );
-            }
+        TimerStop( &RxTimeoutTimer );
+        SX126xGetPayload( RadioRxPayload, &size , 255 );
+        SX126xGetPacketStatus( &RadioPktStatus );
+        if( ( event = RadioPushEvent( RADIO_EVENT_RX_DONE, irqTime ) ) != NULL )
+        {
+            event->Payload = RadioRxPayload;
+            event->Size = size;
+            event->Rssi = RadioPktStatus.Params.LoRa.SignalRssiPkt;
+            event->Snr = RadioPktStatus.Params.LoRa.SnrPkt;
+            RadioCommitEvent( );
         }
+    }
 
-        if( ( irqRegs & IRQ_CRC_ERROR ) == IRQ_CRC_ERROR )
+    if( ( irqRegs & IRQ_CRC_ERROR ) == IRQ_CRC_ERROR )
+    {
+        if( ( event = RadioPushEvent( RADIO_EVENT_RX_ERROR, irqTime ) ) != NULL )
         {
-            if( ( RadioEvents != NULL ) && ( RadioEvents->RxError ) )
-            {
-                RadioEvents->RxError( );
-            }
+            RadioCommitEvent( );
         }
+    }
 
-        if( ( irqRegs & IRQ_CAD_DONE ) == IRQ_CAD_DONE )
+    if( ( irqRegs & IRQ_CAD_DONE ) == IRQ_CAD_DONE )
+    {
+        if( ( event = RadioPushEvent( RADIO_EVENT_CAD_DONE, irqTime ) ) != NULL )
         {
-            if( ( RadioEvents != NULL ) && ( RadioEvents->CadDone != NULL ) )
-            {
-                RadioEvents->CadDone( ( ( irqRegs & IRQ_CAD_ACTIVITY_DETECTED ) == IRQ_CAD_ACTIVITY_DETECTED ) );
-            }
+            event->ChannelActivityDetected = ( ( irqRegs & IRQ_CAD_ACTIVITY_DETECTED ) == IRQ_CAD_ACTIVITY_DETECTED );
+            RadioCommitEvent( );
         }
+    }
 
-        if( ( irqRegs & IRQ_RX_TX_TIMEOUT ) == IRQ_RX_TX_TIMEOUT )
+    if( ( irqRegs & IRQ_RX_TX_TIMEOUT ) == IRQ_RX_TX_TIMEOUT )
+    {
+        if( SX126xGetOperatingMode( ) == MODE_TX )
         {
-            if( SX126xGetOperatingMode( ) == MODE_TX )
+            TimerStop( &TxTimeoutTimer );
+            if( ( event = RadioPushEvent( RADIO_EVENT_TX_TIMEOUT, irqTime ) ) != NULL )
             {
-                TimerStop( &TxTimeoutTimer );
-                if( ( RadioEvents != NULL ) && ( RadioEvents->TxTimeout != NULL ) )
-                {
-                    RadioEvents->TxTimeout( );
-                }
+                RadioCommitEvent( );
             }
-            else if( SX126xGetOperatingMode( ) == MODE_RX )
+        }
+        else if( SX126xGetOperatingMode( ) == MODE_RX )
+        {
+            TimerStop( &RxTimeoutTimer );
+            if( ( event = RadioPushEvent( RADIO_EVENT_RX_TIMEOUT, irqTime ) ) != NULL )
             {
-                TimerStop( &RxTimeoutTimer );
-                if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
-                {
-                    RadioEvents->RxTimeout( );
-                }
+                RadioCommitEvent( );
             }
         }
+    }
 
-        if( ( irqRegs & IRQ_PREAMBLE_DETECTED ) == IRQ_PREAMBLE_DETECTED )
-        {
-            //__NOP( );
-        }
+    if( ( irqRegs & IRQ_PREAMBLE_DETECTED ) == IRQ_PREAMBLE_DETECTED )
+    {
+        //__NOP( );
+    }
 
-        if( ( irqRegs & IRQ_SYNCWORD_VALID ) == IRQ_SYNCWORD_VALID )
-        {
-            //__NOP( );
-        }
+    if( ( irqRegs & IRQ_SYNCWORD_VALID ) == IRQ_SYNCWORD_VALID )
+    {
+        //__NOP( );
+    }
 
-        if( ( irqRegs & IRQ_HEADER_VALID ) == IRQ_HEADER_VALID )
-        {
-            //__NOP( );
-        }
+    if( ( irqRegs & IRQ_HEADER_VALID ) == IRQ_HEADER_VALID )
+    {
+        //__NOP( );
+    }
 
-        if( ( irqRegs & IRQ_HEADER_ERROR ) == IRQ_HEADER_ERROR )
+    if( ( irqRegs & IRQ_HEADER_ERROR ) == IRQ_HEADER_ERROR )
+    {
+        TimerStop( &RxTimeoutTimer );
+        if( ( event = RadioPushEvent( RADIO_EVENT_RX_TIMEOUT, irqTime ) ) != NULL )
         {
-            TimerStop( &RxTimeoutTimer );
-            if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
-            {
-                RadioEvents->RxTimeout( );
-            }
+            RadioCommitEvent( );
         }
     }
 }
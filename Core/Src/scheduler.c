@@ -0,0 +1,186 @@
+/*
+ * scheduler.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  The queue is a ring of event ids shared with the interrupts, so it is only
+ *  modified with the interrupts disabled (a few instructions). The handlers run
+ *  in the main loop context and must not block: long jobs are split in steps that
+ *  post the next event.
+ */
+
+#include "scheduler.h"
+#include "board.h"
+
+static EventHandler_t handlers[EVT_COUNT];
+static uint8_t queue[SCHEDULER_QUEUE_SIZE];
+static volatile uint8_t head = 0;				//Next event to dispatch
+static volatile uint8_t tail = 0;				//Next free position
+static uint32_t overflows = 0;					//Events lost (queue full)
+
+static TimerEvent_t TickTimer;					//Timer of Scheduler_Wait
+static volatile bool tick = false;
+
+static IWDG_HandleTypeDef *watchdog = NULL;		//Refreshed by Scheduler_Wait
+static TimerEvent_t SliceTimer;					//Wakes the core up to refresh the watchdog
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Scheduler_Register                                                 	  *
+ * --------------------                                                               *
+ *  event: event to handle							                                  *
+ *  handler: function called when the event is dispatched                            *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void Scheduler_Register(Event_t event, EventHandler_t handler)
+{
+	if (event < EVT_COUNT) handlers[event] = handler;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Scheduler_Post                                                 		  *
+ * --------------------                                                               *
+ * Adds an event at the end of the queue. It can be called from an interrupt		  *
+ *                                                                                    *
+ *  event: event to post							                                  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void Scheduler_Post(Event_t event)
+{
+	BoardDisableIrq();
+	uint8_t next = (tail + 1) % SCHEDULER_QUEUE_SIZE;
+	if (next == head)
+	{
+		overflows++;
+	}
+	else
+	{
+		queue[tail] = event;
+		tail = next;
+	}
+	BoardEnableIrq();
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Scheduler_Dispatch                                                 	  *
+ * --------------------                                                               *
+ * Runs the handlers of the queued events (also the ones posted meanwhile)			  *
+ *                                                                                    *
+ *  returns: false if the queue was empty			                                  *
+ *                                                                                    *
+ **************************************************************************************/
+bool Scheduler_Dispatch(void)
+{
+	bool dispatched = false;
+
+	while (head != tail)
+	{
+		Event_t event = queue[head];
+
+		BoardDisableIrq();
+		head = (head + 1) % SCHEDULER_QUEUE_SIZE;
+		BoardEnableIrq();
+
+		if (handlers[event] != NULL) handlers[event]();
+		dispatched = true;
+	}
+	return dispatched;
+}
+
+static void OnTick(void)
+{
+	Scheduler_Post(EVT_TICK);
+}
+
+static void OnSlice(void)
+{
+	TimerStart(&SliceTimer);					//The WFI returns, the loop refreshes the watchdog
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Scheduler_Watchdog                                                 	  *
+ * --------------------                                                               *
+ * Sets the IWDG refreshed while waiting. Scheduler_Wait then sleeps in slices of	  *
+ * half the IWDG window (at the typical LSI, which runs up to 56 kHz: the shortest	  *
+ * window is still longer than the slice) and refreshes it at each wake-up, so a	  *
+ * wait longer than the window does not reset the MCU. A handler that hangs stops	  *
+ * the refresh and the IWDG resets it as before										  *
+ *                                                                                    *
+ *  hiwdg: initialized IWDG (HAL_IWDG_Init)			                                  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void Scheduler_Watchdog(IWDG_HandleTypeDef *hiwdg)
+{
+	uint32_t window = ((4 << hiwdg->Init.Prescaler)*(hiwdg->Init.Reload + 1))/(LSI_VALUE/1000);	//ms
+
+	watchdog = hiwdg;
+	TimerInit(&SliceTimer, OnSlice);
+	TimerSetValue(&SliceTimer, (window/2 > 0) ? window/2 : 1);
+}
+
+static void TickHandler(void)
+{
+	tick = true;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Scheduler_Wait                                                 		  *
+ * --------------------                                                               *
+ * Dispatches the events until period ms have elapsed. When there is nothing to do,	  *
+ * the MCU sleeps until the next interrupt. The queue is checked with the interrupts  *
+ * disabled, so an event posted just before the WFI still wakes it up. With a		  *
+ * watchdog (Scheduler_Watchdog), no sleep lasts more than a slice and the IWDG is	  *
+ * refreshed at each pass															  *
+ *                                                                                    *
+ *  period: time to wait (ms)						                                  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void Scheduler_Wait(uint32_t period)
+{
+	static bool initialized = false;
+
+	if (!initialized)
+	{
+		TimerInit(&TickTimer, OnTick);
+		Scheduler_Register(EVT_TICK, TickHandler);
+		initialized = true;
+	}
+
+	tick = false;
+	TimerSetValue(&TickTimer, period);
+	TimerStart(&TickTimer);
+	if (watchdog != NULL) TimerStart(&SliceTimer);
+
+	while (!tick)
+	{
+		if (watchdog != NULL) HAL_IWDG_Refresh(watchdog);
+		if (Scheduler_Dispatch()) continue;
+
+		BoardDisableIrq();
+		if (head == tail)
+		{
+			HAL_SuspendTick();			//The SysTick would wake the core every ms
+			HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+			HAL_ResumeTick();
+		}
+		BoardEnableIrq();
+	}
+	if (watchdog != NULL) TimerStop(&SliceTimer);
+}
+
+uint32_t Scheduler_Overflows(void)
+{
+	return overflows;
+}
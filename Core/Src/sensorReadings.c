@@ -12,79 +12,66 @@
  */
 
 #include "sensorReadings.h"
+#include "i2cqueue.h"
+
+#define TEMP_SENSORS	6
+
+enum { BATT_TEMP = TEMP_SENSORS, BATT_VOLTAGE, BATT_CURRENT, READINGS };
+
+static const uint8_t ADDR[TEMP_SENSORS] = {/*Adreça 1, Adreça 2, etc*/};//adreces deks diferents sensors de temperatura
+static uint8_t buf[READINGS][2];				//Bytes read from every register
+static I2CTransfer_t batch[READINGS];
+static Temperatures temperatures_local;			//Last readings, kept when a sensor does not answer
 
 /**************************************************************************************
  *                                                                                    *
  * Function:  acquireTemp	                                             	  		  *
  * --------------------                                                               *
- * Reads temperatures from all the sensors, and stores the struct in memory			  *
- *																					  *
- *  hi2c: I2C to read from the temperature sensors				    				  *
+ * Converts the temperatures read by the last batch, and stores the struct in memory	  *
  *															                          *
  *  returns: Nothing									                              *
  *  		 																		  *
  **************************************************************************************/
-void acquireTemp(I2C_HandleTypeDef *hi2c){
-	Temperatures temperatures_local;
+void acquireTemp(void){
 	int i;
-	HAL_StatusTypeDef ret;
-	uint8_t buf[6];
 	int16_t val;
-	uint8_t REG_TEMP = 0x00;
 	float temp_c; //defineixo float però no sé si es pot guardar al tipus Temperatures.raw
-	uint8_t ADDR[6] = {/*Adreça 1, Adreça 2, etc*/};//adreces deks diferents sensors de temperatura
-	for(i=0; i < 6; i++){
-		// Tell TMP102 that we want to read from the temperature register
-		buf[0] = REG_TEMP;
-		ret = HAL_I2C_Master_Transmit(&hi2c, ADDR[i], buf, 1, 1000);
-		if ( ret != HAL_OK ) {
-			//strcpy((char*)buf, "Error Tx\r\n");
-		} else {
-			  // Read 2 bytes from the temperature register
-			  ret = HAL_I2C_Master_Receive(&hi2c, ADDR[i], buf, 2, 1000);
-			  if ( ret != HAL_OK ) {
-				  //strcpy((char*)buf, "Error Rx\r\n");
-			  } else {
-				  //Combine the bytes
-				  val = ((int16_t)buf[0] << 4) | (buf[1] >> 4);
+	for(i=0; i < TEMP_SENSORS; i++){
+		if (!batch[i].ok) continue; //the sensor did not answer, keep its last value
+		//Combine the bytes
+		val = ((int16_t)buf[i][0] << 4) | (buf[i][1] >> 4);
 
-				  // Convert to 2's complement, since temperature can be negative
-				  if ( val > 0x7FF ) {
-					  val |= 0xF000;
-				  }
-				  // Convert to float temperature value (Celsius)
-				  temp_c = val * 0.0625;
-				  switch(i) {
-				  case 0:
-					  temperatures_local.fields.temp1 = temp_c;
-					  break;
-				  case 1:
-					  temperatures_local.fields.temp2 = temp_c;
-					  break;
-				  case 2:
-					  temperatures_local.fields.temp3 = temp_c;
-					  break;
-				  case 3:
-					  temperatures_local.fields.temp4 = temp_c;
-					  break;
-				  case 4:
-					  temperatures_local.fields.temp5 = temp_c;
-					  break;
-				  case 5:
-					  temperatures_local.fields.temp6 = temp_c;
-					  break;
-				  default:
-					  break;
-				  }
-			  }
+		// Convert to 2's complement, since temperature can be negative
+		if ( val > 0x7FF ) {
+			val |= 0xF000;
+		}
+		// Convert to float temperature value (Celsius)
+		temp_c = val * 0.0625;
+		switch(i) {
+		case 0:
+			temperatures_local.fields.temp1 = temp_c;
+			break;
+		case 1:
+			temperatures_local.fields.temp2 = temp_c;
+			break;
+		case 2:
+			temperatures_local.fields.temp3 = temp_c;
+			break;
+		case 3:
+			temperatures_local.fields.temp4 = temp_c;
+			break;
+		case 4:
+			temperatures_local.fields.temp5 = temp_c;
+			break;
+		case 5:
+			temperatures_local.fields.temp6 = temp_c;
+			break;
+		default:
+			break;
 		}
 	}
-	ret = HAL_I2C_Master_Transmit(hi2c, BATTSENSOR_ADDR, (uint8_t*)0x0A, 1, 500); //we want to read from the register 0x0A
-	if (ret != HAL_OK) {
-
-	} else {
-		HAL_I2C_Master_Receive(hi2c, BATTSENSOR_ADDR, &buf, 1, 500);
-		val = ((int16_t)buf[0] << 4);
+	if (batch[BATT_TEMP].ok) {
+		val = ((int16_t)buf[BATT_TEMP][0] << 4);
 		  // Convert to 2's complement, since temperature can be negative
 		if ( val > 0x7FF ) {
 			val |= 0xF000;
@@ -100,25 +87,17 @@ void acquireTemp(I2C_HandleTypeDef *hi2c){
  *                                                                                    *
  * Function:  acquireVoltage                                             	  		  *
  * --------------------                                                               *
- * Reads Voltages from all the sensors, and stores the struct in memory				  *
- *																					  *
- *  hi2c: I2C to read from the sensors							    				  *
+ * Converts the voltage read by the last batch, and stores it in memory				  *
  *															                          *
  *  returns: Nothing									                              *
  *  		 																		  *
  **************************************************************************************/
-void acquireVoltage(I2C_HandleTypeDef *hi2c){
-	uint8_t buf, value_to_store;
-	HAL_StatusTypeDef ret;
+void acquireVoltage(void){
+	uint8_t value_to_store;
 	float volt_mV;
-	ret = HAL_I2C_Master_Transmit(hi2c, BATTSENSOR_ADDR, (uint8_t*)0x0C, 1, 500); //we want to read from the register 0x0C
-	if (ret != HAL_OK) {
-
-	} else {
-		HAL_I2C_Master_Receive(hi2c, BATTSENSOR_ADDR, &buf, 1, 500);
-	}
+	if (!batch[BATT_VOLTAGE].ok) return;
 	//To obtain the value in mV
-	volt_mV = (buf/32)*4.88;
+	volt_mV = (buf[BATT_VOLTAGE][0]/32)*4.88;
 	//We want 1 decimal
 	value_to_store = volt_mV/100;
 	Write_Flash(VOLTAGE_ADDR, &value_to_store, 1);
@@ -129,43 +108,53 @@ void acquireVoltage(I2C_HandleTypeDef *hi2c){
  *                                                                                    *
  * Function:  acquireCurrents                                            	  		  *
  * --------------------                                                               *
- * Reads currents from all the sensors, and stores the struct in memory				  *
- *																					  *
- *  hi2c: I2C to read from the sensors							    				  *
+ * Converts the current read by the last batch, and stores it in memory				  *
  *															                          *
  *  returns: Nothing									                              *
  *  		 																		  *
  **************************************************************************************/
-void acquireCurrents(I2C_HandleTypeDef *hi2c){
-	uint8_t buf[1], value_to_store;
-	HAL_StatusTypeDef ret;
+void acquireCurrents(void){
+	uint8_t value_to_store;
 	float current;
-	ret = HAL_I2C_Master_Transmit(hi2c, BATTSENSOR_ADDR, (uint8_t*)0x08, 1, 500); //we want to read from the register 0x08
-	if (ret != HAL_OK) {
-
-	} else {
-		HAL_I2C_Master_Receive(hi2c, BATTSENSOR_ADDR, &buf, 1, 500);
-	}
+	if (!batch[BATT_CURRENT].ok) return;
 	//To obtain the value in mV
-	current = buf[0]*1.0416*pow(10,-4);
+	current = buf[BATT_CURRENT][0]*1.0416*pow(10,-4);
 	//We want 1 decimal
 	value_to_store = current;
 	Write_Flash(CURRENT_ADDR, &value_to_store, 1);
 }
 
+/*Called in the main loop when the batch of sensorReadings ends*/
+static void readingsDone(I2CTransfer_t *transfers, uint8_t count){
+	acquireTemp();
+	acquireVoltage();
+	acquireCurrents();
+}
+
 /**************************************************************************************
  *                                                                                    *
  * Function:  SensorReadings                                             	  		  *
  * --------------------                                                               *
- * Updates all the readings (temp, voltages, currents)								  *
- *																					  *
- *  hi2c: I2C to read from the sensors							    				  *
+ * Starts the reads of all the sensors (temp, voltages, currents) as one I2C batch	  *
+ * and returns at once. The values are stored when the batch ends					  *
  *															                          *
  *  returns: Nothing									                              *
  *  		 																		  *
  **************************************************************************************/
-void sensorReadings(I2C_HandleTypeDef *hi2c){
-	acquireTemp(hi2c);
-	acquireVoltage(hi2c);
-	acquireCurrents(hi2c);
+void sensorReadings(void){
+	int i;
+	for(i=0; i < TEMP_SENSORS; i++){
+		batch[i].address = ADDR[i];
+		batch[i].reg = 0x00; //temperature register of the TMP102
+		batch[i].length = 2;
+	}
+	batch[BATT_TEMP].address = BATTSENSOR_ADDR;
+	batch[BATT_TEMP].reg = 0x0A;
+	batch[BATT_VOLTAGE].address = BATTSENSOR_ADDR;
+	batch[BATT_VOLTAGE].reg = 0x0C;
+	batch[BATT_CURRENT].address = BATTSENSOR_ADDR;
+	batch[BATT_CURRENT].reg = 0x08;
+	for(i=TEMP_SENSORS; i < READINGS; i++) batch[i].length = 1;
+	for(i=0; i < READINGS; i++) batch[i].data = buf[i];
+	I2CQueue_Submit(batch, READINGS, readingsDone); //refused while the previous sweep runs, unless it is stuck
 }
@@ -0,0 +1,118 @@
+/*
+ * settings.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  A table maps the flash address and size of every setting to its field, so a write
+ *  of a range (a whole telecommand) updates all the fields it covers. A write that does
+ *  not change any cached byte is not sent to the flash again.
+ */
+
+#include "settings.h"
+#include "flash.h"
+#include "stddef.h"
+
+typedef struct
+{
+	uint32_t address;
+	uint8_t offset;					//Of the field in Settings_t
+	uint8_t size;
+}SettingField_t;
+
+static const SettingField_t fields[] = {
+	{ NOMINAL_ADDR,				offsetof(Settings_t, nominal),				1 },
+	{ LOW_ADDR,					offsetof(Settings_t, low),					1 },
+	{ CRITICAL_ADDR,			offsetof(Settings_t, critical),				1 },
+	{ EXIT_LOW_ADDR,			offsetof(Settings_t, exit_low),				1 },
+	{ EXIT_LOW_POWER_FLAG_ADDR,	offsetof(Settings_t, exit_low_power),		1 },
+	{ KP_ADDR,					offsetof(Settings_t, kp),					1 },
+	{ GYRO_RES_ADDR,			offsetof(Settings_t, gyro_res),				1 },
+	{ SF_ADDR,					offsetof(Settings_t, sf),					1 },
+	{ CRC_ADDR,					offsetof(Settings_t, crc),					1 },
+	{ PHOTO_RESOL_ADDR,			offsetof(Settings_t, photo_resol),			1 },
+	{ PHOTO_COMPRESSION_ADDR,	offsetof(Settings_t, photo_compression),	1 },
+	{ F_MIN_ADDR,				offsetof(Settings_t, f_min),				1 },
+	{ F_MAX_ADDR,				offsetof(Settings_t, f_max),				1 },
+	{ DELTA_F_ADDR,				offsetof(Settings_t, delta_f),				1 },
+	{ INTEGRATION_TIME_ADDR,	offsetof(Settings_t, integration_time),		1 },
+	{ PL_TIME_ADDR,				offsetof(Settings_t, pl_time),				8 },
+};
+
+#define SETTINGS_FIELDS				(sizeof(fields) / sizeof(fields[0]))
+
+static Settings_t settings;
+static uint32_t generation = 0;
+
+static uint8_t *Field(uint32_t address)
+{
+	for (uint8_t n = 0; n < SETTINGS_FIELDS; n++)
+	{
+		if (address >= fields[n].address && address < fields[n].address + fields[n].size)
+		{
+			return (uint8_t *)&settings + fields[n].offset + (address - fields[n].address);
+		}
+	}
+	return NULL;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Settings_Load                                                 		  *
+ * --------------------                                                               *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void Settings_Load(void)
+{
+	for (uint8_t n = 0; n < SETTINGS_FIELDS; n++)
+	{
+		Read_Flash(fields[n].address, (uint8_t *)&settings + fields[n].offset, fields[n].size);
+	}
+	generation++;
+}
+
+const Settings_t *Settings_Get(void)
+{
+	return &settings;
+}
+
+uint32_t Settings_Generation(void)
+{
+	return generation;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Settings_Write                                                 		  *
+ * --------------------                                                               *
+ * Updates the fields in the range and writes the range to the flash, unless it only *
+ * covers settings that already had these values									  *
+ *                                                                                    *
+ *  StartPageAddress: first address to write		                                  *
+ *  Data: bytes to write							                                  *
+ *  numberofbytes: bytes of Data					                                  *
+ *                                                                                    *
+ *  returns: Nothing									                              *
+ *                                                                                    *
+ **************************************************************************************/
+void Settings_Write(uint32_t StartPageAddress, uint8_t *Data, uint16_t numberofbytes)
+{
+	bool changed = false, uncached = false;
+
+	for (uint16_t i = 0; i < numberofbytes; i++)
+	{
+		uint8_t *field = Field(StartPageAddress + i);
+		if (field == NULL)
+		{
+			uncached = true;
+		}
+		else if (*field != Data[i])
+		{
+			*field = Data[i];
+			changed = true;
+		}
+	}
+
+	if (changed) generation++;
+	if (changed || uncached) Write_Flash(StartPageAddress, Data, numberofbytes);
+}
@@ -0,0 +1,236 @@
+/*
+ * spectrum.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  The RSSI is given in dBm, and a mean of dBm values is not the mean power. Each
+ *  sample is turned into a linear power with 2^(dB/3) (3.01 dB per octave, a table
+ *  gives the thirds) and summed in a 64-bit accumulator; the mean goes back to dB
+ *  with the position of its most significant bit. No floating point.
+ */
+
+#include "spectrum.h"
+#include "flash.h"
+#include "settings.h"
+#include "ecc.h"
+#include "radio.h"
+#include "delay.h"
+#include "stm32l1xx_hal.h"
+#include "string.h"
+
+#define SPECTRUM_MAX_SAMPLES		16383		//Samples per bin (keeps the sum below 2^64)
+#define SPECTRUM_SETTLING_MS		1			//After a change of frequency
+
+static const uint16_t third_octave[3] = { 256, 323, 406 };	//2^(0/3), 2^(1/3), 2^(2/3) (Q8)
+
+static uint8_t row[SPECTRUM_MAX_BINS];			//Row being integrated
+static uint8_t previous[SPECTRUM_MAX_BINS];		//Last row written
+static uint8_t packed[2 + SPECTRUM_MAX_BINS + SPECTRUM_MAX_BINS/128 + 1];
+static uint16_t bins;
+static uint16_t bin;							//Next bin to integrate
+static uint16_t rows;							//Rows written
+static uint32_t f_min, delta_f;					//Hz
+static uint8_t integration;						//ms per bin
+static uint32_t size;							//Bytes written
+static bool running = false;
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Power_Mean                                                 		  	  *
+ * --------------------                                                               *
+ *  sum: sum of the linear powers (Q8)				                                  *
+ *  samples: number of samples						                                  *
+ *                                                                                    *
+ *  returns: mean power in dB above SPECTRUM_DBM_MIN                                  *
+ *                                                                                    *
+ **************************************************************************************/
+static uint8_t Power_Mean(uint64_t sum, uint16_t samples)
+{
+	uint64_t mean = sum / samples;
+	uint8_t msb = 0;
+	uint16_t mantissa;
+
+	if (mean < third_octave[0]) return 0;
+	while ((mean >> msb) > 1) msb++;
+	mantissa = mean >> (msb - 8);				//256..511
+	return 3*(msb - 8) + ((mantissa >= third_octave[2]) ? 2 : (mantissa >= third_octave[1]) ? 1 : 0);
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  PackBits                                                 		  	  	  *
+ * --------------------                                                               *
+ * Run-length encoding: n < 128 is followed by n+1 literal bytes, n > 128 by one	  *
+ * byte repeated 257-n times														  *
+ *                                                                                    *
+ *  out: encoded data								                                  *
+ *  in: data to encode								                                  *
+ *  length: bytes of in								                                  *
+ *                                                                                    *
+ *  returns: bytes of out                                                             *
+ *                                                                                    *
+ **************************************************************************************/
+static uint16_t PackBits(uint8_t *out, const uint8_t *in, uint16_t length)
+{
+	uint16_t n = 0, i = 0;
+
+	while (i < length)
+	{
+		uint16_t run = 1;
+		while (i + run < length && run < 128 && in[i + run] == in[i]) run++;
+
+		if (run >= 3)							//Shorter runs stay in the literals
+		{
+			out[n++] = 257 - run;
+			out[n++] = in[i];
+			i += run;
+		}
+		else
+		{
+			uint16_t start = i, literal = 0;
+			while (i < length && literal < 128 && !(i + 2 < length && in[i + 1] == in[i] && in[i + 2] == in[i]))
+			{
+				i++;
+				literal++;
+			}
+			out[n++] = literal - 1;
+			memcpy(&out[n], &in[start], literal);
+			n += literal;
+		}
+	}
+	return n;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Spectrum_Start                                                 		  *
+ * --------------------                                                               *
+ *  returns: false if the band configured by TAKE_RF is not valid                     *
+ *                                                                                    *
+ **************************************************************************************/
+bool Spectrum_Start(void)
+{
+	uint8_t header[SPECTRUM_HEADER_SIZE];
+	uint8_t fmin = Settings_Get()->f_min;
+	uint8_t fmax = Settings_Get()->f_max;
+	uint8_t df = Settings_Get()->delta_f;
+
+	integration = Settings_Get()->integration_time;
+	if (fmax < fmin || df == 0 || integration == 0) return false;
+
+	f_min = SPECTRUM_F_BASE + (uint32_t)fmin*1000000;
+	delta_f = (uint32_t)df*SPECTRUM_F_UNIT;
+	bins = ((uint32_t)(fmax - fmin)*1000000) / delta_f + 1;
+	if (bins > SPECTRUM_MAX_BINS) bins = SPECTRUM_MAX_BINS;
+
+	header[0] = bins >> 8;
+	header[1] = bins & 0xFF;
+	header[2] = fmin;
+	header[3] = fmax;
+	header[4] = df;
+	header[5] = integration;
+	ECC_Invalidate(SPECTRUM_ADDR, SPECTRUM_SIZE);
+	Flash_Stream_Begin(SPECTRUM_ADDR, SPECTRUM_SIZE);
+	Flash_Stream_Write(header, SPECTRUM_HEADER_SIZE);
+
+	size = SPECTRUM_HEADER_SIZE;
+	bin = 0;
+	rows = 0;
+	running = true;
+	return true;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Spectrum_Step                                                 		  *
+ * --------------------                                                               *
+ * Tunes the next bin and averages its power during the integration time. After the  *
+ * last bin of the sweep, the row is compressed and written to the flash			  *
+ *                                                                                    *
+ *  returns: false when the spectrogram has ended (memory full or not started)        *
+ *                                                                                    *
+ **************************************************************************************/
+bool Spectrum_Step(void)
+{
+	uint64_t sum = 0;
+	uint16_t samples = 0;
+	uint32_t start;
+
+	if (!running) return false;
+
+	Radio.Standby();
+	Radio.SetChannel(f_min + bin*delta_f);
+	Radio.Rx(0);
+	DelayMs(SPECTRUM_SETTLING_MS);
+
+	start = HAL_GetTick();
+	do
+	{
+		int16_t rssi = Radio.Rssi(MODEM_LORA);
+		if (rssi < SPECTRUM_DBM_MIN) rssi = SPECTRUM_DBM_MIN;
+		if (rssi > SPECTRUM_DBM_MAX) rssi = SPECTRUM_DBM_MAX;
+		uint8_t db = rssi - SPECTRUM_DBM_MIN;
+		sum += (uint64_t)third_octave[db % 3] << (db / 3);
+		samples++;
+	} while (HAL_GetTick() - start < integration && samples < SPECTRUM_MAX_SAMPLES);
+
+	row[bin++] = Power_Mean(sum, samples);
+	if (bin < bins) return true;
+
+	//Row completed
+	bool key = (rows % SPECTRUM_KEY_ROWS == 0);
+	for (uint16_t n = 0; n < bins; n++)
+	{
+		uint8_t value = row[n];
+		if (key)
+		{
+			previous[n] = 0;
+		}
+		else if (value <= previous[n] + SPECTRUM_DEADBAND && value + SPECTRUM_DEADBAND >= previous[n])
+		{
+			value = previous[n];				//Noise: no change
+		}
+		row[n] = value - previous[n];
+		previous[n] = value;
+	}
+	uint16_t length = PackBits(&packed[2], row, bins);
+	packed[0] = length >> 8;
+	packed[1] = length & 0xFF;
+	Flash_Stream_Write(packed, 2 + length);
+	size += 2 + length;
+	rows++;
+	bin = 0;
+
+	if (size + sizeof(packed) + 2 > SPECTRUM_SIZE)	//The next row might not fit
+	{
+		Spectrum_Stop();
+		return false;
+	}
+	return true;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Spectrum_Stop                                                 		  *
+ * --------------------                                                               *
+ * Ends the spectrogram (the row being integrated is dropped) with a row of		  *
+ * length 0																			  *
+ *                                                                                    *
+ *  returns: bytes of the spectrogram                                                 *
+ *                                                                                    *
+ **************************************************************************************/
+uint32_t Spectrum_Stop(void)
+{
+	uint8_t end[2] = {0, 0};
+
+	if (running)
+	{
+		Radio.Sleep();
+		Flash_Stream_Write(end, sizeof(end));	//Row of length 0
+		size += sizeof(end);
+		Flash_Stream_End();
+		ECC_Protect(SPECTRUM_ADDR, size);
+		running = false;
+	}
+	return size;
+}
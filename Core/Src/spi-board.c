@@ -26,6 +26,55 @@ typedef enum
     SPI_2 = ( uint32_t )SPI2_BASE,
 }SPIName;
 
+/*!
+ * Blocks shorter than this are sent with SpiInOut (setting up the DMA costs more)
+ */
+#define SPI_DMA_MIN_SIZE                            8
+
+/*!
+ * SPI objects using the DMA, to dispatch the DMA interrupts [SPI1, SPI2]
+ */
+static Spi_t *SpiDmaObj[2] = { NULL, NULL };
+
+/*!
+ * \brief Configures the DMA channels of the SPI (DMA1 channels 2/3 for SPI1
+ *        and 4/5 for SPI2) and links them to the HAL handle
+ *
+ * \param [IN] obj SPI object
+ */
+static void SpiDmaInit( Spi_t *obj )
+{
+    uint8_t index = ( obj->Spi.Instance == SPI1 ) ? 0 : 1;
+
+    __HAL_RCC_DMA1_CLK_ENABLE( );
+
+    obj->DmaRx.Instance = ( index == 0 ) ? DMA1_Channel2 : DMA1_Channel4;
+    obj->DmaRx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    obj->DmaRx.Init.PeriphInc = DMA_PINC_DISABLE;
+    obj->DmaRx.Init.MemInc = DMA_MINC_ENABLE;
+    obj->DmaRx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    obj->DmaRx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    obj->DmaRx.Init.Mode = DMA_NORMAL;
+    obj->DmaRx.Init.Priority = DMA_PRIORITY_HIGH;
+    HAL_DMA_Init( &obj->DmaRx );
+    __HAL_LINKDMA( &obj->Spi, hdmarx, obj->DmaRx );
+
+    obj->DmaTx.Instance = ( index == 0 ) ? DMA1_Channel3 : DMA1_Channel5;
+    obj->DmaTx.Init = obj->DmaRx.Init;
+    obj->DmaTx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    HAL_DMA_Init( &obj->DmaTx );
+    __HAL_LINKDMA( &obj->Spi, hdmatx, obj->DmaTx );
+
+    obj->Busy = false;
+    obj->Callback = NULL;
+    SpiDmaObj[index] = obj;
+
+    HAL_NVIC_SetPriority( ( index == 0 ) ? DMA1_Channel2_IRQn : DMA1_Channel4_IRQn, 1, 0 );
+    HAL_NVIC_EnableIRQ( ( index == 0 ) ? DMA1_Channel2_IRQn : DMA1_Channel4_IRQn );
+    HAL_NVIC_SetPriority( ( index == 0 ) ? DMA1_Channel3_IRQn : DMA1_Channel5_IRQn, 1, 0 );
+    HAL_NVIC_EnableIRQ( ( index == 0 ) ? DMA1_Channel3_IRQn : DMA1_Channel5_IRQn );
+}
+
 void SpiInit( Spi_t *obj, PinNames mosi, PinNames miso, PinNames sclk, PinNames nss )
 {
     BoardDisableIrq( );
@@ -82,6 +131,7 @@ void SpiInit( Spi_t *obj, PinNames mosi, PinNames miso, PinNames sclk, PinNames
     SpiFrequency( obj, 10000000 );
 
     HAL_SPI_Init( &obj->Spi );
+    SpiDmaInit( obj );
 
     BoardEnableIrq( );
 }
@@ -89,6 +139,9 @@ void SpiInit( Spi_t *obj, PinNames mosi, PinNames miso, PinNames sclk, PinNames
 void SpiDeInit( Spi_t *obj )
 {
     HAL_SPI_DeInit( &obj->Spi );
+    HAL_DMA_DeInit( &obj->DmaTx );
+    HAL_DMA_DeInit( &obj->DmaRx );
+    SpiDmaObj[( obj->Spi.Instance == SPI1 ) ? 0 : 1] = NULL;
 
     GpioInit( &obj->Mosi, obj->Mosi.pin, PIN_ANALOGIC, PIN_PUSH_PULL, PIN_NO_PULL, 0 );
     GpioInit( &obj->Miso, obj->Miso.pin, PIN_ANALOGIC, PIN_PUSH_PULL, PIN_NO_PULL, 0 );
@@ -172,3 +225,139 @@ uint16_t SpiInOut( Spi_t *obj, uint16_t outData )
     return( rxData );
 }
 
+bool SpiTransfer( Spi_t *obj, const uint8_t *tx, uint8_t *rx, uint16_t size, void ( *callback )( void ) )
+{
+    HAL_StatusTypeDef status;
+
+    if( ( obj == NULL ) || ( obj->Spi.Instance ) == NULL )
+    {
+        assert_param( FAIL );
+    }
+
+    SpiWait( obj );
+    obj->Callback = callback;
+    obj->Busy = true;
+
+    if( tx == NULL )
+    {
+        // In master mode the HAL sends the rx buffer while receiving
+        memset1( rx, 0, size );
+        status = HAL_SPI_Receive_DMA( &obj->Spi, rx, size );
+    }
+    else if( rx == NULL )
+    {
+        status = HAL_SPI_Transmit_DMA( &obj->Spi, ( uint8_t* )tx, size );
+    }
+    else
+    {
+        status = HAL_SPI_TransmitReceive_DMA( &obj->Spi, ( uint8_t* )tx, rx, size );
+    }
+
+    if( status != HAL_OK )
+    {
+        obj->Busy = false;
+        return false;
+    }
+    return true;
+}
+
+void SpiWait( Spi_t *obj )
+{
+    while( obj->Busy )
+    {
+        // Sleep until the DMA interrupt. Busy is checked with the interrupts disabled,
+        // so a transfer ending just before the WFI still wakes it up
+        BoardDisableIrq( );
+        if( obj->Busy )
+        {
+            __WFI( );
+        }
+        BoardEnableIrq( );
+    }
+}
+
+void SpiOut( Spi_t *obj, const uint8_t *buffer, uint16_t size )
+{
+    if( ( size < SPI_DMA_MIN_SIZE ) || ( SpiTransfer( obj, buffer, NULL, size, NULL ) == false ) )
+    {
+        for( uint16_t i = 0; i < size; i++ )
+        {
+            SpiInOut( obj, buffer[i] );
+        }
+        return;
+    }
+    SpiWait( obj );
+}
+
+void SpiIn( Spi_t *obj, uint8_t *buffer, uint16_t size )
+{
+    if( ( size < SPI_DMA_MIN_SIZE ) || ( SpiTransfer( obj, NULL, buffer, size, NULL ) == false ) )
+    {
+        for( uint16_t i = 0; i < size; i++ )
+        {
+            buffer[i] = SpiInOut( obj, 0 );
+        }
+        return;
+    }
+    SpiWait( obj );
+}
+
+/*!
+ * \brief End of a DMA transfer (the SPI handle is the first member of Spi_t)
+ *
+ * \param [IN] hspi SPI handle
+ */
+static void SpiTransferDone( SPI_HandleTypeDef *hspi )
+{
+    Spi_t *obj = ( Spi_t* )hspi;
+
+    if( ( obj != SpiDmaObj[0] ) && ( obj != SpiDmaObj[1] ) )
+    {
+        return;     // Not an SPI driven by this driver (e.g. a CubeMX handle)
+    }
+    obj->Busy = false;
+    if( obj->Callback != NULL )
+    {
+        obj->Callback( );
+    }
+}
+
+void HAL_SPI_TxCpltCallback( SPI_HandleTypeDef *hspi )
+{
+    SpiTransferDone( hspi );
+}
+
+void HAL_SPI_RxCpltCallback( SPI_HandleTypeDef *hspi )
+{
+    SpiTransferDone( hspi );
+}
+
+void HAL_SPI_TxRxCpltCallback( SPI_HandleTypeDef *hspi )
+{
+    SpiTransferDone( hspi );
+}
+
+void HAL_SPI_ErrorCallback( SPI_HandleTypeDef *hspi )
+{
+    SpiTransferDone( hspi );
+}
+
+void DMA1_Channel2_IRQHandler( void )
+{
+    HAL_DMA_IRQHandler( &SpiDmaObj[0]->DmaRx );
+}
+
+void DMA1_Channel3_IRQHandler( void )
+{
+    HAL_DMA_IRQHandler( &SpiDmaObj[0]->DmaTx );
+}
+
+void DMA1_Channel4_IRQHandler( void )
+{
+    HAL_DMA_IRQHandler( &SpiDmaObj[1]->DmaRx );
+}
+
+void DMA1_Channel5_IRQHandler( void )
+{
+    HAL_DMA_IRQHandler( &SpiDmaObj[1]->DmaTx );
+}
@@ -141,6 +141,13 @@ void SX126xSendPayload( uint8_t *payload, uint8_t size, uint32_t timeout )
     SX126xSetTx( timeout );
 }
 
+void SX126xSendPayloadFrom( uint8_t *header, uint8_t headerSize, const uint8_t *payload, uint8_t size, uint32_t timeout )
+{
+    SX126xWriteBuffer( 0x00, header, headerSize );
+    SX126xWriteBuffer( headerSize, ( uint8_t* )payload, size );
+    SX126xSetTx( timeout );
+}
+
 uint8_t SX126xSetSyncWord( uint8_t *syncWord )
 {
     SX126xWriteRegisters( REG_LR_SYNCWORDBASEADDRESS, syncWord, 8 );
@@ -0,0 +1,380 @@
+/*
+ * thumbnail.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Baseline (SOF0/SOF1) huffman JPEG only, which is what the VC0706 gives. The huffman
+ *  tables are decoded with the maxcode/valptr method of the standard (annex F.2.2.3),
+ *  their symbols stay in the flash. The AC coefficients are decoded only to skip them.
+ *  About 1 KB of RAM whatever the size of the photo.
+ */
+
+#include "thumbnail.h"
+#include "flash.h"
+#include "stddef.h"
+
+#define JPEG_MAX_COMPONENTS			3
+#define JPEG_TABLES					4			//Huffman tables of each class (DC/AC)
+
+typedef struct {
+	int32_t maxcode[17];						//Largest code of each length (-1 => none)
+	int16_t valptr[17];							//Index of the first symbol of each length
+	uint16_t mincode[17];						//Smallest code of each length
+	const uint8_t *symbols;						//Symbols, in the DHT segment
+} Huffman_t;
+
+typedef struct {
+	uint8_t id;
+	uint8_t h, v;								//Sampling factors
+	uint8_t tq;									//Quantization table
+	uint8_t td, ta;								//DC and AC huffman tables
+	int16_t pred;								//DC predictor
+} Component_t;
+
+static Huffman_t dc_tables[JPEG_TABLES];
+static Huffman_t ac_tables[JPEG_TABLES];
+static uint16_t dc_quant[JPEG_TABLES];			//Only the DC step of each quantization table
+static Component_t components[JPEG_MAX_COMPONENTS];
+static uint8_t row[2][THUMB_MAX_WIDTH];			//Thumbnail rows of the MCU row being decoded
+
+//Entropy coded data reader
+static const uint8_t *pos, *end;
+static uint32_t bits;
+static uint8_t nbits;
+static bool marker;								//A marker was found: zeros are fed from now on
+
+static uint16_t Read16(const uint8_t *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static void Bits_Fill(void)
+{
+	while (nbits <= 24)
+	{
+		uint8_t byte = 0;
+		if (!marker && pos < end)
+		{
+			byte = *pos++;
+			if (byte == 0xFF)
+			{
+				if (pos < end && *pos == 0x00) pos++;	//Stuffed byte
+				else
+				{
+					marker = true;
+					pos--;
+					byte = 0;
+				}
+			}
+		}
+		bits |= (uint32_t)byte << (24 - nbits);
+		nbits += 8;
+	}
+}
+
+static uint16_t Bits_Get(uint8_t n)
+{
+	uint16_t value;
+
+	if (n == 0) return 0;
+	if (nbits < n) Bits_Fill();
+	value = bits >> (32 - n);
+	bits <<= n;
+	nbits -= n;
+	return value;
+}
+
+static int16_t Bits_Extend(uint16_t value, uint8_t n)
+{
+	return (n == 0 || value >= (1 << (n - 1))) ? (int16_t)value : (int16_t)value - (1 << n) + 1;
+}
+
+static int16_t Huffman_Decode(const Huffman_t *table)
+{
+	int32_t code = 0;
+
+	for (uint8_t length = 1; length <= 16; length++)
+	{
+		code = (code << 1) | Bits_Get(1);
+		if (code <= table->maxcode[length])
+		{
+			return table->symbols[table->valptr[length] + code - table->mincode[length]];
+		}
+	}
+	return -1;									//Corrupted data
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Huffman_Build                                                 		  *
+ * --------------------                                                               *
+ *  table: decoding table to fill					                                  *
+ *  counts: number of codes of each length (16 bytes of the DHT segment)              *
+ *                                                                                    *
+ *  returns: number of symbols of the table                                           *
+ *                                                                                    *
+ **************************************************************************************/
+static uint16_t Huffman_Build(Huffman_t *table, const uint8_t *counts)
+{
+	uint16_t code = 0, index = 0;
+
+	for (uint8_t length = 1; length <= 16; length++)
+	{
+		uint8_t n = counts[length - 1];
+		table->valptr[length] = index;
+		table->mincode[length] = code;
+		table->maxcode[length] = (n == 0) ? -1 : code + n - 1;
+		code = (code + n) << 1;
+		index += n;
+	}
+	table->symbols = counts + 16;
+	return index;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Block_Decode                                                 		  	  *
+ * --------------------                                                               *
+ * Decodes the coefficients of one 8x8 block											  *
+ *                                                                                    *
+ *  c: component of the block						                                  *
+ *                                                                                    *
+ *  returns: dequantized DC coefficient or INT32_MIN if the data is corrupted         *
+ *                                                                                    *
+ **************************************************************************************/
+static int32_t Block_Decode(Component_t *c)
+{
+	int16_t s = Huffman_Decode(&dc_tables[c->td]);
+
+	if (s < 0 || s > 11) return INT32_MIN;
+	c->pred += Bits_Extend(Bits_Get(s), s);
+
+	for (uint8_t k = 1; k < 64; k++)
+	{
+		int16_t rs = Huffman_Decode(&ac_tables[c->ta]);
+		if (rs < 0) return INT32_MIN;
+		if ((rs & 0x0F) == 0)
+		{
+			if (rs != 0xF0) break;				//End of block
+			k += 15;							//16 zeros
+		}
+		else
+		{
+			k += rs >> 4;
+			Bits_Get(rs & 0x0F);
+		}
+	}
+	return (int32_t)c->pred * dc_quant[c->tq];
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Thumbnail_Decode                                                 		  *
+ * --------------------                                                               *
+ * Parses the JPEG and streams the thumbnail to the flash (Flash_Stream_Begin must	  *
+ * have been called)																  *
+ *                                                                                    *
+ *  jpeg: first byte of the JPEG					                                  *
+ *  length: bytes available							                                  *
+ *                                                                                    *
+ *  returns: size of the thumbnail (header included) or 0 if the JPEG is not valid    *
+ *                                                                                    *
+ **************************************************************************************/
+static uint16_t Thumbnail_Decode(const uint8_t *jpeg, uint32_t length)
+{
+	const uint8_t *p = jpeg + 2, *last = jpeg + length;
+	uint16_t width = 0, height = 0, interval = 0;
+	uint8_t ncomp = 0, hmax = 1, vmax = 1;
+	uint8_t header[THUMB_HEADER_SIZE];
+
+	if (length < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8) return 0;
+
+	//Segments up to the start of scan
+	while (1)
+	{
+		if (p + 4 > last || p[0] != 0xFF) return 0;
+		uint8_t type = p[1];
+		uint16_t size = Read16(p + 2);
+		const uint8_t *data = p + 4, *next = p + 2 + size;
+		if (type == 0xFF) { p++; continue; }	//Fill byte
+		if (size < 2 || next > last) return 0;
+
+		if (type == 0xDB)						//DQT
+		{
+			while (data < next)
+			{
+				uint8_t precision = data[0] >> 4, id = data[0] & 0x03;
+				dc_quant[id] = precision ? Read16(data + 1) : data[1];
+				data += precision ? 129 : 65;
+			}
+		}
+		else if (type == 0xC4)					//DHT
+		{
+			while (data + 17 <= next)
+			{
+				Huffman_t *table = (data[0] >> 4) ? &ac_tables[data[0] & 0x03] : &dc_tables[data[0] & 0x03];
+				data += 17 + Huffman_Build(table, data + 1);
+			}
+		}
+		else if (type == 0xC0 || type == 0xC1)	//Baseline or extended sequential frame
+		{
+			height = Read16(data + 1);
+			width = Read16(data + 3);
+			ncomp = data[5];
+			if (ncomp == 0 || ncomp > JPEG_MAX_COMPONENTS) return 0;
+			for (uint8_t n = 0; n < ncomp; n++)
+			{
+				components[n].id = data[6 + 3*n];
+				components[n].h = data[7 + 3*n] >> 4;
+				components[n].v = data[7 + 3*n] & 0x0F;
+				components[n].tq = data[8 + 3*n] & 0x03;
+				if (components[n].h > hmax) hmax = components[n].h;
+				if (components[n].v > vmax) vmax = components[n].v;
+			}
+		}
+		else if ((type & 0xF0) == 0xC0 && type != 0xC4 && type != 0xC8 && type != 0xCC)
+		{
+			return 0;							//Progressive, lossless or arithmetic coding
+		}
+		else if (type == 0xDD)					//DRI
+		{
+			interval = Read16(data);
+		}
+		else if (type == 0xDA)					//SOS
+		{
+			if (ncomp == 0 || data[0] != ncomp) return 0;	//Only one interleaved scan
+			for (uint8_t n = 0; n < ncomp; n++)
+			{
+				for (uint8_t m = 0; m < ncomp; m++)
+				{
+					if (components[m].id == data[1 + 2*n])
+					{
+						components[m].td = data[2 + 2*n] >> 4 & 0x03;
+						components[m].ta = data[2 + 2*n] & 0x03;
+					}
+				}
+			}
+			p = next;
+			break;
+		}
+		else if (type == 0xD9) return 0;		//EOI before the scan
+		p = next;
+	}
+
+	uint16_t thumb_w = (width + 7) / 8, thumb_h = (height + 7) / 8;
+	if (width == 0 || height == 0 || thumb_w > THUMB_MAX_WIDTH || thumb_h > THUMB_MAX_HEIGHT) return 0;
+	if (ncomp == 1) hmax = vmax = components[0].h = components[0].v = 1;	//Non interleaved: one block per MCU
+	if (components[0].v > 2) return 0;
+
+	header[0] = thumb_w >> 8;
+	header[1] = thumb_w & 0xFF;
+	header[2] = thumb_h >> 8;
+	header[3] = thumb_h & 0xFF;
+	Flash_Stream_Write(header, THUMB_HEADER_SIZE);
+
+	//Entropy coded data, MCU by MCU
+	uint16_t mcu_w = (width + 8*hmax - 1) / (8*hmax), mcu_h = (height + 8*vmax - 1) / (8*vmax);
+	uint16_t restart = interval;
+
+	pos = p;
+	end = last;
+	bits = 0;
+	nbits = 0;
+	marker = false;
+	for (uint8_t n = 0; n < ncomp; n++) components[n].pred = 0;
+
+	for (uint16_t my = 0; my < mcu_h; my++)
+	{
+		for (uint16_t mx = 0; mx < mcu_w; mx++)
+		{
+			if (interval != 0 && restart-- == 0)	//RSTn: byte aligned, predictors cleared
+			{
+				nbits = 0;
+				bits = 0;
+				if (pos + 1 < end && pos[0] == 0xFF && (pos[1] & 0xF8) == 0xD0) pos += 2;
+				marker = false;
+				for (uint8_t n = 0; n < ncomp; n++) components[n].pred = 0;
+				restart = interval - 1;
+			}
+
+			for (uint8_t n = 0; n < ncomp; n++)
+			{
+				Component_t *c = &components[n];
+				for (uint8_t by = 0; by < c->v; by++)
+				{
+					for (uint8_t bx = 0; bx < c->h; bx++)
+					{
+						int32_t dc = Block_Decode(c);
+						if (dc == INT32_MIN) return 0;
+						uint16_t x = mx*c->h + bx;
+						if (n == 0 && x < thumb_w)
+						{
+							dc = dc/8 + 128;		//Mean of the block
+							row[by][x] = (dc < 0) ? 0 : (dc > 255) ? 255 : dc;
+						}
+					}
+				}
+			}
+		}
+
+		if (pos >= end && !marker) return 0;	//Cut before the EOI: the zeros fed after the end are not data
+
+		for (uint8_t by = 0; by < components[0].v; by++)
+		{
+			if (my*components[0].v + by < thumb_h) Flash_Stream_Write(row[by], thumb_w);
+		}
+	}
+
+	return THUMB_HEADER_SIZE + thumb_w*thumb_h;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Thumbnail_Make                                                 		  *
+ * --------------------                                                               *
+ *  src: address of the JPEG in the flash			                                  *
+ *  length: bytes of the JPEG (or of its region, it ends at the EOI marker)          *
+ *  dst: address of the thumbnail (page aligned)	                                  *
+ *                                                                                    *
+ *  returns: size of the thumbnail or 0 if the JPEG could not be decoded              *
+ *                                                                                    *
+ **************************************************************************************/
+uint16_t Thumbnail_Make(uint32_t src, uint32_t length, uint32_t dst)
+{
+	const uint8_t *jpeg = Flash_Map(src, length);
+	uint8_t none[THUMB_HEADER_SIZE] = {0};
+	uint16_t size;
+
+	if (jpeg == NULL) return 0;
+
+	Flash_Stream_Begin(dst, SLOT_SIZE - SLOT_THUMB_OFFSET);
+	size = Thumbnail_Decode(jpeg, length);
+	if (size == 0)
+	{
+		Flash_Stream_Begin(dst, SLOT_SIZE - SLOT_THUMB_OFFSET);				//Restart: the first page says there is no thumbnail
+		Flash_Stream_Write(none, THUMB_HEADER_SIZE);
+	}
+	Flash_Stream_End();
+	return size;
+}
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  Thumbnail_Size                                                 		  *
+ * --------------------                                                               *
+ *  addr: address of the thumbnail					                                  *
+ *                                                                                    *
+ *  returns: bytes of the thumbnail, header included (0 if there is none)             *
+ *                                                                                    *
+ **************************************************************************************/
+uint16_t Thumbnail_Size(uint32_t addr)
+{
+	uint8_t header[THUMB_HEADER_SIZE];
+	uint16_t width, height;
+
+	Flash_Read_Data(addr, header, THUMB_HEADER_SIZE);
+	width = Read16(header);
+	height = Read16(header + 2);
+	if (width == 0 || height == 0 || width > THUMB_MAX_WIDTH || height > THUMB_MAX_HEIGHT) return 0;
+	return THUMB_HEADER_SIZE + width*height;
+}
@@ -0,0 +1,49 @@
+/*
+ * timeonair.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Every LoRa symbol time is an exact number of us and a multiple of 4 us, so the
+ *  time on air is computed with integers only (no soft-float on the Cortex-M3),
+ *  counting the preamble + 4.25 symbols in quarter symbols.
+ */
+
+#include "timeonair.h"
+
+#define TOA_BW_125					4			//LORA_BW_125, first row of the table
+
+//                                         SF12   SF11   SF10  SF9   SF8   SF7
+static const uint16_t symbol_time[3][6] = {{ 32768, 16384, 8192, 4096, 2048, 1024 },	//125 kHz (us)
+                                           { 16384, 8192,  4096, 2048, 1024, 512 },	//250 kHz
+                                           { 8192,  4096,  2048, 1024, 512,  256 }};	//500 kHz
+
+/**************************************************************************************
+ *                                                                                    *
+ * Function:  TimeOnAir_LoRa                                                 		  *
+ * --------------------                                                               *
+ * Payload symbols: 8 + ceil(bits / symbol bits) * (coding rate + 4), with			  *
+ * bits = 8 length - 4 SF + 28 + 16 CRC - 20 implicit header (0 if negative)		  *
+ * and symbol bits = 4 (SF - 2 LDRO)												  *
+ *                                                                                    *
+ *  params: modulation and packet parameters		                                  *
+ *  length: bytes of the payload					                                  *
+ *                                                                                    *
+ *  returns: time on air (ms)                                                         *
+ *                                                                                    *
+ **************************************************************************************/
+uint32_t TimeOnAir_LoRa(const TimeOnAirLoRa_t *params, uint8_t length)
+{
+	uint32_t ts = symbol_time[params->bandwidth - TOA_BW_125][12 - params->spreading_factor];
+	int32_t bits = 8*length - 4*params->spreading_factor + 28 + (params->crc ? 16 : 0)
+			- (params->fixed_length ? 20 : 0);
+	int32_t symbol_bits = 4*(params->spreading_factor - (params->low_datarate_optimize ? 2 : 0));
+	uint32_t payload = 8;
+	uint32_t quarter_symbols;
+
+	if (bits > 0)
+	{
+		payload += ((bits + symbol_bits - 1) / symbol_bits) * ((params->coding_rate % 4) + 4);
+	}
+	quarter_symbols = 4*(uint32_t)params->preamble + 17 + 4*payload;
+	return (quarter_symbols*(ts >> 2) + 999) / 1000;
+}
@@ -23,46 +23,52 @@ Maintainer: Miguel Luis and Gregory Cristian
 volatile uint8_t HasLoopedThroughMain = 0;
 
 /*!
- * Timers list head pointer
+ * Started timers, as a binary min-heap ordered by expiry time. TimerHeap[0] is
+ * always the next timer to expire (the one the RTC alarm is programmed for), so
+ * starting or stopping a timer costs O(log n) with the interrupts disabled
  */
-static TimerEvent_t *TimerListHead = NULL;
+static TimerEvent_t *TimerHeap[TIMER_HEAP_SIZE];
 
 /*!
- * \brief Adds or replace the head timer of the list.
- *
- * \remark The list is automatically sorted. The list head always contains the
- *         next timer to expire.
- *
- * \param [IN]  obj Timer object to be become the new head
- * \param [IN]  remainingTime Remaining time of the previous head to be replaced
+ * Number of timers in the heap
  */
-static void TimerInsertNewHeadTimer( TimerEvent_t *obj, uint32_t remainingTime );
+static uint8_t TimerHeapCount = 0;
 
 /*!
- * \brief Adds a timer to the list.
- *
- * \remark The list is automatically sorted. The list head always contains the
- *         next timer to expire.
+ * Longest interrupts disabled section of this module [CPU cycles]
+ */
+static uint32_t TimerMaxCriticalCycles = 0;
+
+/*!
+ * TimerStart calls refused because the heap was full
+ */
+static uint32_t TimerOverflows = 0;
+
+/*!
+ * \brief Programs the RTC alarm for the timer at the top of the heap
+ */
+static void TimerSetTimeout( void );
+
+/*!
+ * \brief Removes a timer from the heap
  *
- * \param [IN]  obj Timer object to be added to the list
- * \param [IN]  remainingTime Remaining time of the running head after which the object may be added
+ * \param [IN]  obj Timer object to be removed
  */
-static void TimerInsertTimer( TimerEvent_t *obj, uint32_t remainingTime );
+static void TimerHeapRemove( TimerEvent_t *obj );
 
 /*!
- * \brief Sets a timeout with the duration "timestamp"
+ * \brief Moves a timer up the heap until its parent expires before it
  *
- * \param [IN] timestamp Delay duration
+ * \param [IN]  index Position of the timer in the heap
  */
-static void TimerSetTimeout( TimerEvent_t *obj );
+static void TimerHeapUp( uint8_t index );
 
 /*!
- * \brief Check if the Object to be added is not already in the list
+ * \brief Moves a timer down the heap until its children expire after it
  *
- * \param [IN] timestamp Delay duration
- * \retval true (the object is already in the list) or false
+ * \param [IN]  index Position of the timer in the heap
  */
-static bool TimerExists( TimerEvent_t *obj );
+static void TimerHeapDown( uint8_t index );
 
 /*!
  * \brief Read the timer value of the currently running timer
@@ -71,278 +77,210 @@ static bool TimerExists( TimerEvent_t *obj );
  */
 TimerTime_t TimerGetValue( void );
 
+/*!
+ * \brief Disables the interrupts and returns the cycle counter
+ */
+static uint32_t TimerEnterCritical( void )
+{
+    BoardDisableIrq( );
+    return DWT->CYCCNT;
+}
+
+/*!
+ * \brief Updates the longest critical section and enables the interrupts
+ *
+ * \param [IN]  start Cycle counter returned by TimerEnterCritical
+ */
+static void TimerExitCritical( uint32_t start )
+{
+    uint32_t cycles = DWT->CYCCNT - start;
+
+    if( cycles > TimerMaxCriticalCycles )
+    {
+        TimerMaxCriticalCycles = cycles;
+    }
+    BoardEnableIrq( );
+}
+
 void TimerInit( TimerEvent_t *obj, void ( *callback )( void ) )
 {
+    // Cycle counter used to measure the critical sections
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
     obj->Timestamp = 0;
     obj->ReloadValue = 0;
+    obj->Expiry = 0;
     obj->IsRunning = false;
     obj->Callback = callback;
-    obj->Next = NULL;
+    obj->HeapIndex = 0;
 }
 
 void TimerStart( TimerEvent_t *obj )
 {
-    uint32_t elapsedTime = 0;
-    uint32_t remainingTime = 0;
-
-    BoardDisableIrq( );
+    uint32_t start = TimerEnterCritical( );
 
-    if( ( obj == NULL ) || ( TimerExists( obj ) == true ) )
+    if( ( obj == NULL ) || ( obj->HeapIndex != 0 ) )
+    {
+        TimerExitCritical( start );
+        return;
+    }
+    if( TimerHeapCount == TIMER_HEAP_SIZE )
     {
-        BoardEnableIrq( );
+        // A timer that never fires would hang its owner: TIMER_HEAP_SIZE is too small
+        TimerOverflows++;
+        TimerExitCritical( start );
+        assert_param( TimerHeapCount < TIMER_HEAP_SIZE );
         return;
     }
 
     obj->Timestamp = obj->ReloadValue;
-    obj->IsRunning = false;
+    obj->Expiry = TimerGetCurrentTime( ) + obj->ReloadValue;
+    obj->IsRunning = true;
+
+    TimerHeap[TimerHeapCount] = obj;
+    obj->HeapIndex = TimerHeapCount + 1;
+    TimerHeapCount++;
+    TimerHeapUp( TimerHeapCount - 1 );
 
-    if( TimerListHead == NULL )
+    if( TimerHeap[0] == obj )
     {
-        TimerInsertNewHeadTimer( obj, obj->Timestamp );
+        TimerSetTimeout( );
     }
-    else
-    {
-        if( TimerListHead->IsRunning == true )
-        {
-            elapsedTime = TimerGetValue( );
-            if( elapsedTime > TimerListHead->Timestamp )
-            {
-                elapsedTime = TimerListHead->Timestamp; // security but should never occur
-            }
-            remainingTime = TimerListHead->Timestamp - elapsedTime;
-        }
-        else
-        {
-            remainingTime = TimerListHead->Timestamp;
-        }
+    TimerExitCritical( start );
+}
 
-        if( obj->Timestamp < remainingTime )
-        {
-            TimerInsertNewHeadTimer( obj, remainingTime );
-        }
-        else
-        {
-             TimerInsertTimer( obj, remainingTime );
-        }
-    }
-    BoardEnableIrq( );
+/*!
+ * \brief Returns true if the timer a expires before the timer b
+ */
+static bool TimerBefore( TimerEvent_t *a, TimerEvent_t *b )
+{
+    return ( int32_t )( a->Expiry - b->Expiry ) < 0;
 }
 
-static void TimerInsertTimer( TimerEvent_t *obj, uint32_t remainingTime )
+/*!
+ * \brief Stores a timer in a position of the heap
+ */
+static void TimerHeapSet( uint8_t index, TimerEvent_t *obj )
 {
-    uint32_t aggregatedTimestamp = 0;      // hold the sum of timestamps
-    uint32_t aggregatedTimestampNext = 0;  // hold the sum of timestamps up to the next event
+    TimerHeap[index] = obj;
+    obj->HeapIndex = index + 1;
+}
 
-    TimerEvent_t* prev = TimerListHead;
-    TimerEvent_t* cur = TimerListHead->Next;
+static void TimerHeapUp( uint8_t index )
+{
+    TimerEvent_t* obj = TimerHeap[index];
 
-    if( cur == NULL )
-    { // obj comes just after the head
-        obj->Timestamp -= remainingTime;
-        prev->Next = obj;
-        obj->Next = NULL;
-    }
-    else
+    while( index > 0 )
     {
-        aggregatedTimestamp = remainingTime;
-        aggregatedTimestampNext = remainingTime + cur->Timestamp;
+        uint8_t parent = ( index - 1 ) / 2;
 
-        while( prev != NULL )
+        if( TimerBefore( obj, TimerHeap[parent] ) == false )
         {
-            if( aggregatedTimestampNext > obj->Timestamp )
-            {
-                obj->Timestamp -= aggregatedTimestamp;
-                if( cur != NULL )
-                {
-                    cur->Timestamp -= obj->Timestamp;
-                }
-                prev->Next = obj;
-                obj->Next = cur;
-                break;
-            }
-            else
-            {
-                prev = cur;
-                cur = cur->Next;
-                if( cur == NULL )
-                { // obj comes at the end of the list
-                    aggregatedTimestamp = aggregatedTimestampNext;
-                    obj->Timestamp -= aggregatedTimestamp;
-                    prev->Next = obj;
-                    obj->Next = NULL;
-                    break;
-                }
-                else
-                {
-                    aggregatedTimestamp = aggregatedTimestampNext;
-                    aggregatedTimestampNext = aggregatedTimestampNext + cur->Timestamp;
-                }
-            }
+            break;
         }
+        TimerHeapSet( index, TimerHeap[parent] );
+        index = parent;
     }
+    TimerHeapSet( index, obj );
 }
 
-static void TimerInsertNewHeadTimer( TimerEvent_t *obj, uint32_t remainingTime )
+static void TimerHeapDown( uint8_t index )
 {
-    TimerEvent_t* cur = TimerListHead;
+    TimerEvent_t* obj = TimerHeap[index];
 
-    if( cur != NULL )
+    while( ( 2 * index + 1 ) < TimerHeapCount )
     {
-        cur->Timestamp = remainingTime - obj->Timestamp;
-        cur->IsRunning = false;
-    }
+        uint8_t child = 2 * index + 1;
 
-    obj->Next = cur;
-    obj->IsRunning = true;
-    TimerListHead = obj;
-    TimerSetTimeout( TimerListHead );
+        if( ( ( child + 1 ) < TimerHeapCount ) && TimerBefore( TimerHeap[child + 1], TimerHeap[child] ) )
+        {
+            child++;
+        }
+        if( TimerBefore( TimerHeap[child], obj ) == false )
+        {
+            break;
+        }
+        TimerHeapSet( index, TimerHeap[child] );
+        index = child;
+    }
+    TimerHeapSet( index, obj );
 }
 
-void TimerIrqHandler( void )
+static void TimerHeapRemove( TimerEvent_t *obj )
 {
-    uint32_t elapsedTime = 0;
+    uint8_t index = obj->HeapIndex - 1;
+    TimerEvent_t* last = TimerHeap[--TimerHeapCount];
 
-    // Early out when TimerListHead is null to prevent null pointer
-    if ( TimerListHead == NULL )
-    {
-        return;
-    }
-
-    elapsedTime = TimerGetValue( );
+    obj->HeapIndex = 0;
+    obj->IsRunning = false;
 
-    if( elapsedTime >= TimerListHead->Timestamp )
-    {
-        TimerListHead->Timestamp = 0;
-    }
-    else
+    if( last != obj )
     {
-        TimerListHead->Timestamp -= elapsedTime;
+        // The last timer fills the hole, then it goes up or down to its place
+        TimerHeapSet( index, last );
+        TimerHeapUp( index );
+        TimerHeapDown( last->HeapIndex - 1 );
     }
+}
 
-    TimerListHead->IsRunning = false;
+void TimerIrqHandler( void )
+{
+    TimerEvent_t* elapsedTimer;
+    uint32_t start;
 
-    while( ( TimerListHead != NULL ) && ( TimerListHead->Timestamp == 0 ) )
+    while( 1 )
     {
-        TimerEvent_t* elapsedTimer = TimerListHead;
-        TimerListHead = TimerListHead->Next;
+        start = TimerEnterCritical( );
 
+        if( ( TimerHeapCount == 0 ) ||
+            ( ( int32_t )( TimerHeap[0]->Expiry - TimerGetCurrentTime( ) ) > 0 ) )
+        {
+            break;
+        }
+        elapsedTimer = TimerHeap[0];
+        TimerHeapRemove( elapsedTimer );
+        TimerExitCritical( start );
+
+        // The callback runs with the interrupts enabled, it can start or stop timers
         if( elapsedTimer->Callback != NULL )
         {
             elapsedTimer->Callback( );
         }
     }
 
-    // start the next TimerListHead if it exists
-    if( TimerListHead != NULL )
+    // start the next timer if it exists
+    if( TimerHeapCount > 0 )
     {
-        if( TimerListHead->IsRunning != true )
-        {
-            TimerListHead->IsRunning = true;
-            TimerSetTimeout( TimerListHead );
-        }
+        TimerSetTimeout( );
     }
+    TimerExitCritical( start );
 }
 
 void TimerStop( TimerEvent_t *obj )
 {
-    BoardDisableIrq( );
-
-    uint32_t elapsedTime = 0;
-    uint32_t remainingTime = 0;
-
-    TimerEvent_t* prev = TimerListHead;
-    TimerEvent_t* cur = TimerListHead;
+    uint32_t start = TimerEnterCritical( );
 
-    // List is empty or the Obj to stop does not exist
-    if( ( TimerListHead == NULL ) || ( obj == NULL ) )
+    // The Obj to stop does not exist
+    if( ( obj == NULL ) || ( obj->HeapIndex == 0 ) )
     {
-        BoardEnableIrq( );
+        TimerExitCritical( start );
         return;
     }
 
-    if( TimerListHead == obj ) // Stop the Head
+    if( TimerHeap[0] == obj ) // Stop the next timer to expire
     {
-        if( TimerListHead->IsRunning == true ) // The head is already running
+        TimerHeapRemove( obj );
+        if( TimerHeapCount > 0 )
         {
-            elapsedTime = TimerGetValue( );
-            if( elapsedTime > obj->Timestamp )
-            {
-                elapsedTime = obj->Timestamp;
-            }
-
-            remainingTime = obj->Timestamp - elapsedTime;
-
-            if( TimerListHead->Next != NULL )
-            {
-                TimerListHead->IsRunning = false;
-                TimerListHead = TimerListHead->Next;
-                TimerListHead->Timestamp += remainingTime;
-                TimerListHead->IsRunning = true;
-                TimerSetTimeout( TimerListHead );
-            }
-            else
-            {
-                TimerListHead = NULL;
-            }
-        }
-        else // Stop the head before it is started
-        {
-            if( TimerListHead->Next != NULL )
-            {
-                remainingTime = obj->Timestamp;
-                TimerListHead = TimerListHead->Next;
-                TimerListHead->Timestamp += remainingTime;
-            }
-            else
-            {
-                TimerListHead = NULL;
-            }
+            TimerSetTimeout( );
         }
     }
-    else // Stop an object within the list
-    {
-        remainingTime = obj->Timestamp;
-
-        while( cur != NULL )
-        {
-            if( cur == obj )
-            {
-                if( cur->Next != NULL )
-                {
-                    cur = cur->Next;
-                    prev->Next = cur;
-                    cur->Timestamp += remainingTime;
-                }
-                else
-                {
-                    cur = NULL;
-                    prev->Next = cur;
-                }
-                break;
-            }
-            else
-            {
-                prev = cur;
-                cur = cur->Next;
-            }
-        }
-    }
-    BoardEnableIrq( );
-}
-
-static bool TimerExists( TimerEvent_t *obj )
-{
-    TimerEvent_t* cur = TimerListHead;
-
-    while( cur != NULL )
+    else
     {
-        if( cur == obj )
-        {
-            return true;
-        }
-        cur = cur->Next;
+        TimerHeapRemove( obj );
     }
-    return false;
+    TimerExitCritical( start );
 }
 
 void TimerReset( TimerEvent_t *obj )
@@ -378,16 +316,24 @@ TimerTime_t TimerGetFutureTime( TimerTime_t eventInFuture )
     return RtcComputeFutureEventTime( eventInFuture );
 }
 
-static void TimerSetTimeout( TimerEvent_t *obj )
+static void TimerSetTimeout( void )
 {
+    TimerEvent_t* obj = TimerHeap[0];
+    int32_t remaining = ( int32_t )( obj->Expiry - TimerGetCurrentTime( ) );
+
+    if( remaining < 1 )
+    {
+        remaining = 1;
+    }
+
     HasLoopedThroughMain = 0;
-    obj->Timestamp = RtcGetAdjustedTimeoutValue( obj->Timestamp );
+    obj->Timestamp = RtcGetAdjustedTimeoutValue( remaining );
     RtcSetTimeout( obj->Timestamp );
 }
 
 void TimerLowPowerHandler( void )
 {
-    if( ( TimerListHead != NULL ) && ( TimerListHead->IsRunning == true ) )
+    if( ( TimerHeapCount > 0 ) && ( TimerHeap[0]->IsRunning == true ) )
     {
         if( HasLoopedThroughMain < 5 )
         {
@@ -403,3 +349,13 @@ void TimerLowPowerHandler( void )
         }
     }
 }
+
+uint32_t TimerGetMaxCriticalCycles( void )
+{
+    return TimerMaxCriticalCycles;
+}
+
+uint32_t TimerGetOverflows( void )
+{
+    return TimerOverflows;
+}
@@ -176,6 +176,10 @@ uint8_t UartMcuGetChar( Uart_t *obj, uint8_t *data )
 
 void HAL_UART_TxCpltCallback( UART_HandleTypeDef *handle )
 {
+    if( handle != &UartHandle )
+    {
+        return;     // UART4 of the camera: its DMA transfers are handled by payload_camera.c
+    }
     if( IsFifoEmpty( &Uart2.FifoTx ) == false )
     {
         TxData = FifoPop( &Uart2.FifoTx );
@@ -191,6 +195,10 @@ void HAL_UART_TxCpltCallback( UART_HandleTypeDef *handle )
 
 void HAL_UART_RxCpltCallback( UART_HandleTypeDef *handle )
 {
+    if( handle != &UartHandle )
+    {
+        return;
+    }
     if( IsFifoFull( &Uart2.FifoRx ) == false )
     {
         // Read one byte from the receive data register
@@ -207,6 +215,10 @@ void HAL_UART_RxCpltCallback( UART_HandleTypeDef *handle )
 
 void HAL_UART_ErrorCallback( UART_HandleTypeDef *handle )
 {
+    if( handle != &UartHandle )
+    {
+        return;
+    }
     HAL_UART_Receive_IT( &UartHandle, &RxData, 1 );
 }
 
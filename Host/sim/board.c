@@ -0,0 +1,69 @@
+/*
+ * board.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Host version of Core/Src/board.c: the same objects (LEDs, Uart2) and the same
+ *  initialization of the radio SPI and pins, without the clock tree of the MCU. The
+ *  board is powered from the USB, so timer.c never enters the STOP mode.
+ */
+
+#include "board.h"
+
+#define UART2_FIFO_TX_SIZE			8
+#define UART2_FIFO_RX_SIZE			256
+
+Gpio_t Led1;
+Gpio_t Led2;
+Uart_t Uart2;
+
+uint8_t Uart2TxBuffer[UART2_FIFO_TX_SIZE];
+uint8_t Uart2RxBuffer[UART2_FIFO_RX_SIZE];
+
+static uint8_t IrqNestLevel = 0;
+
+void BoardDisableIrq(void)
+{
+	__disable_irq();
+	IrqNestLevel++;
+}
+
+void BoardEnableIrq(void)
+{
+	IrqNestLevel--;
+	if (IrqNestLevel == 0)
+	{
+		__enable_irq();
+	}
+}
+
+void BoardInitPeriph(void)
+{
+}
+
+void BoardInitMcu(void)
+{
+	GpioInit(&Led1, LED_1, PIN_OUTPUT, PIN_PUSH_PULL, PIN_NO_PULL, 0);
+	GpioInit(&Led2, LED_2, PIN_OUTPUT, PIN_PUSH_PULL, PIN_NO_PULL, 0);
+
+	FifoInit(&Uart2.FifoTx, Uart2TxBuffer, UART2_FIFO_TX_SIZE);
+	FifoInit(&Uart2.FifoRx, Uart2RxBuffer, UART2_FIFO_RX_SIZE);
+	UartInit(&Uart2, UART_2, UART_TX, UART_RX);
+	UartConfig(&Uart2, RX_TX, 115200, UART_8_BIT, UART_1_STOP_BIT, NO_PARITY, NO_FLOW_CTRL);
+
+	RtcInit();
+
+	SpiInit(&SX126x.Spi, RADIO_MOSI, RADIO_MISO, RADIO_SCLK, NC);
+	SX126xIoInit();
+}
+
+void BoardDeInitMcu(void)
+{
+	SpiDeInit(&SX126x.Spi);
+	SX126xIoDeInit();
+}
+
+uint8_t GetBoardPowerSource(void)
+{
+	return USB_POWER;
+}
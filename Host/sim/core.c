@@ -0,0 +1,359 @@
+/*
+ * core.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Simulated Cortex-M3 core of the STM32L162RE at 32 MHz: time, hardware events,
+ *  interrupt delivery, WFI and sleep, SysTick (HAL_GetTick, HAL_Delay), NVIC, RCC,
+ *  IWDG and the peripheral registers (memory mapped at their addresses).
+ */
+
+#define _GNU_SOURCE
+#include "sim.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#define SIM_EVENTS					64
+#define SIM_VECTORS					32
+#define SIM_WFI_SPINS				1000000		//WFI without progress before a deadlock is declared
+
+#define PERIPH_SIZE					0x30000		//APB1, APB2 and AHB (GPIO, RCC, FLASH, DMA)
+#define LSI_HZ						37000		//Clock of the IWDG
+
+typedef struct
+{
+	uint64_t at;
+	uint32_t order;
+	SimAction_t action;
+	void *arg;
+	bool used;
+} SimEvent_t;
+
+int host_failures = 0;
+
+SCB_Type Host_SCB;
+DWT_Type Host_DWT;
+CoreDebug_Type Host_CoreDebug;
+SysTick_Type Host_SysTick;
+uint32_t SystemCoreClock = 32000000;
+
+static uint64_t now = 0;
+static SimEvent_t events[SIM_EVENTS];
+static uint32_t order = 0;
+
+static SimVector_t pending[SIM_VECTORS];
+static uint8_t pendingCount = 0;
+static bool primask = false;
+static uint64_t maskedAt = 0;				//PC time when the interrupts were masked (ns)
+static uint64_t maskedLongest = 0;
+static bool inIsr = false;
+static uint32_t served = 0;					//Interrupts delivered
+static uint32_t spins = 0;
+static bool tickSuspended = false;
+
+static uint32_t systemResets = 0;
+static uint32_t watchdogResets = 0;
+static uint64_t watchdogWindow = 0;			//0 while the IWDG is not started
+
+/*TIME AND EVENTS*/
+
+uint64_t Sim_Now(void)
+{
+	return now;
+}
+
+static void SetTime(uint64_t time)
+{
+	now = time;
+	Host_DWT.CYCCNT = (uint32_t)(now * (SystemCoreClock / 1000000));
+}
+
+static SimEvent_t *NextEvent(void)
+{
+	SimEvent_t *next = NULL;
+
+	for (int n = 0; n < SIM_EVENTS; n++)
+	{
+		SimEvent_t *ev = &events[n];
+		if (!ev->used) continue;
+		if (next == NULL || ev->at < next->at || (ev->at == next->at && ev->order < next->order)) next = ev;
+	}
+	return next;
+}
+
+void Sim_Schedule(uint64_t at, SimAction_t action, void *arg)
+{
+	for (int n = 0; n < SIM_EVENTS; n++)
+	{
+		if (!events[n].used)
+		{
+			events[n] = (SimEvent_t){ .at = (at < now) ? now : at, .order = order++, .action = action, .arg = arg, .used = true };
+			return;
+		}
+	}
+	Sim_Fatal("more than %d hardware events", SIM_EVENTS);
+}
+
+void Sim_Cancel(SimAction_t action, void *arg)
+{
+	for (int n = 0; n < SIM_EVENTS; n++)
+	{
+		if (events[n].used && events[n].action == action && events[n].arg == arg) events[n].used = false;
+	}
+}
+
+/*Runs the pending interrupts when the core can take them*/
+static void Deliver(void)
+{
+	while (pendingCount > 0 && !primask && !inIsr)
+	{
+		SimVector_t vector = pending[0];
+		memmove(&pending[0], &pending[1], (--pendingCount)*sizeof(pending[0]));
+		inIsr = true;
+		vector();
+		inIsr = false;
+		served++;
+	}
+}
+
+void Sim_Irq(SimVector_t vector)
+{
+	for (int n = 0; n < pendingCount; n++)
+	{
+		if (pending[n] == vector) return;
+	}
+	if (pendingCount == SIM_VECTORS) Sim_Fatal("more than %d pending interrupts", SIM_VECTORS);
+	pending[pendingCount++] = vector;
+}
+
+void Sim_AdvanceTo(uint64_t at)
+{
+	SimEvent_t *ev;
+
+	Deliver();
+	while ((ev = NextEvent()) != NULL && ev->at <= at)
+	{
+		SimAction_t action = ev->action;
+		void *arg = ev->arg;
+
+		if (ev->at > now) SetTime(ev->at);
+		ev->used = false;
+		action(arg);
+		Deliver();
+	}
+	if (at > now) SetTime(at);
+	Deliver();
+}
+
+void Sim_Advance(uint64_t us)
+{
+	Sim_AdvanceTo(now + us);
+}
+
+void Sim_Fatal(const char *format, ...)
+{
+	va_list args;
+
+	fflush(stdout);
+	fprintf(stderr, "sim (%llu us): ", (unsigned long long)now);
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+	fprintf(stderr, "\n");
+	exit(2);
+}
+
+/*INTRINSICS (core_cm3.h)*/
+
+void Host_DisableIrq(void)
+{
+	if (!primask) maskedAt = Host_Nanos();
+	primask = true;
+}
+
+void Host_EnableIrq(void)
+{
+	uint64_t masked = Host_Nanos() - maskedAt;
+
+	if (primask && masked > maskedLongest) maskedLongest = masked;
+	primask = false;
+	Deliver();
+}
+
+void Host_Wfi(void)
+{
+	uint32_t count = served;
+	uint64_t start = now;
+
+	if (inIsr) return;
+	//A pending interrupt wakes the core up even if it is masked
+	while (pendingCount == 0 && served == count)
+	{
+		SimEvent_t *ev = NextEvent();
+		uint64_t wake = (ev != NULL) ? ev->at : UINT64_MAX;
+		uint64_t tick = (now/1000 + 1)*1000;
+
+		if (!tickSuspended && tick <= wake)
+		{
+			Sim_AdvanceTo(tick);				//SysTick interrupt
+			break;
+		}
+		if (wake == UINT64_MAX) Sim_Fatal("WFI with no interrupt to wake the core up");
+		Sim_AdvanceTo(wake);
+	}
+	spins = (now == start) ? spins + 1 : 0;
+	if (spins > SIM_WFI_SPINS) Sim_Fatal("WFI woken up by a masked interrupt, never served (deadlock)");
+}
+
+/*HAL: SYSTICK AND POWER*/
+
+uint32_t HAL_GetTick(void)
+{
+	Sim_Advance(1);								//Each read of the tick takes some time
+	return (uint32_t)(now/1000);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+	uint32_t start = (uint32_t)(now/1000);
+	uint32_t wait = Delay;
+
+	if (wait < HAL_MAX_DELAY) wait++;			//At least the time asked (as the HAL)
+	Sim_AdvanceTo((uint64_t)(start + wait)*1000);
+}
+
+void HAL_SuspendTick(void)
+{
+	tickSuspended = true;
+}
+
+void HAL_ResumeTick(void)
+{
+	tickSuspended = false;
+}
+
+void HAL_PWR_EnterSLEEPMode(uint32_t Regulator, uint8_t SLEEPEntry)
+{
+	Host_Wfi();
+}
+
+/*HAL: NVIC AND RCC*/
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+}
+
+void HAL_NVIC_SystemReset(void)
+{
+	systemResets++;								//The test goes on, it reads the count
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+	return SystemCoreClock;
+}
+
+/*HAL: IWDG*/
+
+static void WatchdogExpired(void *arg)
+{
+	watchdogResets++;
+	Sim_Schedule(now + watchdogWindow, WatchdogExpired, NULL);
+}
+
+HAL_StatusTypeDef HAL_IWDG_Init(IWDG_HandleTypeDef *hiwdg)
+{
+	watchdogWindow = (uint64_t)(4 << hiwdg->Init.Prescaler)*(hiwdg->Init.Reload + 1)*1000000/LSI_HZ;
+	return HAL_IWDG_Refresh(hiwdg);
+}
+
+HAL_StatusTypeDef HAL_IWDG_Refresh(IWDG_HandleTypeDef *hiwdg)
+{
+	if (watchdogWindow == 0) return HAL_ERROR;
+	Sim_Cancel(WatchdogExpired, NULL);
+	Sim_Schedule(now + watchdogWindow, WatchdogExpired, NULL);
+	return HAL_OK;
+}
+
+/*TEST SERVICES*/
+
+void Host_Init(void)
+{
+	static bool mapped = false;
+
+	if (!mapped)
+	{
+		void *periph = mmap((void *)PERIPH_BASE, PERIPH_SIZE, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+		if (periph != (void *)PERIPH_BASE) Sim_Fatal("the peripherals cannot be mapped at 0x%08lX", (unsigned long)PERIPH_BASE);
+		mapped = true;
+	}
+	memset((void *)PERIPH_BASE, 0, PERIPH_SIZE);
+
+	memset(events, 0, sizeof(events));
+	pendingCount = 0;
+	primask = false;
+	inIsr = false;
+	tickSuspended = false;
+	systemResets = 0;
+	watchdogResets = 0;
+	watchdogWindow = 0;
+	SetTime(0);
+
+	Sim_FlashInit();
+	Sim_GpioInit();
+	Sim_SpiInit();
+	Sim_UartInit();
+	Sim_I2cInit();
+	Sim_RtcInit();
+	Sim_RadioInit();
+	Sim_CameraInit();
+}
+
+void Host_Advance(uint32_t ms)
+{
+	Sim_Advance((uint64_t)ms*1000);
+}
+
+uint64_t Host_Micros(void)
+{
+	return now;
+}
+
+uint64_t Host_Nanos(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+uint64_t Host_MaskedNanos(void)
+{
+	uint64_t longest = maskedLongest;
+
+	maskedLongest = 0;
+	return longest;
+}
+
+uint32_t Host_SystemResets(void)
+{
+	return systemResets;
+}
+
+uint32_t Host_WatchdogResets(void)
+{
+	return watchdogResets;
+}
+
+int Host_Report(const char *test)
+{
+	printf("%s: %s\n", test, (host_failures == 0) ? "OK" : "FAILED");
+	return host_failures != 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * dma.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Simulated DMA1 (7 channels) and DMA2 (5 channels). The peripheral models move
+ *  the data and set the flags of the channel (half transfer, transfer complete,
+ *  error); the flag raises the interrupt of the channel and HAL_DMA_IRQHandler calls
+ *  the callbacks of the handle, as the HAL does. The channels of the SPIs use the
+ *  vectors of spi-board.c, the others the handlers of stm32l1xx_it.c (here).
+ */
+
+#include "sim.h"
+
+#define DMA1_CHANNELS				7
+#define CHANNELS					12
+#define CHANNEL_STEP				(DMA1_Channel2_BASE - DMA1_Channel1_BASE)
+
+static DMA_HandleTypeDef *handles[CHANNELS];
+static uint32_t flags[CHANNELS];
+
+void DMA1_Channel2_IRQHandler(void);
+void DMA1_Channel3_IRQHandler(void);
+void DMA1_Channel4_IRQHandler(void);
+void DMA1_Channel5_IRQHandler(void);
+
+/*stm32l1xx_it.c: the channel interrupts call HAL_DMA_IRQHandler with their handle*/
+#define CHANNEL_VECTOR(index)		static void Channel##index##_IRQHandler(void) { HAL_DMA_IRQHandler(handles[index]); }
+CHANNEL_VECTOR(0)
+CHANNEL_VECTOR(5)
+CHANNEL_VECTOR(6)
+CHANNEL_VECTOR(7)
+CHANNEL_VECTOR(8)
+CHANNEL_VECTOR(9)
+CHANNEL_VECTOR(10)
+CHANNEL_VECTOR(11)
+
+static const SimVector_t vectors[CHANNELS] = {
+	Channel0_IRQHandler, DMA1_Channel2_IRQHandler, DMA1_Channel3_IRQHandler, DMA1_Channel4_IRQHandler,
+	DMA1_Channel5_IRQHandler, Channel5_IRQHandler, Channel6_IRQHandler,
+	Channel7_IRQHandler, Channel8_IRQHandler, Channel9_IRQHandler, Channel10_IRQHandler, Channel11_IRQHandler,
+};
+
+static uint8_t Channel(DMA_Channel_TypeDef *instance)
+{
+	uintptr_t address = (uintptr_t)instance;
+
+	if (address >= DMA1_Channel1_BASE && address < DMA1_Channel1_BASE + DMA1_CHANNELS*CHANNEL_STEP
+			&& (address - DMA1_Channel1_BASE) % CHANNEL_STEP == 0)
+	{
+		return (address - DMA1_Channel1_BASE)/CHANNEL_STEP;
+	}
+	if (address >= DMA2_Channel1_BASE && address < DMA2_Channel1_BASE + (CHANNELS - DMA1_CHANNELS)*CHANNEL_STEP
+			&& (address - DMA2_Channel1_BASE) % CHANNEL_STEP == 0)
+	{
+		return DMA1_CHANNELS + (address - DMA2_Channel1_BASE)/CHANNEL_STEP;
+	}
+	Sim_Fatal("DMA channel at %p", (void *)instance);
+}
+
+void Sim_DmaStart(DMA_HandleTypeDef *hdma, uint16_t size)
+{
+	uint8_t channel = Channel(hdma->Instance);
+
+	if (hdma->State != HAL_DMA_STATE_READY) Sim_Fatal("DMA channel %u started while busy", channel);
+	handles[channel] = hdma;
+	flags[channel] = 0;
+	hdma->State = HAL_DMA_STATE_BUSY;
+	hdma->ErrorCode = HAL_DMA_ERROR_NONE;
+	hdma->Instance->CNDTR = size;
+}
+
+void Sim_DmaStop(DMA_HandleTypeDef *hdma)
+{
+	uint8_t channel = Channel(hdma->Instance);
+
+	flags[channel] = 0;
+	if (hdma->State == HAL_DMA_STATE_BUSY) hdma->State = HAL_DMA_STATE_READY;
+}
+
+void Sim_DmaFlag(DMA_HandleTypeDef *hdma, uint32_t flag)
+{
+	uint8_t channel = Channel(hdma->Instance);
+
+	flags[channel] |= flag;
+	Sim_Irq(vectors[channel]);
+}
+
+/*HAL*/
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+	Channel(hdma->Instance);
+	hdma->State = HAL_DMA_STATE_READY;
+	hdma->ErrorCode = HAL_DMA_ERROR_NONE;
+	hdma->Lock = HAL_UNLOCKED;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *hdma)
+{
+	uint8_t channel = Channel(hdma->Instance);
+
+	if (handles[channel] == hdma) handles[channel] = NULL;
+	hdma->State = HAL_DMA_STATE_RESET;
+	return HAL_OK;
+}
+
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)
+{
+	uint8_t channel;
+	uint32_t flag;
+
+	if (hdma == NULL) Sim_Fatal("DMA interrupt without a handle");
+	channel = Channel(hdma->Instance);
+	flag = flags[channel];
+	flags[channel] = 0;
+
+	if ((flag & SIM_DMA_HT) && hdma->XferHalfCpltCallback != NULL)
+	{
+		hdma->XferHalfCpltCallback(hdma);
+	}
+	if (flag & SIM_DMA_TC)
+	{
+		if (hdma->Init.Mode != DMA_CIRCULAR) hdma->State = HAL_DMA_STATE_READY;
+		if (hdma->XferCpltCallback != NULL) hdma->XferCpltCallback(hdma);
+	}
+	if (flag & SIM_DMA_TE)
+	{
+		hdma->State = HAL_DMA_STATE_READY;
+		hdma->ErrorCode = HAL_DMA_ERROR_TE;
+		if (hdma->XferErrorCallback != NULL) hdma->XferErrorCallback(hdma);
+	}
+}
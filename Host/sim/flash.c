@@ -0,0 +1,207 @@
+/*
+ * flash.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Simulated flash (512 KB, pages of 256 bytes, erased to 0) and data EEPROM
+ *  (16 KB) of the STM32L162RE at their addresses, and the HAL functions that erase
+ *  and program them. The memory is read only for the firmware: it only changes
+ *  through the HAL, with the PECR locks and the rules of the hardware (a half page
+ *  is programmed once after the erase of its page), so a module that writes it
+ *  directly crashes the test.
+ */
+
+#define _GNU_SOURCE
+#include "sim.h"
+#include <sys/mman.h>
+
+#define PROGRAM_SIZE					(FLASH_EEPROM_BASE - FLASH_BASE)
+#define HALF_PAGE					(FLASH_PAGE_SIZE/2)
+#define PROGRAM_TIME				3280		//us, erase of a page or program (datasheet tprog)
+
+static uint8_t *memory = NULL;
+static bool flashLocked = true;				//PRGLOCK
+static bool eepromLocked = true;			//PELOCK
+static uint32_t error = HAL_FLASH_ERROR_NONE;
+static uint32_t fail = 0;
+static uint32_t erases = 0;
+static uint32_t programs = 0;
+static uint32_t eepromPrograms = 0;
+static uint8_t halfPages[PROGRAM_SIZE/HALF_PAGE];	//Half pages programmed since the last erase
+
+static void Writable(bool writable)
+{
+	mprotect(memory, HOST_FLASH_SIZE, writable ? PROT_READ | PROT_WRITE : PROT_READ);
+}
+
+void Sim_FlashInit(void)
+{
+	if (memory == NULL)
+	{
+		memory = mmap((void *)HOST_FLASH_ADDR, HOST_FLASH_SIZE, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+		if (memory != (uint8_t *)HOST_FLASH_ADDR) Sim_Fatal("the flash cannot be mapped at 0x%08X", HOST_FLASH_ADDR);
+	}
+	Writable(true);
+	memset(memory, 0, HOST_FLASH_SIZE);
+	Writable(false);
+	memset(halfPages, 0, sizeof(halfPages));
+	flashLocked = true;
+	eepromLocked = true;
+	error = HAL_FLASH_ERROR_NONE;
+	fail = 0;
+	erases = 0;
+	programs = 0;
+	eepromPrograms = 0;
+}
+
+/*Injected failure of the next operation*/
+static bool Fails(void)
+{
+	if (fail == 0) return false;
+	fail--;
+	error = HAL_FLASH_ERROR_WRP;
+	return true;
+}
+
+/*HAL*/
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+	eepromLocked = false;
+	flashLocked = false;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+	flashLocked = true;
+	eepromLocked = true;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Unlock(void)
+{
+	eepromLocked = false;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Lock(void)
+{
+	eepromLocked = true;
+	return HAL_OK;
+}
+
+uint32_t HAL_FLASH_GetError(void)
+{
+	return error;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError)
+{
+	uint32_t address = pEraseInit->PageAddress;
+
+	error = HAL_FLASH_ERROR_NONE;
+	*PageError = 0xFFFFFFFF;
+	if (flashLocked || eepromLocked) Sim_Fatal("page erase with the flash locked");
+	if (pEraseInit->TypeErase != FLASH_TYPEERASE_PAGES || address % FLASH_PAGE_SIZE != 0
+			|| address < FLASH_BASE || address + pEraseInit->NbPages*FLASH_PAGE_SIZE > FLASH_EEPROM_BASE)
+	{
+		Sim_Fatal("erase of %lu pages at 0x%08lX", (unsigned long)pEraseInit->NbPages, (unsigned long)address);
+	}
+
+	for (uint32_t n = 0; n < pEraseInit->NbPages; n++, address += FLASH_PAGE_SIZE)
+	{
+		Sim_Advance(PROGRAM_TIME);
+		if (Fails())
+		{
+			*PageError = address;
+			return HAL_ERROR;
+		}
+		Writable(true);
+		memset((uint8_t *)(uintptr_t)address, 0, FLASH_PAGE_SIZE);
+		Writable(false);
+		halfPages[(address - FLASH_BASE)/HALF_PAGE] = 0;
+		halfPages[(address - FLASH_BASE)/HALF_PAGE + 1] = 0;
+		erases++;
+	}
+	return HAL_OK;
+}
+
+__RAM_FUNC HAL_StatusTypeDef HAL_FLASHEx_HalfPageProgram(uint32_t Address, uint32_t *pBuffer)
+{
+	error = HAL_FLASH_ERROR_NONE;
+	if (flashLocked || eepromLocked) Sim_Fatal("half page program with the flash locked");
+	if (Address % HALF_PAGE != 0 || Address < FLASH_BASE || Address >= FLASH_EEPROM_BASE)
+	{
+		error = HAL_FLASH_ERROR_PGA;
+		return HAL_ERROR;
+	}
+	if (halfPages[(Address - FLASH_BASE)/HALF_PAGE])
+	{
+		Sim_Fatal("half page at 0x%08lX programmed twice without an erase", (unsigned long)Address);
+	}
+
+	Sim_Advance(PROGRAM_TIME);
+	if (Fails()) return HAL_ERROR;
+	Writable(true);
+	memcpy((uint8_t *)(uintptr_t)Address, pBuffer, HALF_PAGE);
+	Writable(false);
+	halfPages[(Address - FLASH_BASE)/HALF_PAGE] = 1;
+	programs++;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_DATAEEPROM_Program(uint32_t TypeProgram, uint32_t Address, uint32_t Data)
+{
+	uint32_t size = (TypeProgram == FLASH_TYPEPROGRAMDATA_BYTE) ? 1 : (TypeProgram == FLASH_TYPEPROGRAMDATA_HALFWORD) ? 2 : 4;
+
+	error = HAL_FLASH_ERROR_NONE;
+	if (eepromLocked) Sim_Fatal("EEPROM program with the EEPROM locked");
+	if (Address % size != 0 || Address < FLASH_EEPROM_BASE || Address + size > FLASH_EEPROM_END + 1)
+	{
+		error = HAL_FLASH_ERROR_PGA;
+		return HAL_ERROR;
+	}
+
+	Sim_Advance(PROGRAM_TIME);
+	if (Fails()) return HAL_ERROR;
+	Writable(true);
+	memcpy((uint8_t *)(uintptr_t)Address, &Data, size);		//Little endian as the core
+	Writable(false);
+	eepromPrograms++;
+	return HAL_OK;
+}
+
+/*TEST SERVICES*/
+
+uint32_t Host_FlashErases(void)
+{
+	return erases;
+}
+
+uint32_t Host_FlashPrograms(void)
+{
+	return programs;
+}
+
+uint32_t Host_EepromPrograms(void)
+{
+	return eepromPrograms;
+}
+
+void Host_FlashFail(uint32_t count)
+{
+	fail = count;
+}
+
+void Host_FlashFlip(uint32_t address, uint8_t mask)
+{
+	if (address < HOST_FLASH_ADDR || address >= HOST_FLASH_ADDR + HOST_FLASH_SIZE)
+	{
+		Sim_Fatal("address 0x%08lX out of the flash", (unsigned long)address);
+	}
+	Writable(true);
+	*(uint8_t *)(uintptr_t)address ^= mask;
+	Writable(false);
+}
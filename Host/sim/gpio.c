@@ -0,0 +1,157 @@
+/*
+ * gpio.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Simulated GPIO ports and EXTI lines. A pin reads its output when the MCU drives
+ *  it and the level set by a model (DIO1 and BUSY of the radio) otherwise. A rising
+ *  or falling edge of an input configured as an interrupt raises the EXTI vector of
+ *  gpio-board.c.
+ */
+
+#include "sim.h"
+
+#define PORTS						8			//GPIOA..GPIOH
+#define PINS						16
+
+typedef struct
+{
+	uint32_t mode[PINS];
+	GPIO_PinState output[PINS];
+	GPIO_PinState input[PINS];
+	bool driven[PINS];						//Input level set by a model
+	void (*watch[PINS])(GPIO_PinState level);
+} SimPort_t;
+
+static SimPort_t ports[PORTS];
+static uint16_t extiPending = 0;
+
+void EXTI0_IRQHandler(void);
+void EXTI1_IRQHandler(void);
+void EXTI2_IRQHandler(void);
+void EXTI3_IRQHandler(void);
+void EXTI4_IRQHandler(void);
+void EXTI9_5_IRQHandler(void);
+static void EXTI15_10_IRQHandler(void);
+
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
+
+void Sim_GpioInit(void)
+{
+	memset(ports, 0, sizeof(ports));
+	extiPending = 0;
+}
+
+static SimPort_t *Port(GPIO_TypeDef *GPIOx)
+{
+	uintptr_t index = ((uintptr_t)GPIOx - GPIOA_BASE)/(GPIOB_BASE - GPIOA_BASE);
+
+	if ((uintptr_t)GPIOx < GPIOA_BASE || index >= PORTS) Sim_Fatal("GPIO port at %p", (void *)GPIOx);
+	return &ports[index];
+}
+
+static uint8_t Pin(uint16_t GPIO_Pin)
+{
+	return __builtin_ctz(GPIO_Pin);
+}
+
+static GPIO_PinState Level(SimPort_t *port, uint8_t pin)
+{
+	uint32_t mode = port->mode[pin];
+
+	if (mode == GPIO_MODE_OUTPUT_PP || mode == GPIO_MODE_OUTPUT_OD) return port->output[pin];
+	return port->input[pin];
+}
+
+static SimVector_t ExtiVector(uint8_t pin)
+{
+	static const SimVector_t vectors[] = { EXTI0_IRQHandler, EXTI1_IRQHandler, EXTI2_IRQHandler,
+			EXTI3_IRQHandler, EXTI4_IRQHandler };
+
+	if (pin < 5) return vectors[pin];
+	return (pin < 10) ? EXTI9_5_IRQHandler : EXTI15_10_IRQHandler;
+}
+
+void Sim_GpioDrive(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState level)
+{
+	SimPort_t *port = Port(GPIOx);
+	uint8_t pin = Pin(GPIO_Pin);
+	GPIO_PinState old = port->input[pin];
+	uint32_t mode = port->mode[pin];
+
+	port->input[pin] = level;
+	port->driven[pin] = true;
+	if (old == level) return;
+
+	if ((level == GPIO_PIN_SET && (mode == GPIO_MODE_IT_RISING || mode == GPIO_MODE_IT_RISING_FALLING))
+			|| (level == GPIO_PIN_RESET && (mode == GPIO_MODE_IT_FALLING || mode == GPIO_MODE_IT_RISING_FALLING)))
+	{
+		extiPending |= GPIO_Pin;
+		Sim_Irq(ExtiVector(pin));
+	}
+}
+
+void Sim_GpioWatch(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, void (*watch)(GPIO_PinState level))
+{
+	Port(GPIOx)->watch[Pin(GPIO_Pin)] = watch;
+}
+
+/*stm32l1xx_it.c: the handler of gpio-board.c is commented out*/
+static void EXTI15_10_IRQHandler(void)
+{
+	HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_10);
+}
+
+/*HAL*/
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+	SimPort_t *port = Port(GPIOx);
+
+	for (uint8_t pin = 0; pin < PINS; pin++)
+	{
+		if (GPIO_Init->Pin & (1 << pin)) port->mode[pin] = GPIO_Init->Mode;
+	}
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	Sim_Advance(1);								//A polling loop lets the time run
+	return Level(Port(GPIOx), Pin(GPIO_Pin));
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	SimPort_t *port = Port(GPIOx);
+
+	for (uint8_t pin = 0; pin < PINS; pin++)
+	{
+		if (!(GPIO_Pin & (1 << pin))) continue;
+		bool changed = port->output[pin] != PinState;
+		port->output[pin] = PinState;
+		if (changed && port->watch[pin] != NULL) port->watch[pin](PinState);
+	}
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	SimPort_t *port = Port(GPIOx);
+
+	for (uint8_t pin = 0; pin < PINS; pin++)
+	{
+		if (GPIO_Pin & (1 << pin)) HAL_GPIO_WritePin(GPIOx, 1 << pin, !port->output[pin]);
+	}
+}
+
+void HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin)
+{
+	if (extiPending & GPIO_Pin)
+	{
+		extiPending &= ~GPIO_Pin;
+		HAL_GPIO_EXTI_Callback(GPIO_Pin);
+	}
+}
+
+__weak void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+}
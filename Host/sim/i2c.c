@@ -0,0 +1,230 @@
+/*
+ * i2c.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Simulated I2C1 and I2C2 in master mode with register devices on the bus. A read
+ *  lasts the time of its bytes at the clock of the bus; an interrupt read ends in
+ *  the event (done) or error (no ACK) interrupt of the peripheral. A stalled device
+ *  holds the bus: its interrupt read never ends.
+ */
+
+#include "sim.h"
+
+#define I2CS						2
+#define DEVICES						16
+
+typedef struct
+{
+	bool used;
+	uint16_t address;
+	uint8_t regs[256];
+	bool nack;
+	bool stall;
+} SimDevice_t;
+
+typedef struct
+{
+	I2C_HandleTypeDef *handle;
+	uint16_t address;
+	uint8_t reg;
+	uint8_t *data;
+	uint16_t size;
+	bool error;
+} SimI2c_t;
+
+static SimDevice_t devices[DEVICES];
+static SimI2c_t i2cs[I2CS];
+
+static void I2C1_EV_IRQHandler(void);
+static void I2C2_EV_IRQHandler(void);
+
+void Sim_I2cInit(void)
+{
+	memset(devices, 0, sizeof(devices));
+	memset(i2cs, 0, sizeof(i2cs));
+}
+
+static SimI2c_t *I2c(I2C_HandleTypeDef *hi2c)
+{
+	SimI2c_t *i2c = NULL;
+
+	if (hi2c->Instance == I2C1) i2c = &i2cs[0];
+	else if (hi2c->Instance == I2C2) i2c = &i2cs[1];
+	else Sim_Fatal("I2C at %p", (void *)hi2c->Instance);
+	i2c->handle = hi2c;
+	return i2c;
+}
+
+static SimDevice_t *Device(uint16_t address, bool add)
+{
+	for (int n = 0; n < DEVICES; n++)
+	{
+		if (devices[n].used && devices[n].address == address) return &devices[n];
+	}
+	if (!add) return NULL;
+	for (int n = 0; n < DEVICES; n++)
+	{
+		if (!devices[n].used)
+		{
+			devices[n].used = true;
+			devices[n].address = address;
+			return &devices[n];
+		}
+	}
+	Sim_Fatal("more than %d I2C devices", DEVICES);
+}
+
+/*Time of size bytes on the bus (us): address, register, address again and data,
+ *9 clocks each*/
+static uint64_t BusTime(I2C_HandleTypeDef *hi2c, uint16_t size)
+{
+	uint32_t clock = (hi2c->Init.ClockSpeed != 0) ? hi2c->Init.ClockSpeed : 100000;
+
+	return ((uint64_t)(size + 3)*9*1000000 + clock - 1)/clock;
+}
+
+/*Reads the registers, false when the device does not answer*/
+static bool Read(uint16_t address, uint8_t reg, uint8_t *data, uint16_t size)
+{
+	SimDevice_t *device = Device(address, false);
+
+	if (device == NULL || device->nack) return false;
+	for (uint16_t n = 0; n < size; n++) data[n] = device->regs[(uint8_t)(reg + n)];
+	return true;
+}
+
+static void ReadDone(void *arg)
+{
+	SimI2c_t *i2c = arg;
+
+	i2c->error = !Read(i2c->address, i2c->reg, i2c->data, i2c->size);
+	Sim_Irq((i2c == &i2cs[0]) ? I2C1_EV_IRQHandler : I2C2_EV_IRQHandler);
+}
+
+/*stm32l1xx_it.c: event and error interrupts of the peripheral*/
+static void EventIrq(SimI2c_t *i2c)
+{
+	I2C_HandleTypeDef *hi2c = i2c->handle;
+
+	hi2c->State = HAL_I2C_STATE_READY;
+	if (i2c->error)
+	{
+		hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+		HAL_I2C_ErrorCallback(hi2c);
+	}
+	else
+	{
+		HAL_I2C_MemRxCpltCallback(hi2c);
+	}
+}
+
+static void I2C1_EV_IRQHandler(void)
+{
+	EventIrq(&i2cs[0]);
+}
+
+static void I2C2_EV_IRQHandler(void)
+{
+	EventIrq(&i2cs[1]);
+}
+
+/*HAL*/
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+	I2c(hi2c);
+	hi2c->State = HAL_I2C_STATE_READY;
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c)
+{
+	Sim_Cancel(ReadDone, I2c(hi2c));
+	hi2c->State = HAL_I2C_STATE_RESET;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+		uint16_t Size, uint32_t Timeout)
+{
+	SimDevice_t *device = Device(DevAddress, false);
+
+	if (hi2c->State != HAL_I2C_STATE_READY) return HAL_BUSY;
+	Sim_Advance(BusTime(hi2c, Size));		//The data is not read: the sensors are not modelled
+	if (device == NULL || device->nack)
+	{
+		hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+		return HAL_ERROR;
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+		uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	SimDevice_t *device = Device(DevAddress, false);
+
+	if (hi2c->State != HAL_I2C_STATE_READY) return HAL_BUSY;
+	if (device != NULL && device->stall)
+	{
+		Sim_Advance((uint64_t)Timeout*1000);
+		hi2c->ErrorCode = HAL_I2C_ERROR_TIMEOUT;
+		return HAL_TIMEOUT;
+	}
+	Sim_Advance(BusTime(hi2c, Size));
+	if (!Read(DevAddress, MemAddress, pData, Size))
+	{
+		hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+		return HAL_ERROR;
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+		uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+	SimI2c_t *i2c = I2c(hi2c);
+	SimDevice_t *device = Device(DevAddress, false);
+
+	if (hi2c->State != HAL_I2C_STATE_READY) return HAL_BUSY;
+	hi2c->State = HAL_I2C_STATE_BUSY_RX;
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+	i2c->address = DevAddress;
+	i2c->reg = MemAddress;
+	i2c->data = pData;
+	i2c->size = Size;
+	if (device == NULL || !device->stall)
+	{
+		Sim_Schedule(Sim_Now() + BusTime(hi2c, Size), ReadDone, i2c);
+	}
+	return HAL_OK;
+}
+
+__weak void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+}
+
+__weak void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+}
+
+/*TEST SERVICES*/
+
+void Host_I2cRegisters(uint16_t address, uint8_t reg, const uint8_t *data, uint8_t size)
+{
+	SimDevice_t *device = Device(address, true);
+
+	for (uint8_t n = 0; n < size; n++) device->regs[(uint8_t)(reg + n)] = data[n];
+}
+
+void Host_I2cNack(uint16_t address, bool nack)
+{
+	Device(address, true)->nack = nack;
+}
+
+void Host_I2cStall(uint16_t address, bool stall)
+{
+	Device(address, true)->stall = stall;
+}
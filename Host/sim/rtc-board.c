@@ -0,0 +1,83 @@
+/*
+ * rtc-board.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Host version of Core/Src/rtc-board.c: the RTC counts the simulated time in ms
+ *  and its alarm interrupt calls TimerIrqHandler. There is no wake-up time to
+ *  compensate (the board never enters the STOP mode). The counter does not start
+ *  at 0, which TimerGetElapsedTime takes for "never".
+ */
+
+#include "sim.h"
+#include "timer.h"
+#include "rtc-board.h"
+
+#define RTC_START					1000		//ms counted at Host_Init
+
+static TimerTime_t context = 0;				//Time of the last alarm set
+
+static void RTC_Alarm_IRQHandler(void)
+{
+	RtcRecoverMcuStatus();
+	TimerIrqHandler();
+}
+
+static void Alarm(void *arg)
+{
+	Sim_Irq(RTC_Alarm_IRQHandler);
+}
+
+void Sim_RtcInit(void)
+{
+	context = 0;
+}
+
+void RtcInit(void)
+{
+}
+
+void RtcSetTimeout(uint32_t timeout)
+{
+	context = RtcGetTimerValue();
+	Sim_Cancel(Alarm, NULL);
+	Sim_Schedule((uint64_t)(context + timeout - RTC_START)*1000, Alarm, NULL);
+}
+
+TimerTime_t RtcGetAdjustedTimeoutValue(uint32_t timeout)
+{
+	return timeout;
+}
+
+TimerTime_t RtcGetTimerValue(void)
+{
+	return (TimerTime_t)(Sim_Now()/1000) + RTC_START;
+}
+
+TimerTime_t RtcGetElapsedAlarmTime(void)
+{
+	return RtcGetTimerValue() - context;
+}
+
+TimerTime_t RtcComputeFutureEventTime(TimerTime_t futureEventInTime)
+{
+	return RtcGetTimerValue() + futureEventInTime;
+}
+
+TimerTime_t RtcComputeElapsedTime(TimerTime_t eventInTime)
+{
+	if (eventInTime == 0) return 0;			//As the real one, at boot
+	return RtcGetTimerValue() - eventInTime;
+}
+
+void BlockLowPowerDuringTask(bool status)
+{
+}
+
+void RtcEnterLowPowerStopMode(void)
+{
+}
+
+void RtcRecoverMcuStatus(void)
+{
+}
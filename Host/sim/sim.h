@@ -0,0 +1,94 @@
+/*
+ * sim.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Internal services of the simulation shared by the peripheral models: the
+ *  simulated time (us), the list of hardware events and the interrupt lines.
+ *
+ *  A model schedules an action at a time (end of a DMA transfer, TxDone of the
+ *  radio...). The action runs when the time reaches it, whatever the core is doing,
+ *  and it raises the interrupt of the peripheral. The interrupts are delivered in
+ *  the order they were raised, when they are not masked (__disable_irq) and the
+ *  core is not already in an interrupt: the time only moves forward when the
+ *  firmware waits (HAL_GetTick, HAL_Delay, __WFI, busy flags...), so a run is
+ *  deterministic.
+ */
+
+#ifndef HOST_SIM_H_
+#define HOST_SIM_H_
+
+#include "stm32l1xx_hal.h"
+#include "host.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*Interrupt handler of a peripheral (vector table entry)*/
+typedef void (*SimVector_t)(void);
+
+/*Action of a peripheral at a scheduled time*/
+typedef void (*SimAction_t)(void *arg);
+
+/*Simulated time since Host_Init (us)*/
+uint64_t Sim_Now(void);
+
+/*Runs the actions and interrupts until the time has moved us*/
+void Sim_Advance(uint64_t us);
+
+/*Runs the actions and interrupts until the time reaches at*/
+void Sim_AdvanceTo(uint64_t at);
+
+/*Schedules action(arg) at the time at (actions at the same time run in order)*/
+void Sim_Schedule(uint64_t at, SimAction_t action, void *arg);
+
+/*Removes the scheduled actions of action(arg)*/
+void Sim_Cancel(SimAction_t action, void *arg);
+
+/*Sets the interrupt pending (it runs once even if raised several times)*/
+void Sim_Irq(SimVector_t vector);
+
+/*Stops the run with a message: the firmware did something the hardware would not
+ *survive (a deadlock, an access out of the memory...)*/
+void Sim_Fatal(const char *format, ...) __attribute__((noreturn, format(printf, 1, 2)));
+
+/*Reset of the models, called by Host_Init*/
+void Sim_FlashInit(void);
+void Sim_GpioInit(void);
+void Sim_SpiInit(void);
+void Sim_UartInit(void);
+void Sim_I2cInit(void);
+void Sim_RtcInit(void);
+void Sim_RadioInit(void);
+void Sim_CameraInit(void);
+
+/*GPIO: level of the pin seen by the MCU, driven by a model (DIO1, BUSY of the radio)*/
+void Sim_GpioDrive(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState level);
+
+/*GPIO: function called when the MCU writes an output (NSS of the radio)*/
+void Sim_GpioWatch(GPIO_TypeDef *port, uint16_t pin, void (*watch)(GPIO_PinState level));
+
+/*DMA: flags of a channel, set by the peripheral models*/
+#define SIM_DMA_HT					0x01		//Half transfer
+#define SIM_DMA_TC					0x02		//Transfer complete
+#define SIM_DMA_TE					0x04		//Transfer error
+
+/*DMA: starts the channel of hdma for size items (CNDTR), stops it, sets a flag
+ *(the interrupt of the channel runs HAL_DMA_IRQHandler)*/
+void Sim_DmaStart(DMA_HandleTypeDef *hdma, uint16_t size);
+void Sim_DmaStop(DMA_HandleTypeDef *hdma);
+void Sim_DmaFlag(DMA_HandleTypeDef *hdma, uint32_t flag);
+
+/*SPI: slave on the bus of an SPI instance, returns the MISO byte of each MOSI byte*/
+void Sim_SpiSlave(SPI_TypeDef *instance, uint8_t (*exchange)(uint8_t mosi));
+
+/*UART: device on the lines of a UART instance. receive gets the bytes sent by the
+ *MCU once they are on the line*/
+void Sim_UartDevice(USART_TypeDef *instance, void (*receive)(const uint8_t *data, uint16_t size));
+
+/*UART: bytes sent by the device, the first one starting delay us from now*/
+void Sim_UartSend(USART_TypeDef *instance, const uint8_t *data, uint16_t size, uint32_t delay);
+
+/*UART: line error during the next byte received (the HAL stops the reception)*/
+void Sim_UartError(USART_TypeDef *instance);
+
+#endif /* HOST_SIM_H_ */
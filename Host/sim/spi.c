@@ -0,0 +1,200 @@
+/*
+ * spi.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Simulated SPI1 and SPI2 in master mode. A byte written to DR is exchanged with
+ *  the slave model when SpiInOut polls RXNE (the time of the byte passes then); a
+ *  DMA transfer exchanges its bytes with the slave when it starts and completes
+ *  after the time of the bytes at the SPI clock, through the DMA interrupt.
+ */
+
+#include "sim.h"
+
+#define SPIS						2
+#define DMA_SETUP					1			//us before the first byte of a DMA transfer
+
+typedef struct
+{
+	uint8_t (*exchange)(uint8_t mosi);
+	uint8_t miso[UINT16_MAX];				//Bytes of the slave during a DMA reception
+	uint8_t *rx;
+	uint16_t size;
+} SimSpi_t;
+
+static SimSpi_t spis[SPIS];
+static uint32_t dmaTransfers = 0;
+static uint32_t polledBytes = 0;
+static uint32_t dmaFail = 0;
+
+void Sim_SpiInit(void)
+{
+	for (int n = 0; n < SPIS; n++)
+	{
+		spis[n].exchange = NULL;
+		spis[n].rx = NULL;
+		spis[n].size = 0;
+	}
+	dmaTransfers = 0;
+	polledBytes = 0;
+	dmaFail = 0;
+}
+
+static SimSpi_t *Spi(SPI_TypeDef *instance)
+{
+	if (instance == SPI1) return &spis[0];
+	if (instance == SPI2) return &spis[1];
+	Sim_Fatal("SPI at %p", (void *)instance);
+}
+
+void Sim_SpiSlave(SPI_TypeDef *instance, uint8_t (*exchange)(uint8_t mosi))
+{
+	Spi(instance)->exchange = exchange;
+}
+
+static uint8_t Exchange(SPI_HandleTypeDef *hspi, uint8_t mosi)
+{
+	SimSpi_t *spi = Spi(hspi->Instance);
+
+	return (spi->exchange != NULL) ? spi->exchange(mosi) : 0xFF;
+}
+
+/*Time of a byte (us) at the clock of the prescaler (SYSCLK/2 to SYSCLK/256)*/
+static uint32_t ByteTime(SPI_HandleTypeDef *hspi)
+{
+	uint32_t divider = 2 << ((hspi->Init.BaudRatePrescaler & SPI_CR1_BR) >> SPI_CR1_BR_Pos);
+	uint32_t time = (8*divider*1000000 + SystemCoreClock - 1)/SystemCoreClock;
+
+	return (time == 0) ? 1 : time;
+}
+
+uint8_t Host_SpiFlag(SPI_HandleTypeDef *hspi, uint32_t flag)
+{
+	if (flag == SPI_FLAG_TXE) return 1;
+	if (flag != SPI_FLAG_RXNE) return 0;
+
+	hspi->Instance->DR = Exchange(hspi, (uint8_t)hspi->Instance->DR);
+	polledBytes++;
+	Sim_Advance(ByteTime(hspi));
+	return 1;
+}
+
+/*DMA*/
+
+static void DmaCplt(DMA_HandleTypeDef *hdma)
+{
+	SPI_HandleTypeDef *hspi = hdma->Parent;
+	HAL_SPI_StateTypeDef state = hspi->State;
+
+	hspi->State = HAL_SPI_STATE_READY;
+	if (state == HAL_SPI_STATE_BUSY_TX) HAL_SPI_TxCpltCallback(hspi);
+	else if (state == HAL_SPI_STATE_BUSY_RX) HAL_SPI_RxCpltCallback(hspi);
+	else HAL_SPI_TxRxCpltCallback(hspi);
+}
+
+static void DmaDone(void *arg)
+{
+	SPI_HandleTypeDef *hspi = arg;
+	SimSpi_t *spi = Spi(hspi->Instance);
+	DMA_HandleTypeDef *hdma = (spi->rx != NULL) ? hspi->hdmarx : hspi->hdmatx;
+
+	if (spi->rx != NULL) memcpy(spi->rx, spi->miso, spi->size);
+	hspi->hdmatx->Instance->CNDTR = 0;
+	hspi->hdmarx->Instance->CNDTR = 0;
+	if (hdma == hspi->hdmarx) Sim_DmaStop(hspi->hdmatx);
+	Sim_DmaFlag(hdma, SIM_DMA_TC);
+}
+
+static HAL_StatusTypeDef StartDma(SPI_HandleTypeDef *hspi, const uint8_t *tx, uint8_t *rx, uint16_t size,
+		HAL_SPI_StateTypeDef state)
+{
+	SimSpi_t *spi = Spi(hspi->Instance);
+
+	if (hspi->State != HAL_SPI_STATE_READY) return HAL_BUSY;
+	if (size == 0 || hspi->hdmatx == NULL || hspi->hdmarx == NULL) return HAL_ERROR;
+	if (dmaFail > 0)
+	{
+		dmaFail--;
+		return HAL_ERROR;
+	}
+
+	hspi->State = state;
+	hspi->ErrorCode = HAL_SPI_ERROR_NONE;
+	//In master mode the DMA always sends (the rx buffer when there is nothing to send)
+	for (uint16_t n = 0; n < size; n++)
+	{
+		spi->miso[n] = Exchange(hspi, (tx != NULL) ? tx[n] : rx[n]);
+	}
+	spi->rx = rx;
+	spi->size = size;
+
+	hspi->hdmatx->XferCpltCallback = DmaCplt;
+	hspi->hdmarx->XferCpltCallback = DmaCplt;
+	Sim_DmaStart(hspi->hdmatx, size);
+	if (rx != NULL) Sim_DmaStart(hspi->hdmarx, size);
+	dmaTransfers++;
+	Sim_Schedule(Sim_Now() + DMA_SETUP + (uint64_t)size*ByteTime(hspi), DmaDone, hspi);
+	return HAL_OK;
+}
+
+/*HAL*/
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi)
+{
+	Spi(hspi->Instance);
+	hspi->State = HAL_SPI_STATE_READY;
+	hspi->ErrorCode = HAL_SPI_ERROR_NONE;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_DeInit(SPI_HandleTypeDef *hspi)
+{
+	Sim_Cancel(DmaDone, hspi);
+	hspi->State = HAL_SPI_STATE_RESET;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size)
+{
+	return StartDma(hspi, pData, NULL, Size, HAL_SPI_STATE_BUSY_TX);
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size)
+{
+	return StartDma(hspi, NULL, pData, Size, HAL_SPI_STATE_BUSY_RX);
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData,
+		uint16_t Size)
+{
+	return StartDma(hspi, pTxData, pRxData, Size, HAL_SPI_STATE_BUSY_TX_RX);
+}
+
+__weak void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+}
+
+__weak void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+}
+
+__weak void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+}
+
+/*TEST SERVICES*/
+
+uint32_t Host_SpiDmaTransfers(void)
+{
+	return dmaTransfers;
+}
+
+uint32_t Host_SpiPolledBytes(void)
+{
+	return polledBytes;
+}
+
+void Host_SpiDmaFail(uint32_t count)
+{
+	dmaFail = count;
+}
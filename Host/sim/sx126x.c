@@ -0,0 +1,504 @@
+/*
+ * sx126x.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Model of the SX1262 on SPI1 in LoRa mode: the commands framed by NSS, the BUSY
+ *  line after each command, the data buffer, the interrupt status on DIO1 and the
+ *  time on air of the packets. Every packet sent is logged with its start and end
+ *  for the tests (Host_RadioPacket); the packets queued by Host_RadioUplink are
+ *  heard by the CAD and received by the next reception.
+ */
+
+#include "sim.h"
+#include <math.h>
+
+#define RADIO_SPI					SPI1
+#define NSS_PORT					GPIOA
+#define NSS_PIN						GPIO_PIN_8
+#define BUSY_PORT					GPIOB
+#define BUSY_PIN					GPIO_PIN_3
+#define DIO1_PORT					GPIOB
+#define DIO1_PIN					GPIO_PIN_4
+
+#define COMMAND_TIME				5			//us of BUSY after a command
+#define MODE_TIME					30			//us of BUSY after SetTx, SetRx and SetCad
+#define CALIBRATE_TIME				3500
+#define WAKEUP_TIME					340
+#define PACKETS						512			//Packets logged
+#define UPLINKS						8
+
+/*Opcodes and interrupts of Core/Inc/sx126x.h*/
+#define OP_GET_STATUS				0xC0
+#define OP_WRITE_REGISTER			0x0D
+#define OP_READ_REGISTER			0x1D
+#define OP_WRITE_BUFFER				0x0E
+#define OP_READ_BUFFER				0x1E
+#define OP_SET_SLEEP				0x84
+#define OP_SET_STANDBY				0x80
+#define OP_SET_TX					0x83
+#define OP_SET_RX					0x82
+#define OP_SET_CAD					0xC5
+#define OP_SET_CADPARAMS			0x88
+#define OP_SET_RFFREQUENCY			0x86
+#define OP_SET_BUFFERBASEADDRESS	0x8F
+#define OP_SET_MODULATIONPARAMS		0x8B
+#define OP_SET_PACKETPARAMS			0x8C
+#define OP_GET_PACKETTYPE			0x11
+#define OP_GET_RXBUFFERSTATUS		0x13
+#define OP_GET_PACKETSTATUS			0x14
+#define OP_GET_RSSIINST				0x15
+#define OP_CFG_DIOIRQ				0x08
+#define OP_GET_IRQSTATUS			0x12
+#define OP_CLR_IRQSTATUS			0x02
+#define OP_CALIBRATE				0x89
+#define OP_GET_ERROR				0x17
+
+#define IRQ_TX_DONE					0x0001
+#define IRQ_RX_DONE					0x0002
+#define IRQ_CAD_DONE				0x0080
+#define IRQ_CAD_ACTIVITY			0x0100
+#define IRQ_TIMEOUT					0x0200
+
+typedef enum
+{
+	CHIP_SLEEP,
+	CHIP_STANDBY,
+	CHIP_TX,
+	CHIP_RX,
+	CHIP_CAD,
+} SimChipMode_t;
+
+typedef struct
+{
+	uint8_t data[255];
+	uint8_t size;
+	int16_t rssi;
+	int8_t snr;
+} SimUplink_t;
+
+static SimChipMode_t mode;
+static bool selected;						//NSS low
+static bool busy;
+static uint8_t command[16];					//Opcode and parameters of the current frame
+static uint16_t position;						//Bytes of the current frame
+static uint8_t answer[8];					//Bytes read by the command, after the status
+static uint8_t buffer[256];
+static uint8_t registers[0x1000];
+static uint8_t txBase, rxBase, rxSize;
+static uint16_t irq, irqMask, dio1Mask;
+static uint8_t sf, bwCode, cr, ldro;
+static uint16_t preamble;
+static uint8_t implicit, payloadSize, crc;
+static uint8_t cadSymbols;
+static uint32_t frequency;
+static int16_t packetRssi;
+static int8_t packetSnr;
+static int16_t (*rssi)(uint32_t frequency);
+static HostPacket_t packets[PACKETS];
+static uint32_t packetCount;
+static SimUplink_t uplinks[UPLINKS];
+static uint8_t uplinkCount;
+static uint32_t busyErrors;
+
+static void Nss(GPIO_PinState level);
+static uint8_t Exchange(uint8_t mosi);
+
+void Sim_RadioInit(void)
+{
+	mode = CHIP_STANDBY;
+	selected = false;
+	busy = false;
+	position = 0;
+	memset(buffer, 0, sizeof(buffer));
+	memset(registers, 0, sizeof(registers));
+	txBase = rxBase = rxSize = 0;
+	irq = irqMask = dio1Mask = 0;
+	sf = 7;
+	bwCode = 4;
+	cr = 1;
+	ldro = 0;
+	preamble = 8;
+	implicit = 0;
+	payloadSize = 0;
+	crc = 1;
+	cadSymbols = 0;
+	frequency = 0;
+	packetRssi = 0;
+	packetSnr = 0;
+	rssi = NULL;
+	packetCount = 0;
+	uplinkCount = 0;
+	busyErrors = 0;
+	Sim_GpioWatch(NSS_PORT, NSS_PIN, Nss);
+	Sim_SpiSlave(RADIO_SPI, Exchange);
+}
+
+/*LINES*/
+
+static void Dio1(void)
+{
+	Sim_GpioDrive(DIO1_PORT, DIO1_PIN, (irq & dio1Mask) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+static void Irq(uint16_t flags)
+{
+	irq |= flags & irqMask;
+	Dio1();
+}
+
+static void Ready(void *arg)
+{
+	busy = false;
+	Sim_GpioDrive(BUSY_PORT, BUSY_PIN, GPIO_PIN_RESET);
+}
+
+static void Busy(uint32_t us)
+{
+	busy = true;
+	Sim_GpioDrive(BUSY_PORT, BUSY_PIN, GPIO_PIN_SET);
+	Sim_Cancel(Ready, NULL);
+	Sim_Schedule(Sim_Now() + us, Ready, NULL);
+}
+
+/*TIME ON AIR*/
+
+static double Bandwidth(uint8_t code)
+{
+	static const double khz[] = { 7.81, 15.63, 31.25, 62.5, 125, 250, 500, 0, 10.42, 20.83, 41.67 };
+
+	if (code >= sizeof(khz)/sizeof(khz[0]) || khz[code] == 0) Sim_Fatal("LoRa bandwidth code %u", code);
+	return khz[code];
+}
+
+/*Symbol time (us)*/
+static double SymbolTime(void)
+{
+	return ldexp(1.0, sf)*1000/Bandwidth(bwCode);
+}
+
+/*Time on air of size bytes (us), formula of the SX1261/2 datasheet*/
+static uint64_t TimeOnAir(uint8_t size)
+{
+	double symbols = ceil((8.0*size - 4*sf + 28 + 16*crc - 20*implicit)/(4*(sf - 2*ldro)));
+
+	if (symbols < 0) symbols = 0;
+	symbols = preamble + 4.25 + 8 + symbols*(cr + 4);
+	return (uint64_t)ceil(symbols*SymbolTime());
+}
+
+/*OPERATIONS*/
+
+static void TxDone(void *arg)
+{
+	mode = CHIP_STANDBY;
+	Irq(IRQ_TX_DONE);
+}
+
+static void RxDone(void *arg)
+{
+	SimUplink_t *uplink = &uplinks[0];
+
+	mode = CHIP_STANDBY;
+	for (uint16_t n = 0; n < uplink->size; n++) buffer[(uint8_t)(rxBase + n)] = uplink->data[n];
+	rxSize = uplink->size;
+	packetRssi = uplink->rssi;
+	packetSnr = uplink->snr;
+	uplinkCount--;
+	memmove(&uplinks[0], &uplinks[1], uplinkCount*sizeof(uplinks[0]));
+	Irq(IRQ_RX_DONE);
+}
+
+static void Timeout(void *arg)
+{
+	mode = CHIP_STANDBY;
+	Irq(IRQ_TIMEOUT);
+}
+
+static void CadDone(void *arg)
+{
+	mode = CHIP_STANDBY;
+	Irq(IRQ_CAD_DONE | ((uplinkCount > 0) ? IRQ_CAD_ACTIVITY : 0));
+}
+
+static void CancelOperation(void)
+{
+	Sim_Cancel(TxDone, NULL);
+	Sim_Cancel(RxDone, NULL);
+	Sim_Cancel(Timeout, NULL);
+	Sim_Cancel(CadDone, NULL);
+}
+
+/*Timeout of SetTx and SetRx (us), from its 15.625 us steps*/
+static uint64_t Steps(const uint8_t *param)
+{
+	uint32_t steps = (param[0] << 16) | (param[1] << 8) | param[2];
+
+	return ((uint64_t)steps*15625 + 999)/1000;
+}
+
+static void StartTx(void)
+{
+	HostPacket_t *packet = &packets[packetCount % PACKETS];
+	uint64_t start = Sim_Now() + MODE_TIME;
+	uint64_t timeout = Steps(&command[1]);
+
+	if (payloadSize == 0) Sim_Fatal("SetTx with an empty payload");
+	packet->start = start;
+	packet->end = start + TimeOnAir(payloadSize);
+	packet->sf = sf;
+	packet->bw = (uint16_t)Bandwidth(bwCode);
+	packet->cr = cr;
+	packet->size = payloadSize;
+	for (uint16_t n = 0; n < payloadSize; n++) packet->data[n] = buffer[(uint8_t)(txBase + n)];
+	packetCount++;
+
+	mode = CHIP_TX;
+	if (timeout != 0 && start + timeout < packet->end) Sim_Schedule(start + timeout, Timeout, NULL);
+	else Sim_Schedule(packet->end, TxDone, NULL);
+}
+
+static void StartRx(void)
+{
+	uint32_t steps = (command[1] << 16) | (command[2] << 8) | command[3];
+	uint64_t start = Sim_Now() + MODE_TIME;
+
+	mode = CHIP_RX;
+	if (uplinkCount > 0)
+	{
+		Sim_Schedule(start + TimeOnAir(uplinks[0].size), RxDone, NULL);
+	}
+	else if (steps != 0 && steps != 0xFFFFFF)		//Single mode without timeout, continuous mode
+	{
+		Sim_Schedule(start + Steps(&command[1]), Timeout, NULL);
+	}
+}
+
+static void StartCad(void)
+{
+	static const uint8_t symbols[] = { 1, 2, 4, 8, 16 };
+	uint8_t count = symbols[(cadSymbols < sizeof(symbols)) ? cadSymbols : 0];
+
+	mode = CHIP_CAD;
+	Sim_Schedule(Sim_Now() + MODE_TIME + (uint64_t)ceil(count*SymbolTime()), CadDone, NULL);
+}
+
+static uint8_t Status(void)
+{
+	static const uint8_t modes[] = { 0, 2, 6, 5, 5 };		//STBY_RC, TX, RX (CAD is a reception)
+
+	return modes[mode] << 4;
+}
+
+/*Command of the frame, run when NSS rises*/
+static void Execute(void)
+{
+	uint8_t *param = &command[1];
+	uint32_t time = COMMAND_TIME;
+
+	switch (command[0])
+	{
+	case OP_SET_SLEEP:
+		CancelOperation();
+		mode = CHIP_SLEEP;
+		busy = true;
+		Sim_Cancel(Ready, NULL);
+		Sim_GpioDrive(BUSY_PORT, BUSY_PIN, GPIO_PIN_SET);
+		return;
+	case OP_SET_STANDBY:
+		CancelOperation();
+		mode = CHIP_STANDBY;
+		break;
+	case OP_SET_TX:
+		CancelOperation();
+		StartTx();
+		time = MODE_TIME;
+		break;
+	case OP_SET_RX:
+		CancelOperation();
+		StartRx();
+		time = MODE_TIME;
+		break;
+	case OP_SET_CAD:
+		CancelOperation();
+		StartCad();
+		time = MODE_TIME;
+		break;
+	case OP_SET_CADPARAMS:
+		cadSymbols = param[0];
+		break;
+	case OP_SET_RFFREQUENCY:
+		frequency = (uint32_t)((double)((param[0] << 24) | (param[1] << 16) | (param[2] << 8) | param[3])
+				*32e6/(1 << 25) + 0.5);
+		break;
+	case OP_SET_BUFFERBASEADDRESS:
+		txBase = param[0];
+		rxBase = param[1];
+		break;
+	case OP_SET_MODULATIONPARAMS:
+		sf = param[0];
+		bwCode = param[1];
+		cr = param[2];
+		ldro = param[3];
+		break;
+	case OP_SET_PACKETPARAMS:
+		preamble = (param[0] << 8) | param[1];
+		implicit = param[2];
+		payloadSize = param[3];
+		crc = param[4];
+		break;
+	case OP_CFG_DIOIRQ:
+		irqMask = (param[0] << 8) | param[1];
+		dio1Mask = (param[2] << 8) | param[3];
+		Dio1();
+		break;
+	case OP_CLR_IRQSTATUS:
+		irq &= ~((param[0] << 8) | param[1]);
+		Dio1();
+		break;
+	case OP_CALIBRATE:
+		time = CALIBRATE_TIME;
+		break;
+	default:
+		break;
+	}
+	Busy(time);
+}
+
+/*Answer of a read command, the bytes after the status*/
+static void Prepare(uint8_t opcode)
+{
+	int16_t level = (rssi != NULL) ? rssi(frequency) : -120;
+
+	memset(answer, 0, sizeof(answer));
+	switch (opcode)
+	{
+	case OP_GET_IRQSTATUS:
+		answer[0] = irq >> 8;
+		answer[1] = irq;
+		break;
+	case OP_GET_RXBUFFERSTATUS:
+		answer[0] = rxSize;
+		answer[1] = rxBase;
+		break;
+	case OP_GET_PACKETSTATUS:
+		answer[0] = (uint8_t)(-packetRssi*2);
+		answer[1] = (uint8_t)(packetSnr*4);
+		answer[2] = (uint8_t)(-packetRssi*2);
+		break;
+	case OP_GET_RSSIINST:
+		answer[0] = (uint8_t)(-level*2);
+		break;
+	case OP_GET_PACKETTYPE:
+		answer[0] = 0x01;					//LoRa
+		break;
+	default:								//GET_STATUS, GET_ERROR: no error
+		break;
+	}
+}
+
+/*SPI*/
+
+static void Nss(GPIO_PinState level)
+{
+	if (level == GPIO_PIN_RESET)
+	{
+		selected = true;
+		position = 0;
+		if (mode == CHIP_SLEEP)
+		{
+			mode = CHIP_STANDBY;
+			Busy(WAKEUP_TIME);
+		}
+		else if (busy)
+		{
+			busyErrors++;
+		}
+	}
+	else if (selected)
+	{
+		selected = false;
+		if (position > 0) Execute();
+	}
+}
+
+static uint8_t Exchange(uint8_t mosi)
+{
+	uint8_t opcode = command[0];
+	uint8_t miso = Status();
+
+	if (!selected) return 0xFF;
+	if (position < sizeof(command)) command[position] = mosi;
+	if (position == 0)
+	{
+		Prepare(mosi);
+	}
+	else switch (opcode)
+	{
+	case OP_WRITE_REGISTER:
+		if (position >= 3) registers[(((command[1] << 8) | command[2]) + position - 3) & 0xFFF] = mosi;
+		break;
+	case OP_READ_REGISTER:
+		if (position >= 4) miso = registers[(((command[1] << 8) | command[2]) + position - 4) & 0xFFF];
+		break;
+	case OP_WRITE_BUFFER:
+		if (position >= 2) buffer[(uint8_t)(command[1] + position - 2)] = mosi;
+		break;
+	case OP_READ_BUFFER:
+		if (position >= 3) miso = buffer[(uint8_t)(command[1] + position - 3)];
+		break;
+	case OP_GET_STATUS:
+	case OP_GET_IRQSTATUS:
+	case OP_GET_RXBUFFERSTATUS:
+	case OP_GET_PACKETSTATUS:
+	case OP_GET_RSSIINST:
+	case OP_GET_PACKETTYPE:
+	case OP_GET_ERROR:
+		if (position >= 2 && position - 2 < (int)sizeof(answer)) miso = answer[position - 2];
+		break;
+	default:
+		break;
+	}
+	position++;
+	return miso;
+}
+
+/*TEST SERVICES*/
+
+uint32_t Host_RadioPackets(void)
+{
+	return packetCount;
+}
+
+const HostPacket_t *Host_RadioPacket(uint32_t n)
+{
+	if (n >= packetCount || packetCount - n > PACKETS) return NULL;
+	return &packets[n % PACKETS];
+}
+
+void Host_RadioUplink(const uint8_t *data, uint8_t size, int16_t rssi, int8_t snr)
+{
+	SimUplink_t *uplink;
+
+	if (uplinkCount == UPLINKS) Sim_Fatal("more than %d uplinks queued", UPLINKS);
+	uplink = &uplinks[uplinkCount++];
+	memcpy(uplink->data, data, size);
+	uplink->size = size;
+	uplink->rssi = rssi;
+	uplink->snr = snr;
+	if (mode == CHIP_RX && uplinkCount == 1)		//Heard by the reception running
+	{
+		Sim_Cancel(Timeout, NULL);
+		Sim_Schedule(Sim_Now() + TimeOnAir(size), RxDone, NULL);
+	}
+}
+
+void Host_RadioRssi(int16_t (*level)(uint32_t frequency))
+{
+	rssi = level;
+}
+
+uint32_t Host_RadioBusyErrors(void)
+{
+	return busyErrors;
+}
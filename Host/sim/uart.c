@@ -0,0 +1,407 @@
+/*
+ * uart.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Simulated USART1..3 and UART4..5 (8N1). The bytes of the device on the line
+ *  arrive one by one at the baud rate and go where the HAL reception put them: the
+ *  buffer of HAL_UART_Receive, the interrupt reception or the DMA channel (CNDTR
+ *  counts down, half and complete interrupts, circular mode). A byte that arrives
+ *  with no reception running is lost (overrun). The bytes sent by the MCU reach the
+ *  device when they are all on the line.
+ */
+
+#include "sim.h"
+
+#define UARTS						5
+#define LINE_SIZE					8192		//Bytes sent by a device, not yet arrived
+
+#define IRQ_RX						0x01
+#define IRQ_TX						0x02
+#define IRQ_ERROR					0x04
+
+typedef enum
+{
+	RX_NONE,
+	RX_BLOCKING,
+	RX_IT,
+	RX_DMA,
+} SimRxMode_t;
+
+typedef struct
+{
+	uint8_t data;
+	uint64_t at;							//Earliest arrival (us)
+} SimByte_t;
+
+typedef struct
+{
+	USART_TypeDef *instance;
+	UART_HandleTypeDef *handle;
+	void (*receive)(const uint8_t *data, uint16_t size);
+	SimByte_t line[LINE_SIZE];
+	uint16_t lineHead;
+	uint16_t lineCount;
+	uint64_t lastArrival;
+	SimRxMode_t mode;
+	uint8_t *rx;
+	uint16_t rxSize;
+	uint16_t rxCount;
+	const uint8_t *tx;
+	uint16_t txSize;
+	uint32_t irq;							//Events for HAL_UART_IRQHandler
+	bool lineError;
+	uint32_t overruns;
+} SimUart_t;
+
+static SimUart_t uarts[UARTS];
+
+void USART2_IRQHandler(void);
+
+/*stm32l1xx_it.c: the UART interrupts call HAL_UART_IRQHandler with their handle*/
+#define UART_VECTOR(index)			static void Uart##index##_IRQHandler(void) { HAL_UART_IRQHandler(uarts[index].handle); }
+UART_VECTOR(0)
+UART_VECTOR(2)
+UART_VECTOR(3)
+UART_VECTOR(4)
+
+static const SimVector_t vectors[UARTS] = {
+	Uart0_IRQHandler, USART2_IRQHandler, Uart2_IRQHandler, Uart3_IRQHandler, Uart4_IRQHandler,
+};
+
+void Sim_UartInit(void)
+{
+	static USART_TypeDef *const instances[UARTS] = { USART1, USART2, USART3, UART4, UART5 };
+
+	memset(uarts, 0, sizeof(uarts));
+	for (int n = 0; n < UARTS; n++) uarts[n].instance = instances[n];
+}
+
+static SimUart_t *Uart(USART_TypeDef *instance)
+{
+	for (int n = 0; n < UARTS; n++)
+	{
+		if (uarts[n].instance == instance) return &uarts[n];
+	}
+	Sim_Fatal("UART at %p", (void *)instance);
+}
+
+static SimVector_t Vector(SimUart_t *uart)
+{
+	return vectors[uart - uarts];
+}
+
+/*Time of a byte on the line (us): start, 8 bits, stop*/
+static uint32_t ByteTime(SimUart_t *uart)
+{
+	uint32_t baud = (uart->handle != NULL && uart->handle->Init.BaudRate != 0) ? uart->handle->Init.BaudRate : 115200;
+
+	return (10*1000000 + baud/2)/baud;
+}
+
+/*RECEPTION*/
+
+static void Arrival(void *arg);
+
+static void NextArrival(SimUart_t *uart)
+{
+	SimByte_t *byte = &uart->line[uart->lineHead];
+	uint64_t at = uart->lastArrival + ByteTime(uart);
+
+	if (byte->at + ByteTime(uart) > at) at = byte->at + ByteTime(uart);
+	Sim_Schedule(at, Arrival, uart);
+}
+
+static void Arrival(void *arg)
+{
+	SimUart_t *uart = arg;
+	UART_HandleTypeDef *huart = uart->handle;
+	uint8_t data = uart->line[uart->lineHead].data;
+
+	uart->lineHead = (uart->lineHead + 1) % LINE_SIZE;
+	uart->lineCount--;
+	uart->lastArrival = Sim_Now();
+	if (uart->lineCount > 0) NextArrival(uart);
+
+	if (uart->lineError && uart->mode != RX_NONE)
+	{
+		uart->lineError = false;
+		uart->irq |= IRQ_ERROR;
+		Sim_Irq(Vector(uart));
+		return;
+	}
+
+	switch (uart->mode)
+	{
+	case RX_BLOCKING:
+	case RX_IT:
+		uart->rx[uart->rxCount++] = data;
+		if (uart->rxCount == uart->rxSize)
+		{
+			if (uart->mode == RX_IT)
+			{
+				uart->irq |= IRQ_RX;
+				Sim_Irq(Vector(uart));
+			}
+			uart->mode = RX_NONE;
+		}
+		break;
+	case RX_DMA:
+	{
+		DMA_Channel_TypeDef *channel = huart->hdmarx->Instance;
+
+		uart->rx[uart->rxSize - channel->CNDTR] = data;
+		channel->CNDTR--;
+		if (channel->CNDTR == uart->rxSize/2) Sim_DmaFlag(huart->hdmarx, SIM_DMA_HT);
+		if (channel->CNDTR == 0)
+		{
+			if (huart->hdmarx->Init.Mode == DMA_CIRCULAR) channel->CNDTR = uart->rxSize;
+			else uart->mode = RX_NONE;
+			Sim_DmaFlag(huart->hdmarx, SIM_DMA_TC);
+		}
+		break;
+	}
+	default:
+		uart->overruns++;
+		break;
+	}
+}
+
+void Sim_UartSend(USART_TypeDef *instance, const uint8_t *data, uint16_t size, uint32_t delay)
+{
+	SimUart_t *uart = Uart(instance);
+	uint64_t at = Sim_Now() + delay;
+
+	if (uart->lineCount + size > LINE_SIZE) Sim_Fatal("more than %d bytes on the line", LINE_SIZE);
+	for (uint16_t n = 0; n < size; n++)
+	{
+		SimByte_t *byte = &uart->line[(uart->lineHead + uart->lineCount++) % LINE_SIZE];
+		byte->data = data[n];
+		byte->at = at;
+	}
+	if (uart->lineCount == size) NextArrival(uart);
+}
+
+void Sim_UartDevice(USART_TypeDef *instance, void (*receive)(const uint8_t *data, uint16_t size))
+{
+	Uart(instance)->receive = receive;
+}
+
+void Sim_UartError(USART_TypeDef *instance)
+{
+	Uart(instance)->lineError = true;
+}
+
+static void DmaRxHalfCplt(DMA_HandleTypeDef *hdma)
+{
+	HAL_UART_RxHalfCpltCallback(hdma->Parent);
+}
+
+static void DmaRxCplt(DMA_HandleTypeDef *hdma)
+{
+	UART_HandleTypeDef *huart = hdma->Parent;
+
+	if (hdma->Init.Mode != DMA_CIRCULAR) huart->RxState = HAL_UART_STATE_READY;
+	HAL_UART_RxCpltCallback(huart);
+}
+
+static HAL_StatusTypeDef StartReception(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, SimRxMode_t mode)
+{
+	SimUart_t *uart = Uart(huart->Instance);
+
+	if (huart->RxState != HAL_UART_STATE_READY) return HAL_BUSY;
+	if (pData == NULL || Size == 0) return HAL_ERROR;
+	huart->RxState = HAL_UART_STATE_BUSY_RX;
+	huart->ErrorCode = HAL_UART_ERROR_NONE;
+	uart->mode = mode;
+	uart->rx = pData;
+	uart->rxSize = Size;
+	uart->rxCount = 0;
+	return HAL_OK;
+}
+
+/*TRANSMISSION*/
+
+static void TxDone(void *arg)
+{
+	SimUart_t *uart = arg;
+	UART_HandleTypeDef *huart = uart->handle;
+
+	if (uart->receive != NULL) uart->receive(uart->tx, uart->txSize);
+	if (huart->hdmatx != NULL && huart->hdmatx->State == HAL_DMA_STATE_BUSY)
+	{
+		huart->hdmatx->Instance->CNDTR = 0;
+		Sim_DmaFlag(huart->hdmatx, SIM_DMA_TC);
+	}
+	else
+	{
+		uart->irq |= IRQ_TX;
+		Sim_Irq(Vector(uart));
+	}
+}
+
+static void DmaTxCplt(DMA_HandleTypeDef *hdma)
+{
+	SimUart_t *uart = Uart(((UART_HandleTypeDef *)hdma->Parent)->Instance);
+
+	uart->irq |= IRQ_TX;					//TC of the UART once the last byte is out
+	Sim_Irq(Vector(uart));
+}
+
+static HAL_StatusTypeDef StartTransmission(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+	SimUart_t *uart = Uart(huart->Instance);
+
+	if (huart->gState != HAL_UART_STATE_READY) return HAL_BUSY;
+	if (pData == NULL || Size == 0) return HAL_ERROR;
+	huart->gState = HAL_UART_STATE_BUSY_TX;
+	uart->tx = pData;
+	uart->txSize = Size;
+	Sim_Schedule(Sim_Now() + (uint64_t)Size*ByteTime(uart), TxDone, uart);
+	return HAL_OK;
+}
+
+/*HAL*/
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+	SimUart_t *uart = Uart(huart->Instance);
+
+	uart->handle = huart;
+	uart->mode = RX_NONE;
+	huart->gState = HAL_UART_STATE_READY;
+	huart->RxState = HAL_UART_STATE_READY;
+	huart->ErrorCode = HAL_UART_ERROR_NONE;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	SimUart_t *uart = Uart(huart->Instance);
+
+	if (huart->gState != HAL_UART_STATE_READY) return HAL_BUSY;
+	if (pData == NULL || Size == 0) return HAL_ERROR;
+	huart->gState = HAL_UART_STATE_BUSY_TX;
+	Sim_Advance((uint64_t)Size*ByteTime(uart));
+	huart->gState = HAL_UART_STATE_READY;
+	if (uart->receive != NULL) uart->receive(pData, Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	SimUart_t *uart = Uart(huart->Instance);
+	uint32_t start = HAL_GetTick();
+	HAL_StatusTypeDef status = StartReception(huart, pData, Size, RX_BLOCKING);
+
+	if (status != HAL_OK) return status;
+	while (uart->rxCount < Size)
+	{
+		if (HAL_GetTick() - start > Timeout)
+		{
+			uart->mode = RX_NONE;
+			huart->RxState = HAL_UART_STATE_READY;
+			return HAL_TIMEOUT;
+		}
+		Sim_Advance(ByteTime(uart));
+	}
+	huart->RxState = HAL_UART_STATE_READY;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+	return StartTransmission(huart, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+	return StartReception(huart, pData, Size, RX_IT);
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+	HAL_StatusTypeDef status;
+
+	if (huart->hdmatx == NULL) Sim_Fatal("UART DMA transmission without a DMA channel");
+	status = StartTransmission(huart, pData, Size);
+	if (status != HAL_OK) return status;
+	huart->hdmatx->XferCpltCallback = DmaTxCplt;
+	Sim_DmaStart(huart->hdmatx, Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+	HAL_StatusTypeDef status;
+
+	if (huart->hdmarx == NULL) Sim_Fatal("UART DMA reception without a DMA channel");
+	status = StartReception(huart, pData, Size, RX_DMA);
+	if (status != HAL_OK) return status;
+	huart->hdmarx->XferHalfCpltCallback = DmaRxHalfCplt;
+	huart->hdmarx->XferCpltCallback = DmaRxCplt;
+	Sim_DmaStart(huart->hdmarx, Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_DMAStop(UART_HandleTypeDef *huart)
+{
+	SimUart_t *uart = Uart(huart->Instance);
+
+	if (huart->gState == HAL_UART_STATE_BUSY_TX && huart->hdmatx != NULL && huart->hdmatx->State == HAL_DMA_STATE_BUSY)
+	{
+		Sim_Cancel(TxDone, uart);
+		Sim_DmaStop(huart->hdmatx);
+		huart->gState = HAL_UART_STATE_READY;
+	}
+	if (huart->RxState == HAL_UART_STATE_BUSY_RX && uart->mode == RX_DMA)
+	{
+		uart->mode = RX_NONE;
+		Sim_DmaStop(huart->hdmarx);
+		huart->RxState = HAL_UART_STATE_READY;
+	}
+	return HAL_OK;
+}
+
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart)
+{
+	SimUart_t *uart = Uart(huart->Instance);
+	uint32_t irq = uart->irq;
+
+	uart->irq = 0;
+	if (irq & IRQ_ERROR)
+	{
+		//Framing error: the HAL stops the reception (and its DMA) before the callback
+		if (uart->mode == RX_DMA) Sim_DmaStop(huart->hdmarx);
+		uart->mode = RX_NONE;
+		huart->RxState = HAL_UART_STATE_READY;
+		huart->ErrorCode = HAL_UART_ERROR_FE;
+		HAL_UART_ErrorCallback(huart);
+	}
+	if (irq & IRQ_RX)
+	{
+		huart->RxState = HAL_UART_STATE_READY;
+		HAL_UART_RxCpltCallback(huart);
+	}
+	if (irq & IRQ_TX)
+	{
+		huart->gState = HAL_UART_STATE_READY;
+		HAL_UART_TxCpltCallback(huart);
+	}
+}
+
+__weak void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+}
+
+__weak void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+}
+
+__weak void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef *huart)
+{
+}
+
+__weak void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+}
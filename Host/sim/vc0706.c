@@ -0,0 +1,116 @@
+/*
+ * vc0706.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Model of the VC0706 serial camera on UART4: the commands 56 00 cmd len params
+ *  used by payload_camera.c and their answers 76 00 cmd status len data. The read
+ *  of the frame buffer (0x32) answers the header, the data after the delay asked
+ *  in the command and the footer.
+ */
+
+#include "sim.h"
+
+#define CAMERA_UART					UART4
+#define FRAME_SIZE					0x10000
+#define ANSWER_DELAY				500			//us between the command and its answer
+
+static uint8_t image[FRAME_SIZE];
+static uint32_t imageSize = 0;
+static uint32_t frameSize = 0;				//Frame buffer frozen by the capture
+static uint32_t drop = 0;
+static uint32_t reads = 0;
+
+static void Answer(uint8_t command, const uint8_t *data, uint8_t size)
+{
+	uint8_t answer[5 + 4] = { 0x76, 0x00, command, 0x00, size };
+
+	if (size > 0) memcpy(&answer[5], data, size);
+	Sim_UartSend(CAMERA_UART, answer, 5 + size, ANSWER_DELAY);
+}
+
+static void ReadFrame(const uint8_t *command)
+{
+	static const uint8_t marker[5] = { 0x76, 0x00, 0x32, 0x00, 0x00 };
+	static uint8_t data[FRAME_SIZE];
+	uint32_t address = (command[6] << 24) | (command[7] << 16) | (command[8] << 8) | command[9];
+	uint32_t size = (command[10] << 24) | (command[11] << 16) | (command[12] << 8) | command[13];
+	uint32_t delay = ((command[14] << 8) | command[15])*10;
+
+	if (drop > 0)
+	{
+		drop--;
+		return;
+	}
+	if (size > FRAME_SIZE) size = FRAME_SIZE;
+	for (uint32_t n = 0; n < size; n++)
+	{
+		data[n] = (address + n < frameSize) ? image[address + n] : 0;
+	}
+	reads++;
+	Sim_UartSend(CAMERA_UART, marker, sizeof(marker), ANSWER_DELAY);
+	Sim_UartSend(CAMERA_UART, data, size, ANSWER_DELAY + delay);
+	Sim_UartSend(CAMERA_UART, marker, sizeof(marker), ANSWER_DELAY + delay);
+}
+
+static void Receive(const uint8_t *data, uint16_t size)
+{
+	while (size >= 4 && data[0] == 0x56 && data[1] == 0x00 && size >= 4 + data[3])
+	{
+		uint8_t command = data[2];
+		uint8_t length[4] = { frameSize >> 24, frameSize >> 16, frameSize >> 8, frameSize };
+
+		switch (command)
+		{
+		case 0x36:								//FBUF_CTRL: 0 freezes the frame, 3 resumes
+			if (data[3] >= 1 && data[4] == 0x00) frameSize = imageSize;
+			if (data[3] >= 1 && data[4] == 0x03) frameSize = 0;
+			Answer(command, NULL, 0);
+			break;
+		case 0x34:								//GET_FBUF_LEN
+			Answer(command, length, sizeof(length));
+			break;
+		case 0x32:								//READ_FBUF
+			if (data[3] == 0x0C) ReadFrame(data);
+			break;
+		default:								//WRITE_DATA and the others
+			Answer(command, NULL, 0);
+			break;
+		}
+		size -= 4 + data[3];
+		data += 4 + data[3];
+	}
+}
+
+void Sim_CameraInit(void)
+{
+	imageSize = 0;
+	frameSize = 0;
+	drop = 0;
+	reads = 0;
+	Sim_UartDevice(CAMERA_UART, Receive);
+}
+
+/*TEST SERVICES*/
+
+void Host_CameraImage(const uint8_t *jpeg, uint32_t size)
+{
+	if (size > FRAME_SIZE) Sim_Fatal("image of %lu bytes", (unsigned long)size);
+	memcpy(image, jpeg, size);
+	imageSize = size;
+}
+
+void Host_CameraDrop(uint32_t count)
+{
+	drop = count;
+}
+
+uint32_t Host_CameraReads(void)
+{
+	return reads;
+}
+
+void Host_CameraLineError(void)
+{
+	Sim_UartError(CAMERA_UART);
+}
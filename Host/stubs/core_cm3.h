@@ -0,0 +1,102 @@
+/*
+ * core_cm3.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Host stand-in for the CMSIS Cortex-M3 core header. stm32l162xe.h includes it
+ *  for the core registers and intrinsics: the registers used by the firmware
+ *  (SCB, DWT, CoreDebug) are structures of the simulation and the intrinsics
+ *  (interrupt mask, barriers, WFI) are functions of the simulated core.
+ */
+
+#ifndef HOST_CORE_CM3_H_
+#define HOST_CORE_CM3_H_
+
+#include <stdint.h>
+
+#define __CM3_CMSIS_VERSION			0x50000U
+
+#define __I							volatile const
+#define __O							volatile
+#define __IO						volatile
+#define __IM						volatile const
+#define __OM						volatile
+#define __IOM						volatile
+
+#ifndef __STATIC_INLINE
+#define __STATIC_INLINE				static inline
+#endif
+#ifndef __ASM
+#define __ASM						__asm
+#endif
+#ifndef __PACKED
+#define __PACKED					__attribute__((packed))
+#endif
+
+typedef struct
+{
+	__IM  uint32_t CPUID;
+	__IOM uint32_t ICSR;
+	__IOM uint32_t VTOR;
+	__IOM uint32_t AIRCR;
+	__IOM uint32_t SCR;
+	__IOM uint32_t CCR;
+} SCB_Type;
+
+#define SCB_SCR_SLEEPONEXIT_Msk		(1UL << 1)
+#define SCB_SCR_SLEEPDEEP_Msk		(1UL << 2)
+
+typedef struct
+{
+	__IOM uint32_t CTRL;
+	__IOM uint32_t CYCCNT;
+} DWT_Type;
+
+#define DWT_CTRL_CYCCNTENA_Msk		(1UL << 0)
+
+typedef struct
+{
+	__IOM uint32_t DHCSR;
+	__OM  uint32_t DCRSR;
+	__IOM uint32_t DCRDR;
+	__IOM uint32_t DEMCR;
+} CoreDebug_Type;
+
+#define CoreDebug_DEMCR_TRCENA_Msk	(1UL << 24)
+
+typedef struct
+{
+	__IOM uint32_t CTRL;
+	__IOM uint32_t LOAD;
+	__IOM uint32_t VAL;
+	__IM  uint32_t CALIB;
+} SysTick_Type;
+
+/*Core registers of the simulation (Host/sim/core.c). CYCCNT counts 32 cycles per
+ *simulated microsecond, the SYSCLK of the board*/
+extern SCB_Type Host_SCB;
+extern DWT_Type Host_DWT;
+extern CoreDebug_Type Host_CoreDebug;
+extern SysTick_Type Host_SysTick;
+
+#define SCB							(&Host_SCB)
+#define DWT							(&Host_DWT)
+#define CoreDebug					(&Host_CoreDebug)
+#define SysTick						(&Host_SysTick)
+
+/*Intrinsics: the interrupt mask is the one of BoardDisableIrq, __WFI moves the
+ *simulated time to the next interrupt*/
+void Host_DisableIrq(void);
+void Host_EnableIrq(void);
+void Host_Wfi(void);
+
+#define __disable_irq()				Host_DisableIrq()
+#define __enable_irq()				Host_EnableIrq()
+#define __WFI()						Host_Wfi()
+#define __WFE()						Host_Wfi()
+#define __NOP()						do { } while (0)
+#define __DMB()						__sync_synchronize()
+#define __DSB()						__sync_synchronize()
+#define __ISB()						__sync_synchronize()
+
+#endif /* HOST_CORE_CM3_H_ */
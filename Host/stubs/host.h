@@ -0,0 +1,132 @@
+/*
+ * host.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Services of the host tests. The firmware modules of Core/Src run unchanged on
+ *  the simulated board of Host/sim: the core (time, interrupts, WFI), the flash and
+ *  data EEPROM at their addresses (erased to 0), the GPIOs, the SPI and DMA, the
+ *  UARTs, the I2C, the RTC alarm of timer.c, the IWDG, an SX126x on SPI1 and a
+ *  VC0706 camera on UART4. The functions here set up the hardware around the
+ *  firmware and read what it did.
+ */
+
+#ifndef HOST_HOST_H_
+#define HOST_HOST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define HOST_FLASH_ADDR				0x08000000
+#define HOST_FLASH_SIZE				0x84000		//512 KB of flash and 16 KB of data EEPROM
+
+/*Counts the failed checks; main returns it*/
+extern int host_failures;
+
+#define CHECK(expr)		do { if (!(expr)) { host_failures++; \
+							printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); } } while (0)
+
+/*CORE*/
+
+/*Maps the memory, erases the flash and resets the time and the peripherals.
+ *Called first by every test*/
+void Host_Init(void);
+
+/*Lets the time run (interrupts and timers included), as the main loop waiting*/
+void Host_Advance(uint32_t ms);
+
+/*Simulated time since Host_Init (us)*/
+uint64_t Host_Micros(void);
+
+/*Time of the PC (ns), for the benchmarks*/
+uint64_t Host_Nanos(void);
+
+/*Longest time the interrupts were masked since the last call (ns of the PC)*/
+uint64_t Host_MaskedNanos(void);
+
+/*Resets asked by the firmware (HAL_NVIC_SystemReset) and by the IWDG (more than
+ *its window without a refresh)*/
+uint32_t Host_SystemResets(void);
+uint32_t Host_WatchdogResets(void);
+
+/*Prints the result of the test and returns the exit code*/
+int Host_Report(const char *test);
+
+/*FLASH*/
+
+/*Operations done on the flash since Host_Init: pages erased, half pages
+ *programmed, bytes or words programmed in the data EEPROM*/
+uint32_t Host_FlashErases(void);
+uint32_t Host_FlashPrograms(void);
+uint32_t Host_EepromPrograms(void);
+
+/*The next count erase or program operations fail (HAL_FLASH_ERROR_WRP)*/
+void Host_FlashFail(uint32_t count);
+
+/*Flips the bits of mask at an address of the flash or the EEPROM (radiation)*/
+void Host_FlashFlip(uint32_t address, uint8_t mask);
+
+/*SPI*/
+
+/*DMA transfers started on the SPIs and bytes exchanged one by one (SpiInOut)*/
+uint32_t Host_SpiDmaTransfers(void);
+uint32_t Host_SpiPolledBytes(void);
+
+/*The next count DMA transfers are refused (HAL_ERROR)*/
+void Host_SpiDmaFail(uint32_t count);
+
+/*RADIO (SX126x on SPI1)*/
+
+typedef struct
+{
+	uint64_t start;					//SetTx (us)
+	uint64_t end;					//TxDone (us)
+	uint8_t sf;						//Spreading factor
+	uint16_t bw;					//Bandwidth (kHz)
+	uint8_t cr;						//Coding rate 4/(4+cr)
+	uint8_t size;
+	uint8_t data[255];
+} HostPacket_t;
+
+/*Packets transmitted since Host_Init, the n-th one (NULL when out of the log)*/
+uint32_t Host_RadioPackets(void);
+const HostPacket_t *Host_RadioPacket(uint32_t n);
+
+/*Packet sent by the ground: detected by the next CAD and received by the next RX*/
+void Host_RadioUplink(const uint8_t *data, uint8_t size, int16_t rssi, int8_t snr);
+
+/*Instantaneous RSSI (dBm) at a frequency (Hz), read by Radio.Rssi*/
+void Host_RadioRssi(int16_t (*rssi)(uint32_t frequency));
+
+/*Commands sent while the radio was busy (the driver must wait for BUSY low)*/
+uint32_t Host_RadioBusyErrors(void);
+
+/*CAMERA (VC0706 on UART4)*/
+
+/*Image in the frame buffer of the camera*/
+void Host_CameraImage(const uint8_t *jpeg, uint32_t size);
+
+/*The camera does not answer the next count read commands (0x32)*/
+void Host_CameraDrop(uint32_t count);
+
+/*Read commands (0x32) answered since Host_Init*/
+uint32_t Host_CameraReads(void);
+
+/*UART*/
+
+/*Line error (framing, noise) on UART4 during the next DMA reception: the HAL aborts
+ *it and calls HAL_UART_ErrorCallback*/
+void Host_CameraLineError(void);
+
+/*I2C*/
+
+/*Contents of the registers of the device at address (as given to the HAL)*/
+void Host_I2cRegisters(uint16_t address, uint8_t reg, const uint8_t *data, uint8_t size);
+
+/*The device does not acknowledge (HAL_I2C_ERROR_AF) or never ends the transfer*/
+void Host_I2cNack(uint16_t address, bool nack);
+void Host_I2cStall(uint16_t address, bool stall);
+
+#endif /* HOST_HOST_H_ */
@@ -0,0 +1,26 @@
+/*
+ * stm32l1xx_hal.h
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  The firmware is built with the real HAL headers (types, register layouts and
+ *  macros of Drivers/STM32L1xx_HAL_Driver), but the HAL functions are the ones of
+ *  the simulation in Host/sim. The peripheral registers are memory mapped at their
+ *  addresses, so the register macros work unchanged; the only macro replaced here
+ *  is the SPI flag read of SpiInOut, which is where a byte is exchanged with the
+ *  simulated SX126x.
+ */
+
+#ifndef HOST_STM32L1XX_HAL_H_
+#define HOST_STM32L1XX_HAL_H_
+
+#include_next "stm32l1xx_hal.h"
+
+/*SR of the SPI after the byte written to DR has been clocked out (RXNE: DR holds
+ *the byte of the slave)*/
+uint8_t Host_SpiFlag(SPI_HandleTypeDef *hspi, uint32_t flag);
+
+#undef __HAL_SPI_GET_FLAG
+#define __HAL_SPI_GET_FLAG(__HANDLE__, __FLAG__)	((Host_SpiFlag((__HANDLE__), (__FLAG__))) ? SET : RESET)
+
+#endif /* HOST_STM32L1XX_HAL_H_ */
@@ -0,0 +1,135 @@
+/*
+ * test_arq.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Bursts, selective retransmission, delivered chunks skipped, resume, burst sized
+ *  from the round trip, and the ACK timeouts up to ARQ_TIMEOUT_LOST. The round trip
+ *  and the timeouts start at the TxDone of the last packet (ARQ_TxDone), not when
+ *  ARQ_Next runs out of packets while that packet is still on air.
+ */
+
+#include "host.h"
+#include "comms.h"
+
+#define AIR_TIME					200			//ms per packet
+
+static uint32_t delivered_bytes;
+
+static void On_Delivered(uint16_t offset, uint8_t length)
+{
+	delivered_bytes += length;
+}
+
+/*The last packet of the burst goes on air and ends*/
+static void Last_TxDone(void)
+{
+	Host_Advance(AIR_TIME);
+	ARQ_TxDone();
+}
+
+/*Takes the packets of the burst until ARQ_NONE, returns how many*/
+static uint16_t Burst(ArqTx_t type, uint16_t *seqs, uint16_t *offsets, uint8_t *lengths)
+{
+	uint16_t count = 0, seq, offset;
+	uint8_t length;
+	ArqTx_t tx;
+
+	while ((tx = ARQ_Next(&seq, &offset, &length)) != ARQ_NONE)
+	{
+		CHECK(tx == type);
+		if (seqs != NULL) seqs[count] = seq;
+		if (offsets != NULL) offsets[count] = offset;
+		if (lengths != NULL) lengths[count] = length;
+		count++;
+	}
+	return count;
+}
+
+static void Ack_All_But(uint16_t ack_base, uint16_t lost)
+{
+	uint8_t bitmap[(WINDOW_SIZE + 7) / 8];
+
+	memset(bitmap, 0xFF, sizeof(bitmap));
+	if (lost >= ack_base && lost - ack_base < WINDOW_SIZE) bitmap[(lost - ack_base) / 8] &= ~(1 << ((lost - ack_base) % 8));
+	ARQ_Ack(ack_base, bitmap);
+}
+
+int main(void)
+{
+	uint16_t seqs[WINDOW_SIZE], offsets[WINDOW_SIZE];
+	uint8_t lengths[WINDOW_SIZE];
+
+	Host_Init();
+
+	//10 packets of 100 bytes, the 4th lost and sent again
+	ARQ_SetPacket(100, AIR_TIME);
+	ARQ_Init(0, 0, 1000);
+	delivered_bytes = 0;
+	ARQ_Track(NULL, On_Delivered);
+	CHECK(Burst(ARQ_NEW, seqs, offsets, lengths) == 10);
+	for (uint8_t n = 0; n < 10; n++) CHECK(seqs[n] == n && offsets[n] == 100*n && lengths[n] == 100);
+	CHECK(!ARQ_Done());
+
+	Last_TxDone();
+	Host_Advance(1000);
+	Ack_All_But(0, 3);
+	CHECK(ARQ_Base() == 3 && ARQ_BaseOffset() == 300);
+	CHECK(ARQ_Loss() == 10);
+	CHECK(delivered_bytes == 900);
+	CHECK(Burst(ARQ_RETX, seqs, offsets, NULL) == 1);
+	CHECK(seqs[0] == 3 && offsets[0] == 300);
+	Last_TxDone();
+	Host_Advance(1000);
+	Ack_All_But(10, 0xFFFF);
+	CHECK(delivered_bytes == 1000);
+	CHECK(ARQ_Done());
+
+	//Round trip of 1000 ms (the air time of the last packets not counted), 200 ms per packet: bursts of 4*1000/200 + 1 packets
+	ARQ_Init(0, 0, 10000);
+	CHECK(Burst(ARQ_NEW, NULL, NULL, NULL) == 21);
+
+	//The chunk 1 (256-511) is already on the ground
+	{
+		uint8_t progress[CATALOG_PROGRESS_SIZE] = { 0x02 };
+		ARQ_Init(0, 0, 1024);
+		ARQ_Track(progress, NULL);
+		CHECK(Burst(ARQ_NEW, NULL, offsets, lengths) == 9);
+		CHECK(offsets[2] == 200 && lengths[2] == 56);
+		CHECK(offsets[3] == 512 && lengths[3] == 100);
+		CHECK(offsets[8] == 1012 && lengths[8] == 12);
+	}
+
+	//Resume after a reset from the packet 5
+	ARQ_Init(5, 500, 1000);
+	CHECK(Burst(ARQ_NEW, seqs, offsets, NULL) == 5);
+	CHECK(seqs[0] == 5 && offsets[0] == 500);
+
+	//The last packet still on air: no timeout yet
+	Host_Advance(2*ARQ_ACK_TIMEOUT);
+	CHECK(ARQ_Timeout() == ARQ_TIMEOUT_NONE);
+	ARQ_TxDone();
+
+	//No ACK: ARQ_MAX_TIMEOUTS bursts sent again, then the link is given up
+	for (uint8_t n = 0; n < ARQ_MAX_TIMEOUTS; n++)
+	{
+		Host_Advance(ARQ_ACK_TIMEOUT - 1);
+		CHECK(ARQ_Timeout() == ARQ_TIMEOUT_NONE);
+		Host_Advance(1);
+		CHECK(ARQ_Timeout() == ARQ_TIMEOUT_RESEND);
+		CHECK(Burst(ARQ_RETX, NULL, NULL, NULL) == 5);
+		ARQ_TxDone();
+	}
+	Host_Advance(ARQ_ACK_TIMEOUT);
+	CHECK(ARQ_Timeout() == ARQ_TIMEOUT_LOST);
+	CHECK(ARQ_Timeout() == ARQ_TIMEOUT_NONE);
+
+	//Restarted: the lost packets are sent first, and the ACK resets the timeouts
+	CHECK(Burst(ARQ_RETX, seqs, NULL, NULL) == 5);
+	CHECK(seqs[0] == 5);
+	Ack_All_But(10, 0xFFFF);
+	CHECK(ARQ_Done());
+	CHECK(ARQ_Timeout() == ARQ_TIMEOUT_NONE);
+
+	return Host_Report("arq");
+}
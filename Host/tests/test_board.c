@@ -0,0 +1,74 @@
+/*
+ * test_board.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Smoke test of the simulated board: BoardInitMcu, a timer of timer.c through the
+ *  RTC alarm and a packet sent by the real radio driver (radio.c, sx126x.c and
+ *  spi-board.c) to the SX126x model, with its TxDone event.
+ */
+
+#include "host.h"
+#include "board.h"
+#include "radio.h"
+#include "timer.h"
+#include "scheduler.h"
+#include "comms.h"
+
+static uint32_t fired = 0;
+
+static void OnTimer(void)
+{
+	fired++;
+}
+
+static void TestTimer(void)
+{
+	TimerEvent_t timer;
+	uint64_t start = Host_Micros();
+
+	TimerInit(&timer, OnTimer);
+	TimerSetValue(&timer, 50);
+	TimerStart(&timer);
+	Host_Advance(49);
+	CHECK(fired == 0);
+	Host_Advance(2);
+	CHECK(fired == 1);
+	CHECK(Host_Micros() - start >= 50000);
+}
+
+static void TestSend(void)
+{
+	uint8_t data[6];				//Below SPI_DMA_MIN_SIZE: written by polling
+	RadioEvent_t event;
+	const HostPacket_t *packet;
+	uint64_t air;
+
+	for (uint8_t n = 0; n < sizeof(data); n++) data[n] = n*7;
+	Scheduler_Register(EVT_RADIO, Radio.IrqProcess);
+	Radio.Init();
+	Radio.SetChannel(RF_FREQUENCY);
+	Radio.SetTxConfig(MODEM_LORA, TX_OUTPUT_POWER, 0, 0, 7, 1, LORA_PREAMBLE_LENGTH, false, true, 0, 0,
+			false, TX_TIMEOUT_VALUE);
+	Radio.Send(data, sizeof(data));
+	CHECK(Host_RadioPackets() == 1);
+	packet = Host_RadioPacket(0);
+	CHECK(packet->size == sizeof(data) && memcmp(packet->data, data, sizeof(data)) == 0);
+	CHECK(packet->sf == 7 && packet->bw == 125 && packet->cr == 1);
+	air = Radio.TimeOnAir(MODEM_LORA, sizeof(data))*1000;		//ms
+	CHECK(packet->end - packet->start + 1000 > air && packet->end - packet->start < air + 1000);
+
+	Host_Advance(100);
+	while (Scheduler_Dispatch());
+	CHECK(Radio.GetEvent(&event) && event.Type == RADIO_EVENT_TX_DONE);
+	CHECK(Host_RadioBusyErrors() == 0);
+}
+
+int main(void)
+{
+	Host_Init();
+	BoardInitMcu();
+	TestTimer();
+	TestSend();
+	return Host_Report("board");
+}
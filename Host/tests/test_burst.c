@@ -0,0 +1,84 @@
+/*
+ * test_burst.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Photo burst after a SEND_DATA, on the simulated SX126x: every packet after the
+ *  first one is preloaded while the previous one is on air, so the gap between the
+ *  TxDone of a packet and the start of the next one (the log of the radio) stays
+ *  below 1 ms, the packaging, the NVLog counters and the FEC included.
+ */
+
+#include "host.h"
+#include "board.h"
+#include "comms.h"
+#include "catalog.h"
+#include "nvlog.h"
+#include "settings.h"
+#include "definitions.h"
+
+#define PHOTO_BYTES					4000
+#define GAP_MAX						1000		//us
+
+static void StorePhoto(void)
+{
+	static uint8_t photo[PHOTO_BYTES];
+	int8_t slot;
+
+	for (uint16_t n = 0; n < sizeof(photo); n++) photo[n] = (uint8_t)(n*7 + 3);
+	Catalog_Init();
+	slot = Catalog_Allocate(CATALOG_PRIORITY_NORMAL);
+	CHECK(slot >= 0);
+	for (uint16_t n = 0; n < sizeof(photo); n += FLASH_PAGE_SIZE)
+	{
+		uint16_t size = (sizeof(photo) - n < FLASH_PAGE_SIZE) ? sizeof(photo) - n : FLASH_PAGE_SIZE;
+		Flash_Write_Data(Catalog_Addr(slot) + n, &photo[n], size);
+	}
+	Flash_Flush();
+	Catalog_Commit(slot, sizeof(photo), 0);
+}
+
+static void TestGap(void)
+{
+	static const uint8_t command[2] = { SEND_DATA, 0 };
+	uint8_t sf = 7, cr = 1;
+	uint32_t burst = 1;
+	uint64_t gap, longest = 0, total = 0;
+	const HostPacket_t *packet, *next;
+
+	Write_Flash(SF_ADDR, &sf, 1);					//Configuration of the ground
+	Write_Flash(CRC_ADDR, &cr, 1);
+	Flash_Flush();
+	Settings_Load();
+	NVLog_Init();
+	StorePhoto();
+	startComms();
+
+	Host_RadioUplink(command, sizeof(command), -90, 8);
+	for (int n = 0; n < 300; n++) Scheduler_Wait(10);
+	stopComms();
+
+	//First burst: the packets until the wait for the ACK
+	CHECK(Host_RadioPackets() > 2);
+	for (packet = Host_RadioPacket(0); (next = Host_RadioPacket(burst)) != NULL; packet = next, burst++)
+	{
+		gap = next->start - packet->end;
+		if (gap > 10*GAP_MAX) break;
+		if (gap > longest) longest = gap;
+		total += gap;
+	}
+	CHECK(burst >= 2 && burst <= WINDOW_SIZE + FEC_PARITY_PACKETS);
+	CHECK(longest < GAP_MAX);
+	CHECK(Host_RadioBusyErrors() == 0);
+
+	printf("burst of %u packets: gap %llu us at most, %llu us on average\n", burst,
+			(unsigned long long)longest, (unsigned long long)(total / (burst - 1)));
+}
+
+int main(void)
+{
+	Host_Init();
+	BoardInitMcu();
+	TestGap();
+	return Host_Report("burst");
+}
@@ -0,0 +1,124 @@
+/*
+ * test_camera.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  takePhoto and retrieveImage of payload_camera.c with the simulated VC0706 on
+ *  UART4: the parser of the 0x32 answers (header, data, footer) with the markers
+ *  also inside the data, the circular DMA ring wrapping around many times, a chunk
+ *  requested again after a silence or a line error, and a capture given up after
+ *  CAM_RETRIES. The USART2 driver of uart-board.c must not see the UART4 events.
+ */
+
+#include "host.h"
+#include "board.h"
+#include "payload_camera.h"
+#include "catalog.h"
+#include "flash.h"
+#include "fifo.h"
+
+#define IMAGE_SIZE					5000		//40 chunks of bSize, the ring wraps ~10 times
+#define CHUNK						128			//bSize of payload_camera.c
+
+extern uint32_t frameLength;
+
+static UART_HandleTypeDef huart4;
+static uint8_t image[IMAGE_SIZE];
+
+/*Bytes of a JPEG with the markers of the 0x32 answer inside the data*/
+static void MakeImage(uint8_t seed)
+{
+	static const uint8_t marker[5] = { 0x76, 0x00, 0x32, 0x00, 0x00 };
+
+	for (uint16_t n = 0; n < sizeof(image); n++) image[n] = (uint8_t)(n*29 + seed);
+	image[0] = 0xFF;
+	image[1] = 0xD8;
+	for (uint16_t n = 100; n + sizeof(marker) < sizeof(image); n += 997) memcpy(&image[n], marker, sizeof(marker));
+	memcpy(&image[CHUNK - 2], marker, sizeof(marker));		//Across two chunks
+	image[sizeof(image) - 2] = 0xFF;
+	image[sizeof(image) - 1] = 0xD9;
+	Host_CameraImage(image, sizeof(image));
+}
+
+static bool Stored(void)
+{
+	const CatalogEntry_t *entry = Catalog_Next();
+
+	return entry != NULL && entry->size == sizeof(image)
+			&& memcmp((uint8_t *)Catalog_Addr(Catalog_Slot(entry)), image, sizeof(image)) == 0;
+}
+
+static void Init(void)
+{
+	//As MX_UART4_Init
+	huart4.Instance = UART4;
+	huart4.Init.BaudRate = 115200;
+	huart4.Init.WordLength = UART_WORDLENGTH_8B;
+	huart4.Init.StopBits = UART_STOPBITS_1;
+	huart4.Init.Parity = UART_PARITY_NONE;
+	huart4.Init.Mode = UART_MODE_TX_RX;
+	huart4.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+	huart4.Init.OverSampling = UART_OVERSAMPLING_16;
+	CHECK(HAL_UART_Init(&huart4) == HAL_OK);
+	cameraInit(&huart4);
+	Catalog_Init();
+}
+
+/*Every chunk answered: one read per chunk*/
+static void TestRetrieve(void)
+{
+	uint32_t reads = Host_CameraReads();
+	uint32_t chunks = (sizeof(image) + CHUNK - 1) / CHUNK;
+
+	MakeImage(1);
+	CHECK(takePhoto(&huart4));
+	CHECK(frameLength == sizeof(image));
+	CHECK(Stored());
+	CHECK(Host_CameraReads() - reads == chunks);
+	CHECK(IsFifoEmpty(&Uart2.FifoRx));
+	Catalog_Sent();
+}
+
+/*A chunk not answered is asked again after CAM_TIMEOUT_MS*/
+static void TestRetry(void)
+{
+	uint32_t reads = Host_CameraReads();
+	uint64_t start = Host_Micros();
+
+	MakeImage(2);
+	Host_CameraDrop(1);
+	CHECK(takePhoto(&huart4));
+	CHECK(Stored());
+	CHECK(Host_CameraReads() - reads == (sizeof(image) + CHUNK - 1) / CHUNK);
+	CHECK(Host_Micros() - start >= CAM_TIMEOUT_MS*1000);
+	Catalog_Sent();
+
+	//The reception aborted by a framing error is started again
+	MakeImage(3);
+	Host_CameraLineError();
+	CHECK(takePhoto(&huart4));
+	CHECK(Stored());
+	CHECK(IsFifoEmpty(&Uart2.FifoRx));
+	Catalog_Sent();
+}
+
+/*The camera stops answering: the capture is given up and nothing is listed*/
+static void TestGiveUp(void)
+{
+	MakeImage(4);
+	Host_CameraDrop(CAM_RETRIES + 1);
+	CHECK(!takePhoto(&huart4));
+	CHECK(Catalog_Next() == NULL);
+	CHECK(Catalog_Available() == CATALOG_SLOTS);
+}
+
+int main(void)
+{
+	Host_Init();
+	BoardInitMcu();
+	Init();
+	TestRetrieve();
+	TestRetry();
+	TestGiveUp();
+	return Host_Report("camera");
+}
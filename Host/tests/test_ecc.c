@@ -0,0 +1,116 @@
+/*
+ * test_ecc.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Fault injection in the flash: every single bit of a page and of its code is
+ *  flipped in the simulated flash (Host_FlashFlip) and fixed by the scrubber, and two
+ *  wrong bits are reported once. The flips are in the flash cells, so the clean copy
+ *  of the page that flash.c keeps in its cache is evicted before each one.
+ */
+
+#include "host.h"
+#include "ecc.h"
+#include "flash.h"
+#include "nvlog.h"
+#include "stm32l1xx_hal.h"
+#include <stdlib.h>
+
+#define PAGE			(PHOTO_ADDR + 5*FLASH_PAGE_SIZE)
+#define CODE			(ECC_ADDR + 5*ECC_CODE_SIZE)
+#define OTHER			(PHOTO_ADDR + 64*FLASH_PAGE_SIZE)	//Pages written to evict PAGE from the cache
+
+static uint8_t original[FLASH_PAGE_SIZE];
+
+/*Commits the cache and fills it with other pages*/
+static void Evict(void)
+{
+	static uint8_t data[FLASH_PAGE_SIZE];
+
+	Flash_Flush();
+	for (uint8_t n = 0; n < FLASH_CACHE_PAGES; n++)
+	{
+		data[0]++;
+		Flash_Write_Data(OTHER + n*FLASH_PAGE_SIZE, data, FLASH_PAGE_SIZE);
+	}
+	Flash_Flush();
+}
+
+static bool Page_Intact(void)
+{
+	Evict();
+	return memcmp((const uint8_t *)PAGE, original, FLASH_PAGE_SIZE) == 0;
+}
+
+int main(void)
+{
+	EccStats_t stats;
+	uint8_t code[ECC_CODE_SIZE];
+	bool all_fixed = true;
+
+	Host_Init();
+
+	//CRC-16/CCITT-FALSE check value
+	CHECK(ECC_CRC(0xFFFF, (const uint8_t *)"123456789", 9) == 0x29B1);
+
+	srand(2);
+	for (uint16_t n = 0; n < FLASH_PAGE_SIZE; n++) original[n] = rand();
+	Flash_Write_Data(PAGE, original, FLASH_PAGE_SIZE);
+	ECC_Protect(PAGE, FLASH_PAGE_SIZE);
+	Evict();
+	Flash_Read_Data(CODE, code, ECC_CODE_SIZE);
+	CHECK(code[0] & (ECC_VALID >> 8));
+
+	//Intact page: checked once per call (the only one protected), nothing to fix
+	ECC_Scrub();
+	ECC_Get_Stats(&stats);
+	CHECK(stats.checked == 1 && stats.corrected == 0 && stats.uncorrectable == 0);
+
+	//Every bit of the page
+	for (uint16_t bit = 0; bit < 8*FLASH_PAGE_SIZE; bit++)
+	{
+		Host_FlashFlip(PAGE + bit / 8, 1 << (bit % 8));
+		ECC_Scrub();
+		all_fixed &= Page_Intact();
+	}
+	CHECK(all_fixed);
+
+	//Every bit of the code: the code is written again, the page is not touched
+	for (uint8_t bit = 0; bit < 8*ECC_CODE_SIZE; bit++)
+	{
+		if (bit == 7) continue;					//ECC_VALID: without it the page is not protected any more
+		Host_FlashFlip(CODE + bit / 8, 1 << (bit % 8));
+		ECC_Scrub();
+		all_fixed &= Page_Intact() && memcmp((const uint8_t *)CODE, code, ECC_CODE_SIZE) == 0;
+	}
+	CHECK(all_fixed);
+	ECC_Get_Stats(&stats);
+	CHECK(stats.corrected == 8*FLASH_PAGE_SIZE + 8*ECC_CODE_SIZE - 1);
+	CHECK(stats.uncorrectable == 0);
+
+	//Two wrong bits: logged once, the code is dropped and the page is left as it is
+	Host_FlashFlip(PAGE + 10, 0x01);
+	Host_FlashFlip(PAGE + 200, 0x80);
+	ECC_Scrub();
+	ECC_Scrub();
+	ECC_Get_Stats(&stats);
+	CHECK(stats.uncorrectable == 1 && stats.last_error == PAGE);
+	CHECK(NVLog_Read(NVLOG_ECC_ERRORS) == 1);
+	Evict();
+	CHECK(((const uint8_t *)PAGE)[10] == (original[10] ^ 0x01));
+	Flash_Read_Data(CODE, code, ECC_CODE_SIZE);
+	CHECK(code[0] == 0 && code[1] == 0);
+
+	//Invalidated pages are not checked
+	ECC_Protect(PAGE, FLASH_PAGE_SIZE);
+	ECC_Invalidate(PAGE, FLASH_PAGE_SIZE);
+	ECC_Get_Stats(&stats);
+	ECC_Scrub();
+	{
+		EccStats_t after;
+		ECC_Get_Stats(&after);
+		CHECK(after.checked == stats.checked);
+	}
+
+	return Host_Report("ecc");
+}
@@ -0,0 +1,192 @@
+/*
+ * test_fec.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Rebuilds lost packets of a block from the parity packets, as the ground does:
+ *  parity j = sum over i of data i / (x_j + y_i), x_j = j, y_i = FEC_PARITY_PACKETS + i,
+ *  with GF(256) computed here bit by bit (independent of the tables of fec.c). Then a
+ *  benchmark of the encoding with the longest packets.
+ */
+
+#include "host.h"
+#include "comms.h"
+#include "packetizer.h"
+#include <stdlib.h>
+
+#define LENGTH			100						//Data size of the packets
+#define LAST			70						//Data size of the last packet of the photo
+#define BENCH_BLOCKS	200						//Blocks of WINDOW_SIZE packets of PKT_MAX_DATA bytes
+
+static uint8_t photo[WINDOW_SIZE + 3][LENGTH];
+static uint8_t parity[FEC_PARITY_PACKETS][LENGTH];
+
+static uint8_t Mul(uint8_t a, uint8_t b)
+{
+	uint8_t r = 0;
+
+	while (b != 0)
+	{
+		if (b & 1) r ^= a;
+		a = (a & 0x80) ? (a << 1) ^ 0x1D : a << 1;
+		b >>= 1;
+	}
+	return r;
+}
+
+static uint8_t Inv(uint8_t a)
+{
+	for (uint16_t b = 1; b < 256; b++)
+	{
+		if (Mul(a, b) == 1) return b;
+	}
+	return 0;
+}
+
+/*Coefficient of the packet i in the parity j*/
+static uint8_t Coef(uint8_t j, uint8_t i)
+{
+	return Inv(j ^ (FEC_PARITY_PACKETS + i));
+}
+
+/*Sends count packets of the photo from seq and takes the parity packets of the block*/
+static uint8_t Send(uint16_t first, uint8_t count, uint16_t total, uint16_t *offset)
+{
+	uint16_t id, parity_offset;
+	const uint8_t *data;
+	uint8_t length, parities = 0;
+
+	for (uint16_t seq = first; seq < first + count; seq++)
+	{
+		uint16_t start = seq*LENGTH;
+		FEC_Add(seq, start, photo[seq], (total - start < LENGTH) ? total - start : LENGTH);
+	}
+	while (FEC_Next(&id, &parity_offset, &data, &length))
+	{
+		CHECK(id == (FEC_PARITY_FLAG | ((first / WINDOW_SIZE) << 4) | parities));
+		CHECK(length == LENGTH);
+		memcpy(parity[parities++], data, length);
+		*offset = parity_offset;
+	}
+	return parities;
+}
+
+/*Parity j without the packets of the block other than a and b*/
+static void Residue(uint8_t j, uint8_t a, uint8_t b, uint8_t count, uint8_t *out)
+{
+	memcpy(out, parity[j], LENGTH);
+	for (uint8_t i = 0; i < count; i++)
+	{
+		if (i == a || i == b) continue;
+		for (uint8_t n = 0; n < LENGTH; n++) out[n] ^= Mul(Coef(j, i), photo[i][n]);
+	}
+}
+
+static void TestRebuild(void)
+{
+	uint16_t total = WINDOW_SIZE*LENGTH, offset = 0xFFFF;
+	uint8_t r1[LENGTH], r2[LENGTH];
+
+	srand(1);
+	for (uint16_t seq = 0; seq < WINDOW_SIZE + 3; seq++)
+	{
+		for (uint8_t n = 0; n < LENGTH; n++) photo[seq][n] = rand();
+	}
+
+	//A full block: every packet is rebuilt from any parity packet
+	FEC_Init(total);
+	CHECK(Send(0, WINDOW_SIZE, total, &offset) == FEC_PARITY_PACKETS);
+	CHECK(offset == 0);
+	for (uint8_t j = 0; j < FEC_PARITY_PACKETS; j++)
+	{
+		for (uint8_t k = 0; k < WINDOW_SIZE; k++)
+		{
+			Residue(j, k, k, WINDOW_SIZE, r1);
+			uint8_t c = Inv(Coef(j, k));
+			bool same = true;
+			for (uint8_t n = 0; n < LENGTH; n++) same &= Mul(c, r1[n]) == photo[k][n];
+			CHECK(same);
+		}
+	}
+
+	//Two packets lost: 2 parity packets (the Cauchy matrix is always invertible)
+	{
+		uint8_t a = 3, b = 17;
+		uint8_t a11 = Coef(0, a), a12 = Coef(0, b), a21 = Coef(2, a), a22 = Coef(2, b);
+		uint8_t det_inv = Inv(Mul(a11, a22) ^ Mul(a12, a21));
+		bool same = true;
+
+		Residue(0, a, b, WINDOW_SIZE, r1);
+		Residue(2, a, b, WINDOW_SIZE, r2);
+		for (uint8_t n = 0; n < LENGTH; n++)
+		{
+			same &= Mul(det_inv, Mul(r1[n], a22) ^ Mul(r2[n], a12)) == photo[a][n];
+			same &= Mul(det_inv, Mul(a11, r2[n]) ^ Mul(a21, r1[n])) == photo[b][n];
+		}
+		CHECK(same);
+	}
+
+	//Last block of the photo, shorter, with a short last packet taken as padded with zeros
+	total = (WINDOW_SIZE + 2)*LENGTH + LAST;
+	FEC_Init(total);
+	memset(&photo[WINDOW_SIZE + 2][LAST], 0, LENGTH - LAST);
+	CHECK(Send(0, WINDOW_SIZE, total, &offset) == FEC_PARITY_PACKETS);
+	CHECK(Send(WINDOW_SIZE, 3, total, &offset) == FEC_PARITY_PACKETS);
+	CHECK(offset == WINDOW_SIZE*LENGTH);
+	{
+		uint8_t c = Inv(Coef(1, 2));
+		bool same = true;
+		memmove(photo, photo[WINDOW_SIZE], 3*LENGTH);
+		Residue(1, 2, 2, 3, r1);
+		for (uint8_t n = 0; n < LENGTH; n++) same &= Mul(c, r1[n]) == photo[2][n];
+		CHECK(same);
+	}
+
+	//A packet missed (e.g. after a reset): no parity for that block
+	FEC_Init(total);
+	FEC_Add(0, 0, photo[0], LENGTH);
+	for (uint16_t seq = 2; seq < WINDOW_SIZE; seq++) FEC_Add(seq, seq*LENGTH, photo[seq], LENGTH);
+	{
+		uint16_t id;
+		const uint8_t *data;
+		uint8_t length;
+		CHECK(!FEC_Next(&id, &offset, &data, &length));
+	}
+}
+
+/*Data bytes encoded per ms of the PC, parity packets taken included*/
+static void Bench(void)
+{
+	static uint8_t data[WINDOW_SIZE][PKT_MAX_DATA];
+	uint16_t id, offset;
+	const uint8_t *parity;
+	uint8_t length;
+	uint32_t parities = 0;
+	uint64_t start, elapsed;
+
+	for (uint8_t seq = 0; seq < WINDOW_SIZE; seq++)
+	{
+		for (uint8_t n = 0; n < PKT_MAX_DATA; n++) data[seq][n] = rand();
+	}
+
+	start = Host_Nanos();
+	for (uint16_t block = 0; block < BENCH_BLOCKS; block++)
+	{
+		FEC_Init(WINDOW_SIZE*PKT_MAX_DATA);
+		for (uint8_t seq = 0; seq < WINDOW_SIZE; seq++) FEC_Add(seq, seq*PKT_MAX_DATA, data[seq], PKT_MAX_DATA);
+		while (FEC_Next(&id, &offset, &parity, &length)) parities++;
+	}
+	elapsed = Host_Nanos() - start;
+	CHECK(parities == BENCH_BLOCKS*FEC_PARITY_PACKETS);
+
+	printf("fec encode of %u byte packets: %llu bytes/ms\n", PKT_MAX_DATA,
+			(unsigned long long)((uint64_t)BENCH_BLOCKS*WINDOW_SIZE*PKT_MAX_DATA*1000000 / elapsed));
+}
+
+int main(void)
+{
+	Host_Init();
+	TestRebuild();
+	Bench();
+	return Host_Report("fec");
+}
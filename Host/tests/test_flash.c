@@ -0,0 +1,103 @@
+/*
+ * test_flash.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Page cache of flash.c on the simulated flash: small writes merged in RAM until
+ *  Flash_Flush, unchanged data not rewritten, whole pages written over a slot that
+ *  still holds another page, EEPROM writes and a failing erase.
+ */
+
+#include "host.h"
+#include "flash.h"
+
+#define PAGE						256
+
+static void Pattern(uint8_t *data, uint16_t size, uint8_t seed)
+{
+	for (uint16_t n = 0; n < size; n++) data[n] = (uint8_t)(n*31 + seed) | 1;
+}
+
+/*Several writes in a page: one erase and two half pages at the flush*/
+static void TestMerge(void)
+{
+	uint8_t data[PAGE];
+	uint32_t erases = Host_FlashErases();
+	uint32_t programs = Host_FlashPrograms();
+
+	Pattern(data, sizeof(data), 1);
+	for (uint16_t n = 0; n < PAGE; n += 16) CHECK(Flash_Write_Data(SLOT_ADDR + n, &data[n], 16) == 0);
+	CHECK(Host_FlashErases() == erases);
+	CHECK(Flash_Flush() == 0);
+	CHECK(Host_FlashErases() == erases + 1);
+	CHECK(Host_FlashPrograms() == programs + 2);
+	CHECK(memcmp((uint8_t *)SLOT_ADDR, data, PAGE) == 0);
+
+	//The same data again: nothing to write
+	CHECK(Flash_Write_Data(SLOT_ADDR + 32, &data[32], 64) == 0);
+	CHECK(Flash_Flush() == 0);
+	CHECK(Host_FlashErases() == erases + 1);
+}
+
+/*A whole page written in a slot that held the same bytes for another page*/
+static void TestStaleSlot(void)
+{
+	uint8_t data[PAGE];
+	uint32_t erases;
+
+	Pattern(data, sizeof(data), 7);
+	for (uint32_t page = 1; page <= FLASH_CACHE_PAGES; page++)
+	{
+		CHECK(Flash_Write_Data(SLOT_ADDR + page*PAGE, data, PAGE) == 0);
+	}
+	CHECK(Flash_Flush() == 0);
+
+	erases = Host_FlashErases();
+	CHECK(Flash_Write_Data(SLOT_ADDR + 8*PAGE, data, PAGE) == 0);
+	CHECK(Flash_Flush() == 0);
+	CHECK(Host_FlashErases() == erases + 1);
+	CHECK(memcmp((uint8_t *)(SLOT_ADDR + 8*PAGE), data, PAGE) == 0);
+
+	//Across two pages, the second one whole
+	Pattern(data, sizeof(data), 9);
+	CHECK(Flash_Write_Data(SLOT_ADDR + 10*PAGE - 16, data, 16) == 0);
+	CHECK(Flash_Write_Data(SLOT_ADDR + 11*PAGE, data, PAGE) == 0);
+	CHECK(Flash_Flush() == 0);
+	CHECK(memcmp((uint8_t *)(SLOT_ADDR + 10*PAGE - 16), data, 16) == 0);
+	CHECK(memcmp((uint8_t *)(SLOT_ADDR + 11*PAGE), data, PAGE) == 0);
+}
+
+/*Data EEPROM: programmed at once, byte by byte*/
+static void TestEeprom(void)
+{
+	uint8_t data[12];
+	uint32_t programs = Host_EepromPrograms();
+
+	Pattern(data, sizeof(data), 3);
+	CHECK(Flash_Write_Data(REDUNDANT_ADDR + 0x100, data, sizeof(data)) == 0);
+	CHECK(Host_EepromPrograms() == programs + sizeof(data));
+	CHECK(memcmp((uint8_t *)(REDUNDANT_ADDR + 0x100), data, sizeof(data)) == 0);
+}
+
+/*A failing erase keeps the page dirty: the next flush writes it*/
+static void TestFailure(void)
+{
+	uint8_t data[16];
+
+	Pattern(data, sizeof(data), 5);
+	CHECK(Flash_Write_Data(SLOT_ADDR + 20*PAGE, data, sizeof(data)) == 0);
+	Host_FlashFail(1);
+	CHECK(Flash_Flush() != 0);
+	CHECK(Flash_Flush() == 0);
+	CHECK(memcmp((uint8_t *)(SLOT_ADDR + 20*PAGE), data, sizeof(data)) == 0);
+}
+
+int main(void)
+{
+	Host_Init();
+	TestMerge();
+	TestStaleSlot();
+	TestEeprom();
+	TestFailure();
+	return Host_Report("flash");
+}
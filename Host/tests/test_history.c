@@ -0,0 +1,139 @@
+/*
+ * test_history.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Encoding of the history records (varint time and mask, zigzag deltas) read back
+ *  from the page written to the ring, and the scan of the ring after a reset. Then
+ *  a SEND_TELEMETRY uplinked with no photo stored: the snapshot and the history
+ *  pages are sent, and nothing else.
+ */
+
+#include "host.h"
+#include "history.h"
+#include "flash.h"
+#include "ecc.h"
+#include "board.h"
+#include "timer.h"
+#include "comms.h"
+#include "settings.h"
+#include "definitions.h"
+
+static uint8_t fields[HISTORY_FIELDS] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+/*Stores the snapshot as sensorReadings and checkbatteries do*/
+static void Telemetry(void)
+{
+	Write_Flash(TEMP_ADDR, fields, 7);
+	Write_Flash(VOLTAGE_ADDR, &fields[7], 1);
+	Write_Flash(CURRENT_ADDR, &fields[8], 1);
+	Write_Flash(BATT_LEVEL_ADDR, &fields[9], 1);
+}
+
+static void TestRecords(void)
+{
+	static const uint8_t records[] = {
+		0x3C, 0x04, 0x06,								//60 s, field 2, +3
+		0xC8, 0x01, 0x81, 0x04, 0xC8, 0x01, 0x01,		//200 s, fields 0 and 9, +100 and -1
+		0xFF, 0xFF, 0x03, 0x00,							//More than 0xFFFF s, nothing changed
+	};
+	const uint8_t *page = (const uint8_t *)HISTORY_ADDR;
+	uint8_t code[ECC_CODE_SIZE];
+	uint16_t seq;
+	uint32_t start;
+
+	History_Init();
+	CHECK(History_Pages() == 0);
+
+	Telemetry();
+	start = TimerGetCurrentTime() / 1000;
+	CHECK(History_Sample());
+	CHECK(!History_Sample());						//HISTORY_PERIOD not elapsed
+
+	Host_Advance(60000);
+	fields[2] += 3;
+	Telemetry();
+	CHECK(History_Sample());
+
+	Host_Advance(200000);
+	fields[0] += 100;
+	fields[9] -= 1;
+	Telemetry();
+	CHECK(History_Sample());
+
+	Host_Advance(70000000);
+	CHECK(History_Sample());
+
+	History_Flush();
+	Flash_Flush();									//Out of the page cache of flash.c
+	CHECK(History_Pages() == 1);
+	CHECK(History_Page(0, &seq) == HISTORY_ADDR && seq == 0);
+
+	//Header: magic, seq, time of the first sample (s), first sample as it is
+	CHECK(page[0] == HISTORY_MAGIC && page[1] == 0 && page[2] == 0);
+	CHECK(page[3] == (start >> 24) && page[4] == ((start >> 16) & 0xFF));
+	CHECK(page[5] == ((start >> 8) & 0xFF) && page[6] == (start & 0xFF));
+	for (uint8_t n = 0; n < HISTORY_FIELDS; n++) CHECK(page[7 + n] == n + 1);
+	CHECK(memcmp(&page[HISTORY_PAGE_HEADER], records, sizeof(records)) == 0);
+	CHECK(page[HISTORY_PAGE_HEADER + sizeof(records)] == 0);
+
+	//Protected by the ECC (the history pages come after the 256 pages of the slot 0)
+	Flash_Read_Data(ECC_ADDR + 256*ECC_CODE_SIZE, code, ECC_CODE_SIZE);
+	CHECK(code[0] & (ECC_VALID >> 8));
+
+	//After a reset the page is found and the next one continues the sequence
+	History_Init();
+	CHECK(History_Pages() == 1);
+	CHECK(History_Sample());
+	History_Flush();
+	Flash_Flush();
+	CHECK(History_Page(0, &seq) == HISTORY_ADDR + FLASH_PAGE_SIZE && seq == 1);
+	CHECK(History_Page(1, &seq) == HISTORY_ADDR && seq == 0);
+}
+
+static void TestSendTelemetry(void)
+{
+	static const uint8_t command[2] = { SEND_TELEMETRY, 1 };	//Snapshot and the last page
+	uint8_t sf = 7, cr = 1;
+	uint32_t first = Host_RadioPackets();
+	uint8_t telemetry[BUFFER_SIZE];
+	const HostPacket_t *packet;
+	uint16_t seq;
+
+	BoardInitMcu();
+	Write_Flash(SF_ADDR, &sf, 1);					//Configuration of the ground
+	Write_Flash(CRC_ADDR, &cr, 1);
+	Flash_Flush();
+	Settings_Load();
+	startComms();
+
+	Host_RadioUplink(command, sizeof(command), -90, 8);
+	for (int n = 0; n < 500; n++) Scheduler_Wait(10);
+	stopComms();
+
+	CHECK(Host_RadioPackets() - first == 2 + HISTORY_PARTS);
+	if (Host_RadioPackets() - first != 2 + HISTORY_PARTS) return;
+
+	Flash_Read_Data(TELEMETRY_ADDR, telemetry, sizeof(telemetry));
+	packet = Host_RadioPacket(first);
+	CHECK(packet->size == BUFFER_SIZE && memcmp(packet->data, telemetry, BUFFER_SIZE) == 0);
+
+	//The newest page, in HISTORY_PARTS packets
+	for (uint8_t part = 0; part < HISTORY_PARTS; part++)
+	{
+		const uint8_t *data = (const uint8_t *)(History_Page(0, &seq) + part*HISTORY_PACKET_DATA);
+
+		packet = Host_RadioPacket(first + 2 + part);
+		CHECK(packet->size == HISTORY_HEADER_SIZE + HISTORY_PACKET_DATA);
+		CHECK(packet->data[0] == seq >> 8 && packet->data[1] == (seq & 0xFF) && packet->data[2] == part);
+		CHECK(memcmp(&packet->data[HISTORY_HEADER_SIZE], data, HISTORY_PACKET_DATA) == 0);
+	}
+}
+
+int main(void)
+{
+	Host_Init();
+	TestRecords();
+	TestSendTelemetry();
+	return Host_Report("history");
+}
@@ -0,0 +1,80 @@
+/*
+ * test_packetizer.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Data size of the packets for every SF/BW and the header, with its CRC computed bit
+ *  by bit. The parameters of the test are set in the SX126x driver, so the real
+ *  Radio.TimeOnAir reads them as after a SetTxConfig.
+ */
+
+#include "host.h"
+#include "comms.h"
+#include "timeonair.h"
+#include "sx126x.h"
+
+static TimeOnAirLoRa_t params = { .coding_rate = 1, .crc = true, .preamble = 8 };
+
+/*Modulation and packet parameters of the radio, as SetTxConfig stores them*/
+static void Configure(void)
+{
+	SX126x.ModulationParams.Params.LoRa.Bandwidth = params.bandwidth;
+	SX126x.ModulationParams.Params.LoRa.SpreadingFactor = params.spreading_factor;
+	SX126x.ModulationParams.Params.LoRa.CodingRate = params.coding_rate;
+	SX126x.ModulationParams.Params.LoRa.LowDatarateOptimize = params.low_datarate_optimize;
+	SX126x.PacketParams.Params.LoRa.CrcMode = params.crc ? LORA_CRC_ON : LORA_CRC_OFF;
+	SX126x.PacketParams.Params.LoRa.HeaderType = params.fixed_length ? LORA_PACKET_FIXED_LENGTH : LORA_PACKET_VARIABLE_LENGTH;
+	SX126x.PacketParams.Params.LoRa.PreambleLength = params.preamble;
+}
+
+static uint16_t Crc_Bitwise(const uint8_t *data, uint16_t length, uint16_t crc)
+{
+	for (uint16_t n = 0; n < length; n++)
+	{
+		crc ^= data[n] << 8;
+		for (uint8_t bit = 0; bit < 8; bit++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+int main(void)
+{
+	uint8_t header[PKT_HEADER_SIZE], data[PKT_MAX_DATA];
+
+	Host_Init();
+
+	//Longest packet within PKT_TARGET_TOA (PKT_MIN_DATA if even that one is longer)
+	for (params.bandwidth = 4; params.bandwidth <= 6; params.bandwidth++)
+	{
+		for (params.spreading_factor = 7; params.spreading_factor <= 12; params.spreading_factor++)
+		{
+			Configure();
+			uint8_t size = Packetizer_DataSize();
+			CHECK(size >= PKT_MIN_DATA && size <= PKT_MAX_DATA);
+			if (size > PKT_MIN_DATA) CHECK(TimeOnAir_LoRa(&params, PKT_HEADER_SIZE + size) <= PKT_TARGET_TOA);
+			if (size < PKT_MAX_DATA) CHECK(TimeOnAir_LoRa(&params, PKT_HEADER_SIZE + size + 1) > PKT_TARGET_TOA);
+		}
+	}
+	params.bandwidth = 4;
+	params.spreading_factor = 7;
+	Configure();
+	CHECK(Packetizer_DataSize() == PKT_MAX_DATA);
+	params.spreading_factor = 12;
+	Configure();
+	CHECK(Packetizer_DataSize() == PKT_MIN_DATA);
+
+	for (uint8_t n = 0; n < PKT_MAX_DATA; n++) data[n] = n*7 + 3;
+	Packetizer_Header(header, 0x1234, 0x56, 0x789A, data, 100);
+	CHECK(header[0] == 0x12 && header[1] == 0x34 && header[2] == 0x56);
+	CHECK(header[3] == 0x78 && header[4] == 0x9A && header[5] == 100);
+	{
+		uint16_t crc = Crc_Bitwise(data, 100, Crc_Bitwise(header, 6, 0xFFFF));
+		CHECK(header[6] == (crc >> 8) && header[7] == (crc & 0xFF));
+	}
+
+	//A parity packet
+	Packetizer_Header(header, FEC_PARITY_FLAG | 0x21, 0x01, 0, data, PKT_MAX_DATA);
+	CHECK(header[0] == 0x80 && header[1] == 0x21 && header[5] == PKT_MAX_DATA);
+
+	return Host_Report("packetizer");
+}
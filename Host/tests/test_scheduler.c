@@ -0,0 +1,91 @@
+/*
+ * test_scheduler.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Scheduler_Wait with the IWDG of main.c (443 ms window): the main loop waits of
+ *  MAIN_LOOP_PERIOD do not reset the MCU once the watchdog is registered, a handler
+ *  that hangs still does. The comms state machine waits for the CAD with a timer,
+ *  so the loop keeps dispatching during the CAD_DELAY.
+ */
+
+#include "host.h"
+#include "board.h"
+#include "scheduler.h"
+#include "comms.h"
+#include "settings.h"
+
+#define MAIN_LOOP_PERIOD			1000		//main.c
+
+static IWDG_HandleTypeDef hiwdg;
+
+static void Hang(void)
+{
+	HAL_Delay(1000);
+}
+
+static void TestWatchdog(void)
+{
+	uint32_t resets;
+	uint64_t start;
+
+	//As MX_IWDG_Init
+	hiwdg.Instance = IWDG;
+	hiwdg.Init.Prescaler = IWDG_PRESCALER_4;
+	hiwdg.Init.Reload = 4095;
+	CHECK(HAL_IWDG_Init(&hiwdg) == HAL_OK);
+
+	//Not refreshed: a wait of the main loop lasts two windows
+	Scheduler_Wait(MAIN_LOOP_PERIOD);
+	CHECK(Host_WatchdogResets() == 2);
+
+	HAL_IWDG_Refresh(&hiwdg);
+	Scheduler_Watchdog(&hiwdg);
+	resets = Host_WatchdogResets();
+	start = Host_Micros();
+	for (int n = 0; n < 10; n++) Scheduler_Wait(MAIN_LOOP_PERIOD);
+	CHECK(Host_WatchdogResets() == resets);
+	CHECK(Host_Micros() - start >= 10*MAIN_LOOP_PERIOD*1000);
+	CHECK(Host_Micros() - start < 10*MAIN_LOOP_PERIOD*1000 + 20000);
+
+	//A handler that hangs is not hidden by the refresh
+	Scheduler_Register(EVT_I2C, Hang);
+	Scheduler_Post(EVT_I2C);
+	Scheduler_Wait(MAIN_LOOP_PERIOD);
+	CHECK(Host_WatchdogResets() > resets);
+	Scheduler_Register(EVT_I2C, NULL);
+}
+
+/*The CAD_DELAY does not block the loop: short waits end on time*/
+static void TestCadDelay(void)
+{
+	uint64_t longest = 0;
+	uint32_t packets = Host_RadioPackets();
+	uint8_t sf = 7, cr = 1;
+
+	Write_Flash(SF_ADDR, &sf, 1);				//Configuration of the ground
+	Write_Flash(CRC_ADDR, &cr, 1);
+	Flash_Flush();
+	Settings_Load();
+	startComms();
+	for (int n = 0; n < 300; n++)				//3 s: three CAD cycles of CAD_TIMER_TIMEOUT
+	{
+		uint64_t start = Host_Micros();
+
+		Scheduler_Wait(10);
+		if (Host_Micros() - start > longest) longest = Host_Micros() - start;
+	}
+	stopComms();
+	CHECK(longest < 10000 + CAD_DELAY*1000/2);
+	CHECK(Host_RadioPackets() == packets);		//Only listening
+	CHECK(Host_RadioBusyErrors() == 0);
+}
+
+int main(void)
+{
+	Host_Init();
+	BoardInitMcu();
+	TestWatchdog();
+	TestCadDelay();
+	return Host_Report("scheduler");
+}
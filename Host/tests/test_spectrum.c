@@ -0,0 +1,195 @@
+/*
+ * test_spectrum.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Spectrogram of spectrum.c on the simulated SX126x, taken from the comms as the
+ *  PAYLOAD state does. The RSSI of every bin is set by the test, one bin switching
+ *  between -60 and -120 dBm: its power mean is -63 dBm, not the -90 of the dBm.
+ *  The rows read back from SPECTRUM_ADDR (PackBits, key rows and differences with
+ *  the deadband) must give the levels of the band, and a flat band of 256 bins
+ *  the runs of zeros.
+ */
+
+#include "host.h"
+#include "board.h"
+#include "comms.h"
+#include "flash.h"
+#include "settings.h"
+#include "spectrum.h"
+
+#define F_MIN						168			//868 MHz
+#define DELTA_F						1			//125 kHz
+#define BINS						17
+#define ROWS						(SPECTRUM_KEY_ROWS + 4)
+#define SWITCHING_BIN				5			//-60/-120 dBm
+#define SWITCHING_PERIOD			50			//us at each level
+
+static int8_t offset = 0;						//dB added to the band, changed every row
+static uint8_t expected[ROWS][SPECTRUM_MAX_BINS];
+
+static uint16_t Bin(uint32_t frequency)
+{
+	return (frequency - SPECTRUM_F_BASE - (uint32_t)F_MIN*1000000 + SPECTRUM_F_UNIT/2) / (DELTA_F*SPECTRUM_F_UNIT);
+}
+
+static int16_t Band(uint32_t frequency)
+{
+	uint16_t bin = Bin(frequency);
+
+	if (bin == SWITCHING_BIN) return ((Host_Micros() / SWITCHING_PERIOD) % 2) ? -60 : -120;
+	return -120 + (bin % 5)*10 + offset;
+}
+
+static int16_t Flat(uint32_t frequency)
+{
+	(void)frequency;
+	return -110;
+}
+
+static void Configure(uint8_t f_min, uint8_t f_max, uint8_t delta_f, uint8_t integration)
+{
+	Write_Flash(F_MIN_ADDR, &f_min, 1);
+	Write_Flash(F_MAX_ADDR, &f_max, 1);
+	Write_Flash(DELTA_F_ADDR, &delta_f, 1);
+	Write_Flash(INTEGRATION_TIME_ADDR, &integration, 1);
+	Flash_Flush();
+	Settings_Load();
+}
+
+/*PackBits decoding, returns the bytes of out*/
+static uint16_t Unpack(uint8_t *out, const uint8_t *in, uint16_t length)
+{
+	uint16_t n = 0, i = 0;
+
+	while (i < length)
+	{
+		uint8_t code = in[i++];
+		if (code < 128)
+		{
+			memcpy(&out[n], &in[i], code + 1);
+			n += code + 1;
+			i += code + 1;
+		}
+		else if (code > 128)
+		{
+			memset(&out[n], in[i++], 257 - code);
+			n += 257 - code;
+		}
+	}
+	return n;
+}
+
+/*Reads back the rows, returns how many there are*/
+static uint16_t Decode(uint8_t rows[][SPECTRUM_MAX_BINS], uint16_t max, uint16_t bins, uint32_t size)
+{
+	const uint8_t *data = (const uint8_t *)SPECTRUM_ADDR;
+	uint8_t row[SPECTRUM_MAX_BINS + 128];
+	uint32_t pos = SPECTRUM_HEADER_SIZE;
+	uint16_t count = 0;
+
+	while (pos + 2 <= size)
+	{
+		uint16_t length = (data[pos] << 8) | data[pos + 1];
+		pos += 2;
+		if (length == 0) break;				//End
+		CHECK(Unpack(row, &data[pos], length) == bins);
+		pos += length;
+		if (count >= max) return max + 1;
+		for (uint16_t n = 0; n < bins; n++)
+		{
+			rows[count][n] = (count % SPECTRUM_KEY_ROWS == 0) ? row[n] : (uint8_t)(rows[count - 1][n] + row[n]);
+		}
+		count++;
+	}
+	CHECK(pos == size);
+	return count;
+}
+
+static void TestSpectrogram(void)
+{
+	static uint8_t rows[ROWS][SPECTRUM_MAX_BINS];
+	const uint8_t *header = (const uint8_t *)SPECTRUM_ADDR;
+	uint32_t size;
+	bool same = true;
+
+	Configure(F_MIN, F_MIN + 2, DELTA_F, 2);
+	Host_RadioRssi(Band);
+	CHECK(Spectrum_Start());
+	for (uint16_t r = 0; r < ROWS; r++)
+	{
+		static const int8_t offsets[4] = { 0, 1, 4, 3 };	//Changes of 1 dB are dropped, not the others
+		offset = offsets[r % 4];
+		for (uint16_t n = 0; n < BINS; n++)
+		{
+			int16_t level = -120 + (n % 5)*10 + offset - SPECTRUM_DBM_MIN;
+			uint8_t previous = (r == 0) ? 0 : expected[r - 1][n];
+			bool noise = r % SPECTRUM_KEY_ROWS != 0 && level <= previous + SPECTRUM_DEADBAND && level + SPECTRUM_DEADBAND >= previous;
+			expected[r][n] = noise ? previous : level;
+			CHECK(Spectrum_Step());
+		}
+	}
+	for (uint16_t n = 0; n < 3; n++) CHECK(Spectrum_Step());	//Dropped by the stop
+	size = Spectrum_Stop();
+	CHECK(!Spectrum_Step());
+	Flash_Flush();
+
+	CHECK(header[0] == 0 && header[1] == BINS);
+	CHECK(header[2] == F_MIN && header[3] == F_MIN + 2 && header[4] == DELTA_F && header[5] == 2);
+	CHECK(Decode(rows, ROWS, BINS, size) == ROWS);
+	for (uint16_t r = 0; r < ROWS; r++)
+	{
+		for (uint16_t n = 0; n < BINS; n++)
+		{
+			if (n != SWITCHING_BIN) same &= rows[r][n] == expected[r][n];
+		}
+		//Power mean of -60 and -120 dBm, the mean of the dBm would be -90
+		CHECK(rows[r][SWITCHING_BIN] >= -64 - SPECTRUM_DBM_MIN && rows[r][SWITCHING_BIN] <= -63 - SPECTRUM_DBM_MIN);
+	}
+	CHECK(same);
+	CHECK(Host_RadioBusyErrors() == 0);
+}
+
+/*A flat band of 256 bins: the key rows are runs of one level, the others runs of zeros*/
+static void TestFlat(void)
+{
+	static uint8_t rows[SPECTRUM_KEY_ROWS + 1][SPECTRUM_MAX_BINS];
+	const uint8_t *data = (const uint8_t *)SPECTRUM_ADDR;
+	uint32_t size;
+	bool same = true;
+
+	Configure(F_MIN, F_MIN + 40, DELTA_F, 1);		//321 bins, clipped
+	Host_RadioRssi(Flat);
+	CHECK(Spectrum_Start());
+	for (uint16_t n = 0; n < (SPECTRUM_KEY_ROWS + 1)*SPECTRUM_MAX_BINS; n++) CHECK(Spectrum_Step());
+	size = Spectrum_Stop();
+	Flash_Flush();
+
+	CHECK(data[0] == SPECTRUM_MAX_BINS >> 8 && data[1] == (SPECTRUM_MAX_BINS & 0xFF));
+	CHECK(Decode(rows, SPECTRUM_KEY_ROWS + 1, SPECTRUM_MAX_BINS, size) == SPECTRUM_KEY_ROWS + 1);
+	for (uint16_t r = 0; r <= SPECTRUM_KEY_ROWS; r++)
+	{
+		for (uint16_t n = 0; n < SPECTRUM_MAX_BINS; n++) same &= rows[r][n] == -110 - SPECTRUM_DBM_MIN;
+	}
+	CHECK(same);
+	//Runs of 128: 4 bytes per row, plus the length
+	CHECK(size == SPECTRUM_HEADER_SIZE + (SPECTRUM_KEY_ROWS + 1)*(2 + 4) + 2);
+}
+
+int main(void)
+{
+	uint8_t sf = 7, cr = 1;
+
+	Host_Init();
+	BoardInitMcu();
+	Write_Flash(SF_ADDR, &sf, 1);					//Configuration of the ground
+	Write_Flash(CRC_ADDR, &cr, 1);
+	Flash_Flush();
+	Settings_Load();
+	startComms();									//The PAYLOAD state takes the radio from the comms
+	stopComms();
+
+	TestSpectrogram();
+	TestFlat();
+	return Host_Report("spectrum");
+}
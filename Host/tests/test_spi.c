@@ -0,0 +1,109 @@
+/*
+ * test_spi.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  DMA transfers of spi-board.c: the completion of SpiTransfer (callback, Busy,
+ *  SpiWait sleeping until the DMA interrupt), the blocks below SPI_DMA_MIN_SIZE
+ *  sent by polling and the fallback to polling when the HAL refuses the DMA. The
+ *  data goes through the buffer of the simulated SX126x and back.
+ */
+
+#include "host.h"
+#include "board.h"
+#include "spi.h"
+#include "sx126x.h"
+#include "sx126x-board.h"
+
+#define SPI_DMA_MIN_SIZE			8			//spi-board.c
+#define BYTE_TIME					2			//us at the 4 MHz of the 10 MHz request
+
+static uint32_t callbacks = 0;
+
+static void OnTransfer(void)
+{
+	callbacks++;
+}
+
+/*SpiTransfer returns at once and the callback runs from the DMA interrupt*/
+static void TestCallback(void)
+{
+	static Spi_t spi;
+	uint8_t tx[64], rx[64];
+	uint64_t start;
+
+	SpiInit(&spi, PB_15, PB_14, PB_13, NC);			//SPI2, nothing on the bus
+	for (uint8_t n = 0; n < sizeof(tx); n++) tx[n] = n;
+	memset(rx, 0, sizeof(rx));
+
+	start = Host_Micros();
+	CHECK(SpiTransfer(&spi, tx, rx, sizeof(tx), OnTransfer));
+	CHECK(spi.Busy && callbacks == 0);
+	SpiWait(&spi);
+	CHECK(!spi.Busy && callbacks == 1);
+	CHECK(Host_Micros() - start >= sizeof(tx)*BYTE_TIME);
+	CHECK(rx[0] == 0xFF && rx[sizeof(rx) - 1] == 0xFF);	//No slave: MISO pulled up
+
+	//A second transfer waits for the first one
+	CHECK(SpiTransfer(&spi, tx, NULL, sizeof(tx), OnTransfer));
+	CHECK(SpiTransfer(&spi, NULL, rx, sizeof(rx), NULL));
+	CHECK(callbacks == 2);
+	SpiWait(&spi);
+	CHECK(callbacks == 2 && !spi.Busy);
+
+	//Refused by the HAL: no transfer, no callback and the object is free
+	Host_SpiDmaFail(1);
+	CHECK(!SpiTransfer(&spi, tx, rx, sizeof(tx), OnTransfer));
+	CHECK(!spi.Busy && callbacks == 2);
+	SpiDeInit(&spi);
+}
+
+/*Round trip through the radio buffer with SpiOut and SpiIn*/
+static void RoundTrip(uint8_t size)
+{
+	uint8_t out[255], in[255];
+
+	for (uint16_t n = 0; n < size; n++) out[n] = n*13 + size;
+	memset(in, 0, sizeof(in));
+	SX126xWriteBuffer(0, out, size);
+	SX126xReadBuffer(0, in, size);
+	CHECK(memcmp(in, out, size) == 0);
+}
+
+static void TestBuffer(void)
+{
+	uint32_t dma = Host_SpiDmaTransfers();
+	uint32_t polled = Host_SpiPolledBytes();
+
+	//Long blocks: DMA, the opcodes and addresses only are polled
+	RoundTrip(200);
+	CHECK(Host_SpiDmaTransfers() == dma + 2);
+	CHECK(Host_SpiPolledBytes() - polled < 16);
+
+	//Short blocks: polling
+	dma = Host_SpiDmaTransfers();
+	polled = Host_SpiPolledBytes();
+	RoundTrip(SPI_DMA_MIN_SIZE - 1);
+	CHECK(Host_SpiDmaTransfers() == dma);
+	CHECK(Host_SpiPolledBytes() - polled >= 2*(SPI_DMA_MIN_SIZE - 1));
+
+	//DMA refused: the same data by polling
+	dma = Host_SpiDmaTransfers();
+	polled = Host_SpiPolledBytes();
+	Host_SpiDmaFail(2);
+	RoundTrip(100);
+	CHECK(Host_SpiDmaTransfers() == dma);
+	CHECK(Host_SpiPolledBytes() - polled >= 200);
+
+	CHECK(!SX126x.Spi.Busy);
+	CHECK(Host_RadioBusyErrors() == 0);
+}
+
+int main(void)
+{
+	Host_Init();
+	BoardInitMcu();
+	TestCallback();
+	TestBuffer();
+	return Host_Report("spi");
+}
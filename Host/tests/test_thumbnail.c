@@ -0,0 +1,304 @@
+/*
+ * test_thumbnail.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Thumbnail_Make on JPEGs encoded here: 640x480 YCbCr, baseline 4:2:0, 4:2:0 with a
+ *  restart interval (DRI and RSTn markers) that does not divide the MCU rows, and
+ *  4:2:2 as the VC0706 gives. The luminance blocks are flat at a known mean, with
+ *  some AC coefficients (runs and ZRL) that must be skipped, so the thumbnail is
+ *  known pixel by pixel. A truncated JPEG gives no thumbnail. Then a benchmark:
+ *  bytes of thumbnail out and time per KB of JPEG.
+ */
+
+#include "host.h"
+#include "thumbnail.h"
+#include "flash.h"
+#include "stm32l1xx_hal.h"
+#include <stdlib.h>
+
+#define WIDTH						640
+#define HEIGHT						480
+#define JPEG_MAX					SLOT_THUMB_OFFSET
+#define DC_STEP						2			//DC step of the quantization table
+#define BENCH_ROUNDS				20
+
+typedef struct
+{
+	uint8_t h, v;							//Sampling factors of the luminance
+	uint16_t interval;						//Restart interval (0 => no DRI)
+} Format_t;
+
+//Standard luminance DC table (annex K.3)
+static const uint8_t dc_counts[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t dc_symbols[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+//Small AC table: EOB, ZRL and a few run/size pairs
+static const uint8_t ac_counts[16] = { 0, 2, 3, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t ac_symbols[6] = { 0x00, 0x01, 0x11, 0x22, 0xF0, 0x52 };
+
+static uint16_t dc_code[12], ac_code[256];
+static uint8_t dc_size[12], ac_size[256];
+
+static uint8_t jpeg[JPEG_MAX];
+static uint32_t length;
+static uint32_t acc;
+static uint8_t nacc;
+
+/*Codes of a table from its counts (annex C)*/
+static void Codes(const uint8_t *counts, const uint8_t *symbols, uint16_t *code, uint8_t *size)
+{
+	uint16_t next = 0, index = 0;
+
+	for (uint8_t bits = 1; bits <= 16; bits++)
+	{
+		for (uint8_t n = 0; n < counts[bits - 1]; n++)
+		{
+			code[symbols[index]] = next++;
+			size[symbols[index++]] = bits;
+		}
+		next <<= 1;
+	}
+}
+
+static void Byte(uint8_t byte)
+{
+	if (length < sizeof(jpeg)) jpeg[length] = byte;
+	length++;
+}
+
+static void Word(uint16_t word)
+{
+	Byte(word >> 8);
+	Byte(word & 0xFF);
+}
+
+static void Put(uint16_t value, uint8_t n)
+{
+	for (int8_t bit = n - 1; bit >= 0; bit--)
+	{
+		acc = (acc << 1) | ((value >> bit) & 1);
+		if (++nacc == 8)
+		{
+			Byte(acc);
+			if ((acc & 0xFF) == 0xFF) Byte(0x00);		//Stuffed byte
+			acc = 0;
+			nacc = 0;
+		}
+	}
+}
+
+/*Pads the last byte with ones*/
+static void Align(void)
+{
+	while (nacc != 0) Put(1, 1);
+}
+
+/*Category and bits of a coefficient*/
+static void Coefficient(int16_t value, uint8_t *category, uint16_t *bits)
+{
+	uint16_t magnitude = (value < 0) ? -value : value;
+
+	*category = 0;
+	while (magnitude >> *category) (*category)++;
+	*bits = (value < 0) ? value + (1 << *category) - 1 : value;
+}
+
+static void Block(int16_t diff, bool ac)
+{
+	uint8_t category;
+	uint16_t bits;
+	uint8_t k = 1;
+
+	Coefficient(diff, &category, &bits);
+	Put(dc_code[category], dc_size[category]);
+	Put(bits, category);
+
+	while (ac && k < 48 && (rand() & 3) != 0)
+	{
+		static const uint8_t pairs[5] = { 0x01, 0x11, 0x22, 0x52, 0xF0 };
+		uint8_t rs = pairs[rand() % 5];
+		int16_t value = (rs & 0x0F) == 1 ? ((rand() & 1) ? 1 : -1) : ((rand() & 1) ? 3 : -2);
+
+		Put(ac_code[rs], ac_size[rs]);
+		if (rs != 0xF0)
+		{
+			Coefficient(value, &category, &bits);
+			Put(bits, rs & 0x0F);
+		}
+		k += (rs >> 4) + 1;
+	}
+	Put(ac_code[0x00], ac_size[0x00]);				//EOB
+}
+
+/*Mean of the luminance block (x, y), the pixel (x, y) of the thumbnail*/
+static uint8_t Mean(uint16_t x, uint16_t y)
+{
+	return (uint8_t)(x*13 + y*29 + (x*y)/7);
+}
+
+static void Encode(const Format_t *format)
+{
+	uint16_t mcu_w = (WIDTH + 8*format->h - 1) / (8*format->h), mcu_h = (HEIGHT + 8*format->v - 1) / (8*format->v);
+	int16_t pred[3] = { 0, 0, 0 };
+	uint32_t mcu = 0;
+
+	length = 0;
+	acc = 0;
+	nacc = 0;
+	srand(7);
+
+	Word(0xFFD8);
+	Word(0xFFDB);									//DQT
+	Word(67);
+	Byte(0x00);
+	Byte(DC_STEP);
+	for (uint8_t n = 1; n < 64; n++) Byte(1);
+	Word(0xFFC0);									//SOF0
+	Word(17);
+	Byte(8);
+	Word(HEIGHT);
+	Word(WIDTH);
+	Byte(3);
+	Byte(1);
+	Byte((format->h << 4) | format->v);
+	Byte(0);
+	for (uint8_t id = 2; id <= 3; id++)
+	{
+		Byte(id);
+		Byte(0x11);
+		Byte(0);
+	}
+	Word(0xFFC4);									//DHT
+	Word(2 + 17 + sizeof(dc_symbols) + 17 + sizeof(ac_symbols));
+	Byte(0x00);
+	for (uint8_t n = 0; n < 16; n++) Byte(dc_counts[n]);
+	for (uint8_t n = 0; n < sizeof(dc_symbols); n++) Byte(dc_symbols[n]);
+	Byte(0x10);
+	for (uint8_t n = 0; n < 16; n++) Byte(ac_counts[n]);
+	for (uint8_t n = 0; n < sizeof(ac_symbols); n++) Byte(ac_symbols[n]);
+	if (format->interval != 0)
+	{
+		Word(0xFFDD);								//DRI
+		Word(4);
+		Word(format->interval);
+	}
+	Word(0xFFDA);									//SOS
+	Word(12);
+	Byte(3);
+	for (uint8_t id = 1; id <= 3; id++)
+	{
+		Byte(id);
+		Byte(0x00);
+	}
+	Byte(0);
+	Byte(63);
+	Byte(0);
+
+	for (uint16_t my = 0; my < mcu_h; my++)
+	{
+		for (uint16_t mx = 0; mx < mcu_w; mx++, mcu++)
+		{
+			if (format->interval != 0 && mcu != 0 && mcu % format->interval == 0)
+			{
+				Align();
+				Word(0xFFD0 + (mcu / format->interval - 1) % 8);
+				pred[0] = pred[1] = pred[2] = 0;
+			}
+			for (uint8_t by = 0; by < format->v; by++)
+			{
+				for (uint8_t bx = 0; bx < format->h; bx++)
+				{
+					int16_t dc = (Mean(mx*format->h + bx, my*format->v + by) - 128)*8/DC_STEP;
+					Block(dc - pred[0], true);
+					pred[0] = dc;
+				}
+			}
+			for (uint8_t n = 1; n < 3; n++)
+			{
+				int16_t dc = (n == 1) ? -20 : 35;	//Flat chroma
+				Block(dc - pred[n], false);
+				pred[n] = dc;
+			}
+		}
+	}
+	Align();
+	Word(0xFFD9);
+}
+
+/*Stores the JPEG in the slot and makes its thumbnail, returns its size*/
+static uint16_t Make(uint32_t size)
+{
+	for (uint32_t n = 0; n < size; n += FLASH_PAGE_SIZE)
+	{
+		Flash_Write_Data(SLOT_ADDR + n, &jpeg[n], (size - n < FLASH_PAGE_SIZE) ? size - n : FLASH_PAGE_SIZE);
+	}
+	Flash_Flush();
+	return Thumbnail_Make(SLOT_ADDR, size, SLOT_ADDR + SLOT_THUMB_OFFSET);
+}
+
+static void TestFormat(const Format_t *format)
+{
+	static uint8_t thumb[THUMB_HEADER_SIZE + WIDTH/8*HEIGHT/8];
+	bool same = true;
+
+	Encode(format);
+	CHECK(length <= sizeof(jpeg));
+	if (length > sizeof(jpeg)) return;
+
+	CHECK(Make(length) == sizeof(thumb));
+	CHECK(Thumbnail_Size(SLOT_ADDR + SLOT_THUMB_OFFSET) == sizeof(thumb));
+	Flash_Read_Data(SLOT_ADDR + SLOT_THUMB_OFFSET, thumb, sizeof(thumb));
+	CHECK(thumb[0] == 0 && thumb[1] == WIDTH/8 && thumb[2] == 0 && thumb[3] == HEIGHT/8);
+	for (uint16_t y = 0; y < HEIGHT/8; y++)
+	{
+		for (uint16_t x = 0; x < WIDTH/8; x++) same &= thumb[THUMB_HEADER_SIZE + y*WIDTH/8 + x] == Mean(x, y);
+	}
+	CHECK(same);
+}
+
+/*Cut before the end of the scan: no thumbnail*/
+static void TestTruncated(void)
+{
+	static const Format_t format = { 2, 1, 0 };
+
+	Encode(&format);
+	CHECK(Make(length/2) == 0);
+	CHECK(Thumbnail_Size(SLOT_ADDR + SLOT_THUMB_OFFSET) == 0);
+}
+
+static void Bench(const Format_t *format, const char *name)
+{
+	uint64_t start, elapsed;
+	uint16_t size = 0;
+
+	Encode(format);
+	Make(length);
+	start = Host_Nanos();
+	for (uint8_t n = 0; n < BENCH_ROUNDS; n++) size = Thumbnail_Make(SLOT_ADDR, length, SLOT_ADDR + SLOT_THUMB_OFFSET);
+	elapsed = (Host_Nanos() - start) / BENCH_ROUNDS;
+
+	printf("thumbnail %s: %lu byte JPEG, %u bytes out, %llu us per KB\n", name, (unsigned long)length, size,
+			(unsigned long long)(elapsed*1024/length/1000));
+}
+
+int main(void)
+{
+	static const Format_t baseline = { 2, 2, 0 };
+	static const Format_t restart = { 2, 2, 7 };
+	static const Format_t h2v1 = { 2, 1, 0 };
+
+	Host_Init();
+	Codes(dc_counts, dc_symbols, dc_code, dc_size);
+	Codes(ac_counts, ac_symbols, ac_code, ac_size);
+
+	TestFormat(&baseline);
+	TestFormat(&restart);
+	TestFormat(&h2v1);
+	TestTruncated();
+
+	Bench(&baseline, "4:2:0");
+	Bench(&restart, "4:2:0 DRI");
+	Bench(&h2v1, "4:2:2");
+	return Host_Report("thumbnail");
+}
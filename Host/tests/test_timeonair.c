@@ -0,0 +1,67 @@
+/*
+ * test_timeonair.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  TimeOnAir_LoRa against the double formula it replaced (Semtech RadioTimeOnAir),
+ *  for every BW/SF/CR/CRC/header/LDRO, every length and the preambles 0-63 and a
+ *  sample of the longer ones.
+ */
+
+#include "host.h"
+#include "timeonair.h"
+#include <math.h>
+
+//                                SF12    SF11    SF10   SF9    SF8    SF7
+static const double ts_ms[3][6] = {{ 32.768, 16.384, 8.192, 4.096, 2.048, 1.024 },	//125 kHz
+                                   { 16.384, 8.192,  4.096, 2.048, 1.024, 0.512 },	//250 kHz
+                                   { 8.192,  4.096,  2.048, 1.024, 0.512, 0.256 }};	//500 kHz
+
+static uint32_t Reference(const TimeOnAirLoRa_t *p, uint8_t length)
+{
+	double ts = ts_ms[p->bandwidth - 4][12 - p->spreading_factor];
+	double preamble = (p->preamble + 4.25) * ts;
+	double tmp = ceil((8*length - 4*p->spreading_factor + 28 + 16*p->crc - (p->fixed_length ? 20 : 0))
+			/ (double)(4*(p->spreading_factor - (p->low_datarate_optimize ? 2 : 0))))
+			* ((p->coding_rate % 4) + 4);
+	double payload = (8 + ((tmp > 0) ? tmp : 0)) * ts;
+
+	return floor(preamble + payload + 0.999);
+}
+
+int main(void)
+{
+	TimeOnAirLoRa_t p;
+	uint32_t cases = 0, wrong = 0;
+
+	Host_Init();
+	for (p.bandwidth = 4; p.bandwidth <= 6; p.bandwidth++)
+	for (p.spreading_factor = 7; p.spreading_factor <= 12; p.spreading_factor++)
+	for (p.coding_rate = 0; p.coding_rate < 8; p.coding_rate++)
+	for (uint8_t flags = 0; flags < 8; flags++)
+	for (uint32_t preamble = 0; preamble <= 0xFFFF; preamble += (preamble < 64) ? 1 : 997)
+	{
+		p.crc = flags & 1;
+		p.fixed_length = flags & 2;
+		p.low_datarate_optimize = flags & 4;
+		p.preamble = preamble;
+		for (uint16_t length = 0; length <= 255; length++)
+		{
+			uint32_t expected = Reference(&p, length), got = TimeOnAir_LoRa(&p, length);
+			cases++;
+			if (got != expected && wrong++ == 0)
+			{
+				printf("BW %u SF %u CR %u flags %u preamble %u length %u: %u ms, expected %u ms\n",
+						p.bandwidth, p.spreading_factor, p.coding_rate, flags, p.preamble, length, got, expected);
+			}
+		}
+	}
+	CHECK(wrong == 0);
+
+	//SF7, BW 125, CR 4/5, CRC, explicit header, 8 symbols of preamble: 20 bytes take 56.6 ms
+	p = (TimeOnAirLoRa_t){ .bandwidth = 4, .spreading_factor = 7, .coding_rate = 1, .crc = true, .preamble = 8 };
+	CHECK(TimeOnAir_LoRa(&p, 20) == 57);
+
+	printf("%u cases\n", cases);
+	return Host_Report("timeonair");
+}
@@ -0,0 +1,132 @@
+/*
+ * test_timer.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Heap of timer.c with 8, 32 and 128 timers started: they fire in the order of
+ *  their expiry, stopped ones do not, and nothing is refused. Benchmark of the time
+ *  the interrupts stay masked by TimerStart, TimerStop and TimerIrqHandler, which
+ *  should grow with log2 of the timers started, not with their number.
+ */
+
+#include "host.h"
+#include "board.h"
+#include "timer.h"
+
+#define TIMERS_MAX					128
+#define ROUNDS						2000		//Stop and start of a timer in the middle of the heap
+#define REPEAT						5			//Runs of each size: the lowest time is kept (preemption of the PC)
+
+static TimerEvent_t timers[TIMERS_MAX];
+static uint32_t expiry[TIMERS_MAX];			//ms after the start
+static uint32_t fired = 0;
+static uint32_t last = 0;					//Expiry of the last timer fired
+static bool ordered = true;
+
+static void OnTimer(void)
+{
+	uint32_t now = (uint32_t)(Host_Micros() / 1000);
+
+	if (now < last) ordered = false;
+	last = now;
+	fired++;
+}
+
+typedef struct
+{
+	uint64_t start;			//ns per call
+	uint64_t restart;
+	uint64_t fire;
+	uint64_t masked;		//Longest section with the interrupts masked (ns)
+} Result_t;
+
+static void Run(uint8_t count, Result_t *result)
+{
+	uint64_t start;
+	uint32_t overflows = TimerGetOverflows();
+
+	fired = 0;
+	last = 0;
+	ordered = true;
+	for (uint8_t n = 0; n < count; n++)
+	{
+		expiry[n] = 1000 + ((n*37) % count)*10;		//All different, started out of order
+		TimerInit(&timers[n], OnTimer);
+		TimerSetValue(&timers[n], expiry[n]);
+	}
+
+	Host_MaskedNanos();
+	start = Host_Nanos();
+	for (uint8_t n = 0; n < count; n++) TimerStart(&timers[n]);
+	result->start = (Host_Nanos() - start) / count;
+
+	start = Host_Nanos();
+	for (uint32_t round = 0; round < ROUNDS; round++)
+	{
+		TimerEvent_t *timer = &timers[(round*7) % count];
+		TimerStop(timer);
+		TimerStart(timer);
+	}
+	result->restart = (Host_Nanos() - start) / (2*ROUNDS);
+
+	//Stopped: never fires
+	TimerStop(&timers[count/2]);
+
+	start = Host_Nanos();
+	Host_Advance(1000 + count*10 + 10);
+	result->fire = (Host_Nanos() - start) / (count - 1);
+	result->masked = Host_MaskedNanos();
+
+	CHECK(fired == count - 1);
+	CHECK(ordered);
+	CHECK(TimerGetOverflows() == overflows);
+}
+
+static void Bench(uint8_t count)
+{
+	Result_t best, result;
+
+	Run(count, &best);
+	for (uint8_t n = 1; n < REPEAT; n++)
+	{
+		Run(count, &result);
+		if (result.start < best.start) best.start = result.start;
+		if (result.restart < best.restart) best.restart = result.restart;
+		if (result.fire < best.fire) best.fire = result.fire;
+		if (result.masked < best.masked) best.masked = result.masked;
+	}
+	printf("timer %3u timers: start %4llu ns, stop+start %4llu ns, fired %4llu ns, masked at most %5llu ns\n",
+			count, (unsigned long long)best.start, (unsigned long long)best.restart,
+			(unsigned long long)best.fire, (unsigned long long)best.masked);
+}
+
+/*One more than the heap holds: refused and counted*/
+static void TestOverflow(void)
+{
+	static TimerEvent_t extra;
+	uint32_t overflows = TimerGetOverflows();
+
+	for (uint16_t n = 0; n < TIMER_HEAP_SIZE && n < TIMERS_MAX; n++)
+	{
+		TimerInit(&timers[n], OnTimer);
+		TimerSetValue(&timers[n], 1000);
+		TimerStart(&timers[n]);
+	}
+	TimerInit(&extra, OnTimer);
+	TimerSetValue(&extra, 10);
+	TimerStart(&extra);
+	CHECK(TimerGetOverflows() == overflows + 1);
+	CHECK(!extra.IsRunning);
+	for (uint16_t n = 0; n < TIMER_HEAP_SIZE && n < TIMERS_MAX; n++) TimerStop(&timers[n]);
+}
+
+int main(void)
+{
+	Host_Init();
+	BoardInitMcu();
+	Bench(8);
+	Bench(32);
+	Bench(128);
+	TestOverflow();
+	return Host_Report("timer");
+}
@@ -0,0 +1,190 @@
+/*
+ * test_tmr.c
+ *
+ *  Created on: 17 oct. 2026
+ *
+ *  Triple redundancy of the data EEPROM (Write_Flash, Check_Redundancy, Flash_Scrub)
+ *  with bits flipped in the simulated EEPROM: one copy or two copies corrupted, the
+ *  voted output, the ranges queued for the scrub and the bytes it rewrites. Then a
+ *  benchmark of the vote.
+ */
+
+#include "host.h"
+#include "flash.h"
+
+#define BENCH_SIZE					138			//Largest redundant read of the firmware
+#define BENCH_ROUNDS				100000
+
+static uint32_t Repairs(void)
+{
+	FlashStats_t stats;
+
+	Flash_Get_Stats(&stats);
+	return stats.repairs;
+}
+
+static void Pattern(uint8_t *data, uint16_t size, uint8_t seed)
+{
+	for (uint16_t n = 0; n < size; n++) data[n] = (uint8_t)(n*53 + seed);
+}
+
+static bool Copies(uint32_t address, const uint8_t *data, uint16_t size)
+{
+	return memcmp((uint8_t *)address, data, size) == 0
+			&& memcmp((uint8_t *)(address + REDUNDANT_COPY2), data, size) == 0
+			&& memcmp((uint8_t *)(address + REDUNDANT_COPY3), data, size) == 0;
+}
+
+/*Repairs everything queued, returns the calls of Flash_Scrub*/
+static uint32_t Scrub(void)
+{
+	uint32_t calls = 1;
+
+	while (Flash_Scrub()) calls++;
+	return calls;
+}
+
+/*One copy corrupted: the output is right and the copy is rewritten*/
+static void TestOneCopy(void)
+{
+	uint32_t address = REDUNDANT_ADDR + 0x40;
+	uint8_t data[20], out[20];
+	uint32_t repairs = Repairs();
+
+	Pattern(data, sizeof(data), 1);
+	Write_Flash(address, data, sizeof(data));
+	Read_Flash(address, out, sizeof(out));
+	CHECK(memcmp(out, data, sizeof(data)) == 0);
+	CHECK(!Flash_Scrub());							//Nothing queued
+
+	Host_FlashFlip(address + REDUNDANT_COPY2 + 3, 0x81);
+	Host_FlashFlip(address + REDUNDANT_COPY2 + 17, 0x10);
+	Read_Flash(address, out, sizeof(out));
+	Read_Flash(address, out, sizeof(out));			//Queued once
+	CHECK(memcmp(out, data, sizeof(data)) == 0);
+	CHECK(Scrub() == 1);
+	CHECK(Repairs() == repairs + 2);
+	CHECK(Copies(address, data, sizeof(data)));
+	CHECK(!Flash_Scrub());
+
+	//Each copy with a byte of its own
+	Host_FlashFlip(address, 0x04);
+	Host_FlashFlip(address + REDUNDANT_COPY3 + 19, 0xFF);
+	Check_Redundancy(address, out, sizeof(out));
+	CHECK(memcmp(out, data, sizeof(data)) == 0);
+	Scrub();
+	CHECK(Repairs() == repairs + 4);
+	CHECK(Copies(address, data, sizeof(data)));
+}
+
+/*Two copies corrupted: other bits of a byte are still voted right, the same bit is not*/
+static void TestTwoCopies(void)
+{
+	uint32_t address = REDUNDANT_ADDR + 0x100;
+	uint8_t data[8], out[8];
+	uint32_t repairs = Repairs();
+
+	Pattern(data, sizeof(data), 2);
+	Write_Flash(address, data, sizeof(data));
+
+	Host_FlashFlip(address + 5, 0x01);
+	Host_FlashFlip(address + REDUNDANT_COPY3 + 5, 0x02);
+	Read_Flash(address, out, sizeof(out));
+	CHECK(memcmp(out, data, sizeof(data)) == 0);
+	Scrub();
+	CHECK(Repairs() == repairs + 2);
+	CHECK(Copies(address, data, sizeof(data)));
+
+	//The same bit in two copies wins the vote, and the third copy is rewritten with it
+	Host_FlashFlip(address + REDUNDANT_COPY2 + 2, 0x40);
+	Host_FlashFlip(address + REDUNDANT_COPY3 + 2, 0x40);
+	Read_Flash(address, out, sizeof(out));
+	data[2] ^= 0x40;
+	CHECK(memcmp(out, data, sizeof(data)) == 0);
+	Scrub();
+	CHECK(Repairs() == repairs + 3);
+	CHECK(Copies(address, data, sizeof(data)));
+}
+
+/*FLASH_SCRUB_QUEUE ranges wait for the scrub, the next one is queued by a later read*/
+static void TestQueue(void)
+{
+	uint32_t address = REDUNDANT_ADDR + 0x200;
+	uint8_t data[FLASH_SCRUB_QUEUE + 1][4], out[4];
+	uint32_t repairs = Repairs();
+
+	for (uint8_t n = 0; n <= FLASH_SCRUB_QUEUE; n++)
+	{
+		Pattern(data[n], sizeof(data[n]), n);
+		Write_Flash(address + n*16, data[n], sizeof(data[n]));
+		Host_FlashFlip(address + n*16 + REDUNDANT_COPY3, 0x08);
+		Read_Flash(address + n*16, out, sizeof(out));
+		CHECK(memcmp(out, data[n], sizeof(out)) == 0);
+	}
+	CHECK(Scrub() == FLASH_SCRUB_QUEUE);
+	CHECK(Repairs() == repairs + FLASH_SCRUB_QUEUE);
+	CHECK(!Copies(address + FLASH_SCRUB_QUEUE*16, data[FLASH_SCRUB_QUEUE], sizeof(out)));
+
+	Read_Flash(address + FLASH_SCRUB_QUEUE*16, out, sizeof(out));
+	Scrub();
+	CHECK(Repairs() == repairs + FLASH_SCRUB_QUEUE + 1);
+	for (uint8_t n = 0; n <= FLASH_SCRUB_QUEUE; n++) CHECK(Copies(address + n*16, data[n], sizeof(out)));
+}
+
+/*A long range is repaired FLASH_SCRUB_CHUNK bytes per call*/
+static void TestChunks(void)
+{
+	uint32_t address = REDUNDANT_ADDR + 0x300;
+	uint8_t data[100], out[100];
+	uint32_t repairs = Repairs();
+
+	Pattern(data, sizeof(data), 3);
+	Write_Flash(address, data, sizeof(data));
+	Host_FlashFlip(address + 90, 0x20);
+	Read_Flash(address, out, sizeof(out));
+	CHECK(memcmp(out, data, sizeof(data)) == 0);
+
+	for (uint16_t done = FLASH_SCRUB_CHUNK; done < 90; done += FLASH_SCRUB_CHUNK)
+	{
+		CHECK(Flash_Scrub());
+		CHECK(Repairs() == repairs);
+	}
+	Scrub();
+	CHECK(Repairs() == repairs + 1);
+	CHECK(Copies(address, data, sizeof(data)));
+}
+
+static void Bench(void)
+{
+	uint32_t address = REDUNDANT_ADDR + 0x400;
+	uint8_t data[BENCH_SIZE], out[BENCH_SIZE];
+	uint64_t start, clean, corrupted;
+
+	Pattern(data, sizeof(data), 4);
+	Write_Flash(address, data, sizeof(data));
+
+	start = Host_Nanos();
+	for (uint32_t n = 0; n < BENCH_ROUNDS; n++) Check_Redundancy(address, out, sizeof(out));
+	clean = Host_Nanos() - start;
+
+	Host_FlashFlip(address + REDUNDANT_COPY2 + 77, 0x01);
+	start = Host_Nanos();
+	for (uint32_t n = 0; n < BENCH_ROUNDS; n++) Check_Redundancy(address, out, sizeof(out));
+	corrupted = Host_Nanos() - start;
+	CHECK(memcmp(out, data, sizeof(data)) == 0);
+	Scrub();
+
+	printf("tmr vote of %u bytes: %llu ns, %llu ns with a copy corrupted\n", BENCH_SIZE,
+			(unsigned long long)(clean / BENCH_ROUNDS), (unsigned long long)(corrupted / BENCH_ROUNDS));
+}
+
+int main(void)
+{
+	Host_Init();
+	TestOneCopy();
+	TestTwoCopies();
+	TestQueue();
+	TestChunks();
+	Bench();
+	return Host_Report("tmr");
+}